@@ -36,10 +36,11 @@ static struct op_abi_entry const abi_entries[] = {
 	
 	{ "offsetof_node_key", offsetof(odb_node_t, key) },
 	{ "offsetof_node_value", offsetof(odb_node_t, value) },
-	{ "offsetof_node_next", offsetof(odb_node_t, next) },
+	{ "odb_node_align", ODB_NODE_ALIGN },
 	
 	{ "offsetof_descr_size", offsetof(odb_descr_t, size) },
 	{ "offsetof_descr_current_size", offsetof(odb_descr_t, current_size) },
+	{ "offsetof_descr_version", offsetof(odb_descr_t, version) },
 	
 	{ "offsetof_header_magic", offsetof(struct opd_header, magic) },
 	{ "offsetof_header_version", offsetof(struct opd_header, version) },
@@ -139,26 +139,46 @@ void import_from_abi(abi const & abi, void const * srcv,
 	// done extracting opd header
 
 	// begin extracting necessary parts of descr
-	odb_node_nr_t node_nr;
+	odb_node_nr_t node_nr, table_size;
+	int version = ODB_VERSION_CHAINED;
 	ext.extract(node_nr, src, "sizeof_odb_node_nr_t", "offsetof_descr_current_size");
+	ext.extract(table_size, src, "sizeof_odb_node_nr_t", "offsetof_descr_size");
+	try {
+		// abi files older than the open addressing format lack it
+		abi.need("offsetof_descr_version");
+		ext.extract(version, src, "sizeof_int", "offsetof_descr_version");
+	} catch (abi_exception const &) {
+	}
 	src += abi.need("sizeof_odb_descr_t");
 	// done extracting descr
 
-	// skip node zero, it is reserved and contains nothing usefull
-	src += abi.need("sizeof_odb_node_t");
+	unsigned int step = abi.need("sizeof_odb_node_t");
+
+	if (version == ODB_VERSION_CHAINED) {
+		// skip node zero, it is reserved and contains nothing usefull
+		src += step;
+		// all nodes but node zero are used
+		table_size = node_nr ? node_nr - 1 : 0;
+	} else {
+		size_t align = abi.need("odb_node_align");
+		size_t offset = src - begin;
+		src = begin + (offset + align - 1) / align * align;
+	}
 
 	// begin extracting nodes
-	unsigned int step = abi.need("sizeof_odb_node_t");
 	if (verbose)
-		cerr << "extracting " << node_nr << " nodes of " << step << " bytes each " << endl;
+		cerr << "extracting " << table_size << " nodes of " << step << " bytes each " << endl;
 
-	assert(src + (node_nr * step) <= begin + len);
+	assert(src + (table_size * step) <= begin + len);
 
-	for (odb_node_nr_t i = 1 ; i < node_nr ; ++i, src += step) {
+	for (odb_node_nr_t i = 0 ; i < table_size ; ++i, src += step) {
 		odb_key_t key;
 		odb_value_t val;
 		ext.extract(key, src, "sizeof_odb_key_t", "offsetof_node_key");
 		ext.extract(val, src, "sizeof_odb_value_t", "offsetof_node_value");
+		// unused slot of an open addressed table
+		if (!val)
+			continue;
 		int rc = odb_add_node(dest, key, val);
 		if (rc != EXIT_SUCCESS) {
 			cerr << strerror(rc) << endl;
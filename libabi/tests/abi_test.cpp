@@ -85,7 +85,8 @@ int main(int argc, char const ** argv)
 		header->cg_to_anon_start = 0;
     
 		for (int i = 0; i < 3793; ++i) {
-			int rc = odb_add_node(&dest, i, i);
+			// zero values are not stored, keep key 0
+			int rc = odb_add_node(&dest, i, i + 1);
 			if (rc != EXIT_SUCCESS) {
 				cerr << strerror(rc) << endl;
 				exit(EXIT_FAILURE);
@@ -14,75 +14,21 @@
 
 #include "odb.h"
 
-static int check_circular_list(odb_data_t const * data)
+/** check than a lookup of each used node finds it */
+static int check_reachable(odb_data_t const * data)
 {
 	odb_node_nr_t pos;
-	int do_abort = 0;
-	unsigned char * bitmap = malloc(data->descr->current_size);
-	memset(bitmap, '\0', data->descr->current_size);
 
-	for (pos = 0 ; pos < data->descr->size * BUCKET_FACTOR ; ++pos) {
-
-		odb_index_t index = data->hash_base[pos];
-		if (index && !do_abort) {
-			while (index) {
-				if (bitmap[index])
-					do_abort = 1;
-
-				bitmap[index] = 1;
-				index = data->node_base[index].next;
-			}
-		}
-
-		if (do_abort) {
-			printf("circular list detected size: %d\n",
-			       data->descr->current_size);
-
-			memset(bitmap, '\0', data->descr->current_size);
-
-			index = data->hash_base[pos];
-			while (index) {
-				printf("%d ", index);
-				if (bitmap[index])
-					exit(1);
-
-				bitmap[index] = 1;
-				index = data->node_base[index].next;
-			}
-		}
-
-		/* purely an optimization: intead of memset the map reset only
-		 * the needed part: not my use to optimize test but here the
-		 * test was so slow it was useless */
-		index = data->hash_base[pos];
-		while (index) {
-			bitmap[index] = 1;
-			index = data->node_base[index].next;
-		}
-	}
-
-	free(bitmap);
-
-	return do_abort;
-}
-
-static int check_redundant_key(odb_data_t const * data, odb_key_t max)
-{
-	odb_node_nr_t pos;
-
-	unsigned char * bitmap = malloc(max + 1);
-	memset(bitmap, '\0', max + 1);
-
-	for (pos = 1 ; pos < data->descr->current_size ; ++pos) {
-		if (bitmap[data->node_base[pos].key]) {
-			printf("redundant key found %lld\n",
-			       (unsigned long long)data->node_base[pos].key);
-			free(bitmap);
+	for (pos = 0 ; pos < data->descr->size ; ++pos) {
+		odb_node_t const * node = &data->node_base[pos];
+		if (!node->value)
+			continue;
+		if (odb_find_slot(data, node->key) != pos) {
+			printf("node %d key %lld unreachable or redundant\n",
+			       pos, (unsigned long long)node->key);
 			return 1;
 		}
-		bitmap[data->node_base[pos].key] = 1;
 	}
-	free(bitmap);
 
 	return 0;
 }
@@ -91,43 +37,33 @@ int odb_check_hash(odb_t const * odb)
 {
 	odb_node_nr_t pos;
 	odb_node_nr_t nr_node = 0;
-	odb_node_nr_t nr_node_out_of_bound = 0;
 	int ret = 0;
-	odb_key_t max = 0;
 	odb_data_t * data = odb->data;
 
-	for (pos = 0 ; pos < data->descr->size * BUCKET_FACTOR ; ++pos) {
-		odb_index_t index = data->hash_base[pos];
-		while (index) {
-			if (index >= data->descr->current_size) {
-				nr_node_out_of_bound++;
-				break;
-			}
-			++nr_node;
-
-			if (data->node_base[index].key > max)
-				max = data->node_base[index].key;
+	if (data->descr->size & (data->descr->size - 1)) {
+		printf("hash table size %d is not a power of two\n",
+		       data->descr->size);
+		return 1;
+	}
 
-			index = data->node_base[index].next;
-		}
+	for (pos = 0 ; pos < data->descr->size ; ++pos) {
+		if (data->node_base[pos].value)
+			++nr_node;
 	}
 
-	if (nr_node != data->descr->current_size - 1) {
+	if (nr_node != data->descr->current_size) {
 		printf("hash table walk found %d node expect %d node\n",
-		       nr_node, data->descr->current_size - 1);
+		       nr_node, data->descr->current_size);
 		ret = 1;
 	}
 
-	if (nr_node_out_of_bound) {
-		printf("out of bound node index: %d\n", nr_node_out_of_bound);
+	if (nr_node == data->descr->size) {
+		printf("hash table full, lookup of a missing key never ends\n");
 		ret = 1;
 	}
 
 	if (ret == 0)
-		ret = check_circular_list(data);
-
-	if (ret == 0)
-		ret = check_redundant_key(data, max);
+		ret = check_reachable(data);
 
 	return ret;
 }
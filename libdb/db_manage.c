@@ -25,6 +25,20 @@
 #include "op_libiberty.h"
 
  
+/** a node of the ODB_VERSION_CHAINED format, whose file layout was:
+ *  the unknown header (sizeof_header)
+ *  odb_descr_t
+ *  the node array: descr->size odb_chained_node_t, node zero is unused
+ *    and descr->current_size is nr used node + 1
+ *  the hash table: descr->size odb_index_t indexing the node array
+ */
+typedef struct {
+	odb_key_t key;
+	unsigned int value;
+	odb_index_t next;
+} odb_chained_node_t;
+
+
 static __inline odb_descr_t * odb_to_descr(odb_data_t * data)
 {
 	return (odb_descr_t *)(((char*)data->base_memory) + data->sizeof_header);
@@ -36,84 +50,105 @@ static __inline odb_node_t * odb_to_node_base(odb_data_t * data)
 	return (odb_node_t *)(((char *)data->base_memory) + data->offset_node);
 }
 
- 
-static __inline odb_index_t * odb_to_hash_base(odb_data_t * data)
+
+/**
+ * return the offset of the node array, the file is mapped at a page
+ * boundary so nodes never straddle a cache line
+ */
+static unsigned int node_offset(size_t sizeof_header)
 {
-	return (odb_index_t *)(((char *)data->base_memory) + 
-				data->offset_node +
-				(data->descr->size * sizeof(odb_node_t)));
+	size_t offset = sizeof_header + sizeof(odb_descr_t);
+
+	return (offset + ODB_NODE_ALIGN - 1) & ~(ODB_NODE_ALIGN - 1);
 }
 
  
 /**
- * return the number of bytes used by hash table, node table and header.
+ * return the number of bytes used by hash table and header.
  */
-static unsigned int tables_size(odb_data_t const * data, odb_node_nr_t node_nr)
+static size_t tables_size(odb_data_t const * data, odb_node_nr_t node_nr)
 {
-	size_t size;
+	return data->offset_node + node_nr * sizeof(odb_node_t);
+}
 
-	size = node_nr * (sizeof(odb_index_t) * BUCKET_FACTOR);
-	size += node_nr * sizeof(odb_node_t);
-	size += data->offset_node;
 
-	return size;
+static void set_hash_size(odb_data_t * data)
+{
+	odb_node_nr_t size;
+
+	data->hash_mask = data->descr->size - 1;
+	data->hash_shift = 64;
+	for (size = data->descr->size; size > 1; size >>= 1)
+		--data->hash_shift;
+}
+
+
+/** add a node to a table known to have room for it */
+static void rehash_node(odb_data_t * data, odb_key_t key, odb_value_t value)
+{
+	odb_node_t * node = &data->node_base[odb_find_slot(data, key)];
+
+	if (!node->value) {
+		node->key = key;
+		++data->descr->current_size;
+	}
+	node->value += value;
 }
 
 
 int odb_grow_hashtable(odb_data_t * data)
 {
-	unsigned int old_file_size;
-	unsigned int new_file_size;
-	unsigned int pos;
+	size_t old_file_size;
+	size_t new_file_size;
+	size_t old_table_size;
+	odb_node_nr_t old_size;
+	odb_node_nr_t pos;
+	odb_node_t * old_nodes;
 	void * new_map;
 
-	old_file_size = tables_size(data, data->descr->size);
-	new_file_size = tables_size(data, data->descr->size * 2);
+	old_size = data->descr->size;
+	old_file_size = tables_size(data, old_size);
+	new_file_size = tables_size(data, old_size * 2);
+	old_table_size = old_size * sizeof(odb_node_t);
 
-	if (ftruncate(data->fd, new_file_size))
+	old_nodes = malloc(old_table_size);
+	if (!old_nodes)
 		return 1;
 
+	if (ftruncate(data->fd, new_file_size))
+		goto fail;
+
 	new_map = mremap(data->base_memory,
 			 old_file_size, new_file_size, MREMAP_MAYMOVE);
 
 	if (new_map == MAP_FAILED)
-		return 1;
+		goto fail;
 
 	data->base_memory = new_map;
 	data->descr = odb_to_descr(data);
-	data->descr->size *= 2;
 	data->node_base = odb_to_node_base(data);
-	data->hash_base = odb_to_hash_base(data);
-	data->hash_mask = (data->descr->size * BUCKET_FACTOR) - 1;
-
-	/* rebuild the hash table, node zero is never used. This works
-	 * because layout of file is node table then hash table,
-	 * sizeof(node) > sizeof(bucket) and when we grow table we
-	 * double size ==> old hash table and new hash table can't
-	 * overlap so on the new hash table is entirely in the new
-	 * memory area (the grown part) and we know the new hash
-	 * hash table is zeroed. That's why we don't need to zero init
-	 * the new table */
-	/* OK: the above is not exact
-	 * if BUCKET_FACTOR < sizeof(bd_node_t) / sizeof(bd_node_nr_t)
-	 * all things are fine and we don't need to init the hash
-	 * table because in this case the new hash table is completely
-	 * inside the new growed part. Avoiding to touch this memory is
-	 * useful.
+
+	/* rehash through a copy of the old table. The grown part of the
+	 * file is zeroed by ftruncate(), only the old part need clearing.
 	 */
-#if 0
-	for (pos = 0 ; pos < data->descr->size*BUCKET_FACTOR ; ++pos)
-		data->hash_base[pos] = 0;
-#endif
-
-	for (pos = 1; pos < data->descr->current_size; ++pos) {
-		odb_node_t * node = &data->node_base[pos];
-		size_t index = odb_do_hash(data, node->key);
-		node->next = data->hash_base[index];
-		data->hash_base[index] = pos;
+	memcpy(old_nodes, data->node_base, old_table_size);
+	memset(data->node_base, '\0', old_table_size);
+	data->descr->size = old_size * 2;
+	data->descr->current_size = 0;
+	set_hash_size(data);
+
+	for (pos = 0; pos < old_size; ++pos) {
+		if (old_nodes[pos].value)
+			rehash_node(data, old_nodes[pos].key,
+				    old_nodes[pos].value);
 	}
 
+	free(old_nodes);
 	return 0;
+
+fail:
+	free(old_nodes);
+	return 1;
 }
 
 
@@ -123,8 +158,8 @@ void odb_init(odb_t * odb)
 }
 
 
-/* the default number of page, calculated to fit in 4096 bytes */
-#define DEFAULT_NODE_NR(offset_node)	128
+/* the default number of node, calculated to fit in 4096 bytes */
+#define DEFAULT_NODE_NR			128
 #define FILES_HASH_SIZE                 512
 
 static struct list_head files_hash[FILES_HASH_SIZE];
@@ -159,6 +194,121 @@ find_samples_data(size_t hash, char const * filename)
 }
 
 
+/** return the smallest table size holding nr_node under the max load factor */
+static odb_node_nr_t table_size_for(odb_node_nr_t nr_node)
+{
+	odb_node_nr_t size = DEFAULT_NODE_NR;
+
+	while ((nr_node + 1) * 4 > size * 3)
+		size *= 2;
+
+	return size;
+}
+
+
+/**
+ * Convert the ODB_VERSION_CHAINED file mapped at data->base_memory for
+ * file_size bytes to the current format. A read only file is converted
+ * into an anonymous mapping, else the new table is built in a temporary
+ * file renamed over the old one once complete, so a failure or a crash
+ * during the conversion leaves the old file intact.
+ *
+ * On failure, data->base_memory and data->fd are unchanged.
+ */
+static int convert_chained(odb_data_t * data, enum odb_rw rw, size_t file_size)
+{
+	odb_descr_t const * descr = odb_to_descr(data);
+	size_t chained_offset = data->sizeof_header + sizeof(odb_descr_t);
+	odb_chained_node_t const * chained;
+	odb_node_nr_t nr_node, pos, size;
+	size_t new_file_size;
+	char const * old = data->base_memory;
+	char * tmp_name = NULL;
+	int tmp_fd = -1;
+	struct stat stat_buf;
+	void * new_map;
+	int err;
+
+	/* sanity check nr node */
+	nr_node = (file_size - chained_offset) /
+		(sizeof(odb_index_t) + sizeof(odb_chained_node_t));
+	if (nr_node != descr->size || !descr->current_size ||
+	    descr->current_size > nr_node)
+		return EINVAL;
+
+	size = table_size_for(descr->current_size - 1);
+	new_file_size = tables_size(data, size);
+
+	if (rw == ODB_RDONLY) {
+		new_map = mmap(0, new_file_size, PROT_READ | PROT_WRITE,
+			       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (new_map == MAP_FAILED)
+			return errno;
+	} else {
+		tmp_name = xmalloc(strlen(data->filename) + sizeof(".XXXXXX"));
+		strcpy(tmp_name, data->filename);
+		strcat(tmp_name, ".XXXXXX");
+		tmp_fd = mkstemp(tmp_name);
+		if (tmp_fd < 0) {
+			err = errno;
+			free(tmp_name);
+			return err;
+		}
+		/* ftruncate() zeroes the new table */
+		if (fstat(data->fd, &stat_buf) ||
+		    fchmod(tmp_fd, stat_buf.st_mode & 0777) ||
+		    ftruncate(tmp_fd, new_file_size))
+			goto fail_tmp;
+		new_map = mmap(0, new_file_size, PROT_READ | PROT_WRITE,
+			       MAP_SHARED, tmp_fd, 0);
+		if (new_map == MAP_FAILED)
+			goto fail_tmp;
+	}
+
+	memcpy(new_map, old, data->sizeof_header);
+	descr = (odb_descr_t const *)(old + data->sizeof_header);
+	chained = (odb_chained_node_t const *)(old + chained_offset);
+
+	data->base_memory = new_map;
+	data->descr = odb_to_descr(data);
+	data->descr->size = size;
+	data->descr->current_size = 0;
+	data->descr->version = ODB_VERSION;
+	data->node_base = odb_to_node_base(data);
+	set_hash_size(data);
+
+	/* node zero is unused, value zero nodes can't be represented */
+	for (pos = 1; pos < descr->current_size; ++pos) {
+		if (chained[pos].value)
+			rehash_node(data, chained[pos].key, chained[pos].value);
+	}
+
+	if (rw == ODB_RDWR) {
+		if (rename(tmp_name, data->filename)) {
+			err = errno;
+			munmap(new_map, new_file_size);
+			data->base_memory = (void *)old;
+			data->descr = odb_to_descr(data);
+			goto remove_tmp;
+		}
+		close(data->fd);
+		data->fd = tmp_fd;
+		free(tmp_name);
+	}
+
+	munmap((void *)old, file_size);
+	return 0;
+
+fail_tmp:
+	err = errno;
+remove_tmp:
+	close(tmp_fd);
+	unlink(tmp_name);
+	free(tmp_name);
+	return err;
+}
+
+
 int odb_open(odb_t * odb, char const * filename, enum odb_rw rw,
 	     size_t sizeof_header)
 {
@@ -166,6 +316,7 @@ int odb_open(odb_t * odb, char const * filename, enum odb_rw rw,
 	odb_node_nr_t nr_node;
 	odb_data_t * data;
 	size_t hash;
+	size_t map_size;
 	int err = 0;
 
 	int flags = (rw == ODB_RDWR) ? (O_CREAT | O_RDWR) : O_RDONLY;
@@ -182,7 +333,7 @@ int odb_open(odb_t * odb, char const * filename, enum odb_rw rw,
 	data = xmalloc(sizeof(odb_data_t));
 	memset(data, '\0', sizeof(odb_data_t));
 	list_init(&data->list);
-	data->offset_node = sizeof_header + sizeof(odb_descr_t);
+	data->offset_node = node_offset(sizeof_header);
 	data->sizeof_header = sizeof_header;
 	data->ref_count = 1;
 	data->filename = xstrdup(filename);
@@ -199,27 +350,27 @@ int odb_open(odb_t * odb, char const * filename, enum odb_rw rw,
 	}
 
 	if (stat_buf.st_size == 0) {
-		size_t file_size;
-
 		if (rw == ODB_RDONLY) {
 			err = EIO;
 			goto fail;
 		}
 
-		nr_node = DEFAULT_NODE_NR(data->offset_node);
+		nr_node = DEFAULT_NODE_NR;
 
-		file_size = tables_size(data, nr_node);
-		if (ftruncate(data->fd, file_size)) {
+		map_size = tables_size(data, nr_node);
+		if (ftruncate(data->fd, map_size)) {
 			err = errno;
 			goto fail;
 		}
 	} else {
-		/* Calculate nr node allowing a sanity check later */
-		nr_node = (stat_buf.st_size - data->offset_node) /
-			((sizeof(odb_index_t) * BUCKET_FACTOR) + sizeof(odb_node_t));
+		if ((size_t)stat_buf.st_size < sizeof_header + sizeof(odb_descr_t)) {
+			err = EINVAL;
+			goto fail;
+		}
+		map_size = stat_buf.st_size;
 	}
 
-	data->base_memory = mmap(0, tables_size(data, nr_node), mmflags,
+	data->base_memory = mmap(0, map_size, mmflags,
 				MAP_SHARED, data->fd, 0);
 
 	if (data->base_memory == MAP_FAILED) {
@@ -231,26 +382,33 @@ int odb_open(odb_t * odb, char const * filename, enum odb_rw rw,
 
 	if (stat_buf.st_size == 0) {
 		data->descr->size = nr_node;
-		/* page zero is not used */
-		data->descr->current_size = 1;
+		data->descr->current_size = 0;
+		data->descr->version = ODB_VERSION;
+	} else if (data->descr->version == ODB_VERSION_CHAINED) {
+		err = convert_chained(data, rw, map_size);
+		if (err)
+			goto fail_unmap;
+		data->descr = odb_to_descr(data);
 	} else {
 		/* file already exist, sanity check nr node */
-		if (nr_node != data->descr->size) {
+		if (data->descr->version != ODB_VERSION ||
+		    tables_size(data, data->descr->size) != map_size ||
+		    (data->descr->size & (data->descr->size - 1))) {
 			err = EINVAL;
 			goto fail_unmap;
 		}
 	}
 
-	data->hash_base = odb_to_hash_base(data);
 	data->node_base = odb_to_node_base(data);
-	data->hash_mask = (data->descr->size * BUCKET_FACTOR) - 1;
+	set_hash_size(data);
 
 	list_add(&data->list, &files_hash[hash]);
 	odb->data = data;
 out:
 	return err;
 fail_unmap:
-	munmap(data->base_memory, tables_size(data, nr_node));
+	if (data->base_memory != MAP_FAILED)
+		munmap(data->base_memory, map_size);
 fail:
 	close(data->fd);
 	free(data->filename);
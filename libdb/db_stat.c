@@ -20,7 +20,7 @@ struct odb_hash_stat_t {
 	odb_node_nr_t used_node_nr;		/**< in use node number */
 	count_type    total_count;		/**< cumulated samples count */
 	odb_index_t   hash_table_size;		/**< hash table entry number */
-	odb_node_nr_t max_list_length;		/**< worst case   */
+	odb_node_nr_t max_list_length;		/**< worst case probe length */
 	double       average_list_length;	/**< average case */
 	/* do we need variance ? */
 };
@@ -29,7 +29,6 @@ odb_hash_stat_t * odb_hash_stat(odb_t const * odb)
 {
 	size_t max_length = 0;
 	double total_length = 0.0;
-	size_t nr_non_empty_list = 0;
 	size_t pos;
 	odb_data_t * data = odb->data;
 
@@ -41,32 +40,29 @@ odb_hash_stat_t * odb_hash_stat(odb_t const * odb)
 
 	result->node_nr = data->descr->size;
 	result->used_node_nr = data->descr->current_size;
-	result->hash_table_size = data->descr->size * BUCKET_FACTOR;
-
-	/* FIXME: I'm dubious if this do right statistics for hash table
-	 * efficiency check */
+	result->hash_table_size = data->descr->size;
 
+	/* the list length of a node is the number of slots probed to
+	 * find it, from its hash position */
 	for (pos = 0 ; pos < result->hash_table_size ; ++pos) {
-		size_t cur_length = 0;
-		size_t index = data->hash_base[pos];
-		while (index) {
-			result->total_count += data->node_base[index].value;
-			index = data->node_base[index].next;
-			++cur_length;
-		}
+		odb_node_t const * node = &data->node_base[pos];
+		size_t cur_length;
+
+		if (!node->value)
+			continue;
+
+		result->total_count += node->value;
+		cur_length = ((pos - odb_do_hash(data, node->key)) &
+		              data->hash_mask) + 1;
 
 		if (cur_length > max_length)
 			max_length = cur_length;
-
-		if (cur_length) {
-			total_length += cur_length;
-			++nr_non_empty_list;
-		}
+		total_length += cur_length;
 	}
 
 	result->max_list_length = max_length;
-	result->average_list_length = (!nr_non_empty_list) ? 0
-	                                                   : total_length / nr_non_empty_list;
+	result->average_list_length = (!result->used_node_nr) ? 0
+	                              : total_length / result->used_node_nr;
 
 	return result;
 }
@@ -78,8 +74,8 @@ void odb_hash_display_stat(odb_hash_stat_t const * stat)
 	printf("total used node:     %d\n", stat->used_node_nr);
 	printf("total count:         %llu\n", stat->total_count);
 	printf("hash table size:     %d\n", stat->hash_table_size);
-	printf("greater list length: %d\n", stat->max_list_length);
-	printf("average non empty list length: %2.4f\n", stat->average_list_length);
+	printf("max probe length:    %d\n", stat->max_list_length);
+	printf("average probe length: %2.4f\n", stat->average_list_length);
 }
 
 
@@ -20,39 +20,40 @@
 
 /** the type of key. 64-bit because CG needs 32-bit pair {from,to} */
 typedef uint64_t odb_key_t;
-/** the type of an information in the database */
-typedef unsigned int odb_value_t;
-/** the type of index (node number), list are implemented through index */
+/** the type of an information in the database, 64-bit so it can't overflow */
+typedef uint64_t odb_value_t;
+/** the type of index (node number) */
 typedef unsigned int odb_index_t;
 /** the type store node number */
 typedef odb_index_t odb_node_nr_t;
 /** store the hash mask, hash table size are always power of two */
 typedef odb_index_t odb_hash_mask_t;
 
-/* there is (bucket factor * nr node) entry in hash table, this can seem
- * excessive but hash coding eip don't give a good distributions and our
- * goal is to get a O(1) amortized insert time. bucket factor must be a
- * power of two. FIXME: see big comment in odb_hash_add_node, you must
- * re-enable zeroing hash table if BUCKET_FACTOR > 2 (roughly exact, you
- * want to read the comment in odb_hash_add_node() if you tune this define)
- */
-#define BUCKET_FACTOR 1
+/** the chained hash table format used until OPD_VERSION 0x13 */
+#define ODB_VERSION_CHAINED 0
+/** the open addressed hash table format */
+#define ODB_VERSION_OPEN_ADDRESSING 1
+/** format of the files created by odb_open() */
+#define ODB_VERSION ODB_VERSION_OPEN_ADDRESSING
+
+/** the node array is aligned on this boundary in the file */
+#define ODB_NODE_ALIGN 64
 
-/** a db hash node */
+/** a db hash node, a node with a zero value is an unused slot */
 typedef struct {
 	odb_key_t key;			/**< eip */
 	odb_value_t value;		/**< samples count */
-	odb_index_t next;		/**< next entry for this bucket */
 } odb_node_t;
 
 /** the minimal information which must be stored in the file to reload
- * properly the data base, following this header is the node array then
- * the hash table (when growing we avoid to copy node array)
+ * properly the data base, following this header is the node array
+ * which is also the hash table
  */
 typedef struct {
 	odb_node_nr_t size;		/**< in node nr (power of two) */
-	odb_node_nr_t current_size;	/**< nr used node + 1, node 0 unused */
-	int padding[6];			/**< for padding and future use */
+	odb_node_nr_t current_size;	/**< nr used node */
+	int version;			/**< ODB_VERSION_* */
+	int padding[5];			/**< for padding and future use */
 } odb_descr_t;
 
 /** a "database". this is an in memory only description.
@@ -68,15 +69,18 @@ typedef struct {
  * the internal memory layout from base_memory is:
  *  the unknown header (sizeof_header)
  *  odb_descr_t
- *  the node array: (descr->size * sizeof(odb_node_t) entries
- *  the hash table: array of odb_index_t indexing the node array 
- *    (descr->size * BUCKET_FACTOR) entries
+ *  padding up to a multiple of ODB_NODE_ALIGN
+ *  the node array: descr->size entries, an open addressed hash table
+ *    with linear probing, so a lookup usually touches a single cache line
+ *
+ * Files in the ODB_VERSION_CHAINED format are converted to this layout
+ * when opened, in memory for a read only open, in place otherwise.
  */
 typedef struct odb_data {
 	odb_node_t * node_base;		/**< base memory area of the page */
-	odb_index_t * hash_base;	/**< base memory of hash table */
 	odb_descr_t * descr;		/**< the current state of database */
 	odb_hash_mask_t hash_mask;	/**< == descr->size - 1 */
+	unsigned int hash_shift;	/**< 64 - log2(descr->size) */
 	unsigned int sizeof_header;	/**< from base_memory to odb header */
 	unsigned int offset_node;	/**< from base_memory to node array */
 	void * base_memory;		/**< base memory of the maped memory */
@@ -136,31 +140,22 @@ void * odb_get_data(odb_t * odb);
 void odb_sync(odb_t const * odb);
 
 /**
- * grow the hashtable in such way current_size is the index of the first free
- * node. Take care all node pointer can be invalidated by this call.
- *
- * Node allocation is done in a two step way 1st) ensure a free node exist
- * eventually, caller can setup it, 2nd) commit the node allocation with
- * odb_commit_reservation().
- * This is done in this way to ensure node setup is visible from another
- * process like pp tools in an atomic way.
+ * double the size of the hash table and rehash all the nodes. Take care
+ * all node pointer are invalidated by this call.
  *
  * returns 0 on success, non zero on failure in this case this function do
  * nothing and errno is set by the first libc call failure allowing to retry
  * after cleanup some program resource.
  */
 int odb_grow_hashtable(odb_data_t * data);
-/**
- * commit a previously successfull node reservation. This can't fail.
- */
-static __inline void odb_commit_reservation(odb_data_t * data)
+
+/** true if adding a node to the hash table requires growing it first */
+static __inline int odb_need_grow(odb_data_t const * data)
 {
-	++data->descr->current_size;
+	/* keep the load factor under 3/4 */
+	return (data->descr->current_size + 1) * 4 > data->descr->size * 3;
 }
 
-/** "immpossible" node number to indicate an error from odb_hash_add_node() */
-#define ODB_NODE_NR_INVALID ((odb_node_nr_t)-1)
-
 /* db_debug.c */
 /** check that the hash is well built */
 int odb_check_hash(odb_t const * odb);
@@ -172,7 +167,7 @@ void odb_hash_display_stat(odb_hash_stat_t const * stats);
 void odb_hash_free_stat(odb_hash_stat_t * stats);
 
 /* db_insert.c */
-/** update info at key by incrementing its associated value by one, 
+/** update info at key by incrementing its associated value by one,
  * if the key does not exist a new node is created and the value associated
  * is set to one.
  *
@@ -188,7 +183,7 @@ int odb_update_node(odb_t * odb, odb_key_t key);
  *
  * update info at key by adding the specified offset to its associated value,
  * if the key does not exist a new node is created and the value associated
- * is set to offset.
+ * is set to offset. A zero offset never creates a node.
  *
  * returns EXIT_SUCCESS on success, EXIT_FAILURE on failure
  */
@@ -196,7 +191,10 @@ int odb_update_node_with_offset(odb_t * odb,
 				odb_key_t key, 
 				unsigned long int offset);
 
-/** Add a new node w/o regarding if a node with the same key already exists
+/** Add value to the node for key, as odb_update_node_with_offset(). Nodes
+ * are unique by key, so adding an existing key sums up the values. A zero
+ * value marks an unused slot, so adding a zero value to a missing key is a
+ * no-op and the key stays absent.
  *
  * returns EXIT_SUCCESS on success, EXIT_FAILURE on failure
  */
@@ -210,26 +208,41 @@ int odb_add_node(odb_t * odb, odb_key_t key, odb_value_t value);
  * odb_node_nr_t node_nr, pos;
  * odb_node_t * node = odb_get_iterator(odb, &node_nr);
  *	for ( pos = 0 ; pos < node_nr ; ++pos)
- *		// do something
+ *		if (node[pos].value)
+ *			// do something
  *
- *  note than caller does not need to filter nil key as it's a valid key,
- * The returned range is all valid (i.e. should never contain zero value).
+ * The array is the hash table, so it contains unused slots which must be
+ * skipped: they have a zero value. Note than caller does not need to
+ * filter nil key as it's a valid key.
  */
 odb_node_t * odb_get_iterator(odb_t const * odb, odb_node_nr_t * nr);
 
-static __inline unsigned int
+static __inline odb_index_t
 odb_do_hash(odb_data_t const * data, odb_key_t value)
 {
-	/* FIXME: better hash for eip value, needs to instrument code
-	 * and do a lot of tests ... */
-	/* trying to combine high order bits his a no-op: inside a binary image
-	 * high order bits don't vary a lot, hash table start with 7 bits mask
-	 * so this hash coding use bits 0-7, 8-15. Hash table is stored in
-	 * files avoiding to rebuilding them at profiling re-start so
+	/* multiplicative hashing: the high order bits of the product depend
+	 * on all bits of the key, so nearby eip values, which are the common
+	 * case, are spread over the whole table instead of forming the long
+	 * runs of used slots linear probing is slow on. Hash table is stored
+	 * in files avoiding to rebuilding them at profiling re-start so
 	 * on changing do_hash() change the file format!
 	 */
-	uint32_t temp = (value >> 32) ^ value;
-	return ((temp << 0) ^ (temp >> 8)) & data->hash_mask;
+	return (odb_index_t)((value * 0x9e3779b97f4a7c15ULL) >> data->hash_shift);
+}
+
+/** return the slot holding key, or the unused slot where it belongs */
+static __inline odb_index_t
+odb_find_slot(odb_data_t const * data, odb_key_t key)
+{
+	odb_index_t index = odb_do_hash(data, key);
+	odb_node_t const * node = &data->node_base[index];
+
+	while (node->value && node->key != key) {
+		index = (index + 1) & data->hash_mask;
+		node = &data->node_base[index];
+	}
+
+	return index;
 }
 
 #ifdef __cplusplus
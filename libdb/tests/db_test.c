@@ -72,6 +72,93 @@ static void speed_test(int nr_item, char const * test_name)
 }
 
 
+/*
+ * Sample addresses looking like a real profile: nr_unique distinct keys
+ * picked according to layout, hit with a skewed distribution so that a
+ * few hot spots get most of the samples.
+ */
+enum eip_layout { EIP_DENSE, EIP_SPARSE, EIP_ARC };
+
+static odb_key_t * eip_samples(enum eip_layout layout, int nr_sample,
+                               int nr_unique)
+{
+	odb_key_t * unique = malloc(nr_unique * sizeof(odb_key_t));
+	odb_key_t * samples = malloc(nr_sample * sizeof(odb_key_t));
+	int i;
+
+	if (!unique || !samples) {
+		fprintf(stderr, "out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (i = 0 ; i < nr_unique ; ++i) {
+		switch (layout) {
+		case EIP_DENSE:
+			/* every instruction of a text section */
+			unique[i] = 0x400000 + i * 4 + random() % 4;
+			break;
+		case EIP_SPARSE:
+			/* scattered over a large text section */
+			unique[i] = 0x400000 + random() % (64 << 20);
+			break;
+		case EIP_ARC:
+			/* call graph arcs, from in the high half */
+			unique[i] = ((odb_key_t)(random() % (8 << 20)) << 32) |
+				(random() % (8 << 20));
+			break;
+		}
+	}
+
+	for (i = 0 ; i < nr_sample ; ++i) {
+		double r = (double)random() / RAND_MAX;
+		samples[i] = unique[(int)(r * r * r * (nr_unique - 1))];
+	}
+
+	free(unique);
+	return samples;
+}
+
+
+static void eip_speed_test(enum eip_layout layout, char const * test_name)
+{
+	int const nr_sample = 1000000;
+	int nr_unique;
+
+	for (nr_unique = 1000; nr_unique <= 100000; nr_unique *= 10) {
+		odb_key_t * samples;
+		double begin, end;
+		odb_t hash;
+		int i, rc;
+
+		samples = eip_samples(layout, nr_sample, nr_unique);
+		rc = odb_open(&hash, TEST_FILENAME, ODB_RDWR,
+		              sizeof(struct opd_header));
+		if (rc) {
+			fprintf(stderr, "%s", strerror(rc));
+			exit(EXIT_FAILURE);
+		}
+
+		begin = used_time();
+		for (i = 0 ; i < nr_sample ; ++i) {
+			rc = odb_update_node(&hash, samples[i]);
+			if (rc != EXIT_SUCCESS) {
+				fprintf(stderr, "%s", strerror(rc));
+				exit(EXIT_FAILURE);
+			}
+		}
+		end = used_time();
+
+		odb_close(&hash);
+		remove(TEST_FILENAME);
+		free(samples);
+
+		verbprintf("%s: nr sample: %d, nr unique: %d, elapsed: %f ns\n",
+			   test_name, nr_sample, nr_unique,
+			   (end - begin) / nr_sample);
+	}
+}
+
+
 static void do_speed_test(void)
 {
 	int i;
@@ -82,6 +169,10 @@ static void do_speed_test(void)
 		speed_test(i, "update");
 		remove(TEST_FILENAME);
 	}
+
+	eip_speed_test(EIP_DENSE, "dense eip");
+	eip_speed_test(EIP_SPARSE, "sparse eip");
+	eip_speed_test(EIP_ARC, "call graph arc");
 }
 
 
@@ -136,6 +227,134 @@ static void do_test(void)
 }
 
 
+/* the ODB_VERSION_CHAINED layout, see db_manage.c */
+typedef struct {
+	odb_key_t key;
+	unsigned int value;
+	odb_index_t next;
+} chained_node_t;
+
+#define CHAINED_SIZE 512
+
+
+static void write_chained_file(int nr_node)
+{
+	struct opd_header header;
+	odb_descr_t descr;
+	chained_node_t node;
+	odb_index_t index = 0;
+	FILE * fp;
+	int i;
+
+	fp = fopen(TEST_FILENAME, "w");
+	if (!fp) {
+		perror(TEST_FILENAME);
+		exit(EXIT_FAILURE);
+	}
+
+	memset(&header, '\0', sizeof(header));
+	fwrite(&header, sizeof(header), 1, fp);
+	memset(&descr, '\0', sizeof(descr));
+	descr.size = CHAINED_SIZE;
+	descr.current_size = nr_node + 1;
+	descr.version = ODB_VERSION_CHAINED;
+	fwrite(&descr, sizeof(descr), 1, fp);
+
+	/* node zero is unused, node i holds key (i - 1) * 3 */
+	for (i = 0; i < CHAINED_SIZE; ++i) {
+		memset(&node, '\0', sizeof(node));
+		if (i && i <= nr_node) {
+			node.key = (i - 1) * 3;
+			node.value = i;
+		}
+		fwrite(&node, sizeof(node), 1, fp);
+	}
+	for (i = 0; i < CHAINED_SIZE; ++i)
+		fwrite(&index, sizeof(index), 1, fp);
+
+	fclose(fp);
+}
+
+
+/* return the version of the file on disk, read only opens convert in memory */
+static int file_version(void)
+{
+	odb_descr_t descr;
+	FILE * fp = fopen(TEST_FILENAME, "r");
+
+	memset(&descr, '\0', sizeof(descr));
+	descr.version = -1;
+	if (fp) {
+		fseek(fp, sizeof(struct opd_header), SEEK_SET);
+		if (fread(&descr, sizeof(descr), 1, fp) != 1)
+			descr.version = -1;
+		fclose(fp);
+	}
+	return descr.version;
+}
+
+
+/* convert a chained file then check it was rewritten with all its nodes */
+static void convert_test(void)
+{
+	int const nr_node = 300;
+	odb_node_nr_t node_nr, pos;
+	odb_node_t * node;
+	odb_value_t total = 0;
+	odb_t hash;
+	int rc;
+
+	write_chained_file(nr_node);
+
+	rc = odb_open(&hash, TEST_FILENAME, ODB_RDWR, sizeof(struct opd_header));
+	if (rc) {
+		fprintf(stderr, "%s", strerror(rc));
+		exit(EXIT_FAILURE);
+	}
+	/* a zero value never creates a node */
+	odb_add_node(&hash, 1, 0);
+	odb_close(&hash);
+
+	if (file_version() != ODB_VERSION) {
+		fprintf(stderr, "%s:%d chained file not rewritten\n",
+		        __FILE__, __LINE__);
+		nr_error++;
+	}
+
+	rc = odb_open(&hash, TEST_FILENAME, ODB_RDONLY, sizeof(struct opd_header));
+	if (rc) {
+		fprintf(stderr, "%s", strerror(rc));
+		exit(EXIT_FAILURE);
+	}
+
+	node = odb_get_iterator(&hash, &node_nr);
+	for (pos = 0; pos < node_nr; ++pos) {
+		if (!node[pos].value)
+			continue;
+		if (node[pos].key % 3 ||
+		    node[pos].value != node[pos].key / 3 + 1) {
+			fprintf(stderr, "%s:%d bad node %llu %llu\n",
+			        __FILE__, __LINE__,
+			        (unsigned long long)node[pos].key,
+			        (unsigned long long)node[pos].value);
+			nr_error++;
+		}
+		total += node[pos].value;
+	}
+
+	if (hash.data->descr->current_size != (odb_node_nr_t)nr_node ||
+	    total != (odb_value_t)nr_node * (nr_node + 1) / 2 ||
+	    odb_check_hash(&hash)) {
+		fprintf(stderr, "%s:%d chained file conversion failure\n",
+		        __FILE__, __LINE__);
+		nr_error++;
+	}
+
+	odb_close(&hash);
+	remove(TEST_FILENAME);
+}
+
+
 static void sanity_check(char const * filename)
 {
 	odb_t hash;
@@ -178,6 +397,8 @@ speed_test:
 
 	do_test();
 
+	convert_test();
+
 	do_speed_test();
 
 	if (nr_error)
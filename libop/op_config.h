@@ -66,7 +66,10 @@ extern char op_samples_current_dir[];
 #endif
 
 #define OPD_MAGIC "DAE\n"
-#define OPD_VERSION 0x13
+#define OPD_VERSION 0x14
+/* oldest readable sample file version, 0x13 sample files use the chained
+ * libdb format which odb_open() converts on the fly */
+#define OPD_MIN_VERSION 0x13
 
 #if defined(__cplusplus)
 }
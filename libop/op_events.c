@@ -27,6 +27,25 @@
 static LIST_HEAD(events_list);
 static LIST_HEAD(um_list);
 
+/* events_list hashed by name and by event number, each slot in list order */
+#define EVENT_HASH_SIZE 1021
+static struct list_head event_name_hash[EVENT_HASH_SIZE];
+static struct list_head event_val_hash[EVENT_HASH_SIZE];
+/* false when events_list changed since the hashes were built */
+static int events_hashed;
+
+/* one line of the event_mappings file of mapping_cpu */
+struct event_mapping {
+	u32 nr;
+	/* NULL if one of the mmcr tags is missing */
+	char * map;
+	unsigned int line_nr;
+	struct list_head hash;
+};
+static struct list_head mapping_hash[EVENT_HASH_SIZE];
+static op_cpu mapping_cpu = CPU_NO_GOOD;
+static char * mapping_filename;
+
 static char const * filename;
 static unsigned int line_nr;
 
@@ -479,6 +498,7 @@ static struct op_event * new_event(void)
 	struct op_event * event = xmalloc(sizeof(struct op_event));
 	memset(event, '\0', sizeof(struct op_event));
 	list_add_tail(&event->event_next, &events_list);
+	events_hashed = 0;
 
 	return event;
 }
@@ -486,6 +506,7 @@ static struct op_event * new_event(void)
 static void free_event(struct op_event * event)
 {
 	list_del(&event->event_next);
+	events_hashed = 0;
 	free(event);
 }
 
@@ -752,10 +773,33 @@ static void delete_event(struct op_event * event)
 		free(event->desc);
 
 	list_del(&event->event_next);
+	events_hashed = 0;
 	free(event);
 }
 
 
+static void free_mappings(void)
+{
+	struct list_head * pos, * pos2;
+	size_t i;
+
+	if (mapping_cpu == CPU_NO_GOOD)
+		return;
+
+	for (i = 0; i < EVENT_HASH_SIZE; ++i) {
+		list_for_each_safe(pos, pos2, &mapping_hash[i]) {
+			struct event_mapping * mapping =
+				list_entry(pos, struct event_mapping, hash);
+			free(mapping->map);
+			free(mapping);
+		}
+	}
+	free(mapping_filename);
+	mapping_filename = NULL;
+	mapping_cpu = CPU_NO_GOOD;
+}
+
+
 void op_free_events(void)
 {
 	struct list_head * pos, * pos2;
@@ -768,15 +812,44 @@ void op_free_events(void)
 		struct op_unit_mask * unit = list_entry(pos, struct op_unit_mask, um_next);
 		delete_unit_mask(unit);
 	}
+
+	free_mappings();
 }
 
-/* There can be actually multiple events here, so this is not quite correct */
-static struct op_event * find_event_any(u32 nr)
+
+static void hash_events(void)
 {
 	struct list_head * pos;
+	size_t i;
+
+	if (events_hashed)
+		return;
+
+	for (i = 0; i < EVENT_HASH_SIZE; ++i) {
+		list_init(&event_name_hash[i]);
+		list_init(&event_val_hash[i]);
+	}
 
 	list_for_each(pos, &events_list) {
 		struct op_event * event = list_entry(pos, struct op_event, event_next);
+		size_t slot = op_hash_string(event->name) % EVENT_HASH_SIZE;
+		list_add_tail(&event->name_hash, &event_name_hash[slot]);
+		list_add_tail(&event->val_hash,
+		              &event_val_hash[event->val % EVENT_HASH_SIZE]);
+	}
+
+	events_hashed = 1;
+}
+
+/* There can be actually multiple events here, so this is not quite correct */
+static struct op_event * find_event_any(u32 nr)
+{
+	struct list_head * pos;
+
+	hash_events();
+
+	list_for_each(pos, &event_val_hash[nr % EVENT_HASH_SIZE]) {
+		struct op_event * event = list_entry(pos, struct op_event, val_hash);
 		if (event->val == nr)
 			return event;
 	}
@@ -789,8 +862,10 @@ static struct op_event * find_event_um(u32 nr, u32 um)
 	struct list_head * pos;
 	unsigned int i;
 
-	list_for_each(pos, &events_list) {
-		struct op_event * event = list_entry(pos, struct op_event, event_next);
+	hash_events();
+
+	list_for_each(pos, &event_val_hash[nr % EVENT_HASH_SIZE]) {
+		struct op_event * event = list_entry(pos, struct op_event, val_hash);
 		if (event->val == nr) {
 			for (i = 0; i < event->unit->num; i++) {
 				if (event->unit->um[i].value == um)
@@ -804,44 +879,49 @@ static struct op_event * find_event_um(u32 nr, u32 um)
 
 static FILE * open_event_mapping_file(char const * cpu_name)
 {
-	char * ev_map_file;
 	char * dir;
 	dir = getenv("OPROFILE_EVENTS_DIR");
 	if (dir == NULL)
 		dir = OP_DATADIR;
 
-	ev_map_file = xmalloc(strlen(dir) + strlen("/") + strlen(cpu_name) +
+	mapping_filename = xmalloc(strlen(dir) + strlen("/") + strlen(cpu_name) +
 	                    strlen("/") + + strlen("event_mappings") + 1);
-	strcpy(ev_map_file, dir);
-	strcat(ev_map_file, "/");
-
-	strcat(ev_map_file, cpu_name);
-	strcat(ev_map_file, "/");
-	strcat(ev_map_file, "event_mappings");
-	filename = ev_map_file;
-	return (fopen(ev_map_file, "r"));
+	strcpy(mapping_filename, dir);
+	strcat(mapping_filename, "/");
+
+	strcat(mapping_filename, cpu_name);
+	strcat(mapping_filename, "/");
+	strcat(mapping_filename, "event_mappings");
+	filename = mapping_filename;
+	return (fopen(mapping_filename, "r"));
 }
 
 
 /**
  *  This function is PPC64-specific.
  */
-static char const * get_mapping(u32 nr, FILE * fp)
+static void read_mappings(FILE * fp)
 {
 	char * line;
 	char * name;
 	char * value;
 	char const * c;
-	char * map = NULL;
-	int seen_event = 0, seen_mmcr0 = 0, seen_mmcr1 = 0, seen_mmcra = 0;
-	u32 mmcr0 = 0;
-	u64 mmcr1 = 0;
-	u32 mmcra = 0;
-	int event_found = 0;
+	int seen_event, seen_mmcr0, seen_mmcr1, seen_mmcra;
+	u32 evt;
+	u32 mmcr0;
+	u64 mmcr1;
+	u32 mmcra;
+	size_t i;
+
+	for (i = 0; i < EVENT_HASH_SIZE; ++i)
+		list_init(&mapping_hash[i]);
 
 	line_nr = 1;
 	line = op_get_line(fp);
-	while (line && !event_found) {
+	while (line) {
+		struct event_mapping * mapping;
+		struct list_head * pos;
+
 		if (empty_line(line) || comment_line(line))
 			goto next;
 
@@ -849,6 +929,7 @@ static char const * get_mapping(u32 nr, FILE * fp)
 		seen_mmcr0 = 0;
 		seen_mmcr1 = 0;
 		seen_mmcra = 0;
+		evt = 0;
 		mmcr0 = 0;
 		mmcr1 = 0;
 		mmcra = 0;
@@ -856,13 +937,10 @@ static char const * get_mapping(u32 nr, FILE * fp)
 		c = line;
 		while (next_token(&c, &name, &value)) {
 			if (strcmp(name, "event") == 0) {
-				u32 evt;
 				if (seen_event)
 					parse_error("duplicate event tag");
 				seen_event = 1;
 				evt = parse_hex(value);
-				if (evt == nr)
-					event_found = 1;
 				free(value);
 			} else if (strcmp(name, "mmcr0") == 0) {
 				if (seen_mmcr0)
@@ -888,30 +966,56 @@ static char const * get_mapping(u32 nr, FILE * fp)
 
 			free(name);
 		}
+
+		if (!seen_event)
+			goto next;
+
+		/* the first line for an event number is the one used */
+		list_for_each(pos, &mapping_hash[evt % EVENT_HASH_SIZE]) {
+			if (list_entry(pos, struct event_mapping, hash)->nr == evt)
+				goto next;
+		}
+
+		mapping = xmalloc(sizeof(struct event_mapping));
+		mapping->nr = evt;
+		mapping->map = NULL;
+		mapping->line_nr = line_nr;
+		if (seen_mmcr0 && seen_mmcr1 && seen_mmcra) {
+			mapping->map = xmalloc(70);
+			snprintf(mapping->map, 70, "mmcr0:%u mmcr1:%Lu mmcra:%u",
+			         mmcr0, mmcr1, mmcra);
+		}
+		list_add_tail(&mapping->hash, &mapping_hash[evt % EVENT_HASH_SIZE]);
 next:
 		free(line);
 		line = op_get_line(fp);
 		++line_nr;
 	}
-	if (event_found) {
-		if (!seen_mmcr0 || !seen_mmcr1 || !seen_mmcra) {
-			fprintf(stderr, "Error: Missing information in line %d of event mapping file %s\n", line_nr, filename);
-			exit(EXIT_FAILURE);
-		}
-		map = xmalloc(70);
-		snprintf(map, 70, "mmcr0:%u mmcr1:%Lu mmcra:%u",
-		         mmcr0, mmcr1, mmcra);
+}
+
+
+static void load_mappings(op_cpu cpu_type)
+{
+	FILE * fp;
+
+	free_mappings();
+
+	fp = open_event_mapping_file(op_get_cpu_name(cpu_type));
+	if (!fp) {
+		fprintf(stderr, "oprofile: could not open event mapping file %s\n", mapping_filename);
+		exit(EXIT_FAILURE);
 	}
 
-	return map;
+	read_mappings(fp);
+	fclose(fp);
+	mapping_cpu = cpu_type;
 }
 
 
 char const * find_mapping_for_event(u32 nr, op_cpu cpu_type)
 {
-	char const * cpu_name = op_get_cpu_name(cpu_type);
-	FILE * fp = open_event_mapping_file(cpu_name);
-	char const * map = NULL;
+	struct list_head * pos;
+
 	switch (cpu_type) {
 		case CPU_PPC64_970:
 		case CPU_PPC64_970MP:
@@ -922,21 +1026,27 @@ char const * find_mapping_for_event(u32 nr, op_cpu cpu_type)
 		case CPU_PPC64_POWER6:
 		case CPU_PPC64_POWER7:
 		// For ppc64 types of CPU_PPC64_ARCH_V1 and higher, we don't need an event_mappings file
-			if (!fp) {
-				fprintf(stderr, "oprofile: could not open event mapping file %s\n", filename);
-				exit(EXIT_FAILURE);
-			} else {
-				map = get_mapping(nr, fp);
-			}
 			break;
 		default:
-			break;
+			return NULL;
 	}
 
-	if (fp)
-		fclose(fp);
+	if (mapping_cpu != cpu_type)
+		load_mappings(cpu_type);
+
+	list_for_each(pos, &mapping_hash[nr % EVENT_HASH_SIZE]) {
+		struct event_mapping * mapping =
+			list_entry(pos, struct event_mapping, hash);
+		if (mapping->nr != nr)
+			continue;
+		if (!mapping->map) {
+			fprintf(stderr, "Error: Missing information in line %d of event mapping file %s\n", mapping->line_nr, mapping_filename);
+			exit(EXIT_FAILURE);
+		}
+		return mapping->map;
+	}
 
-	return map;
+	return NULL;
 }
 
 static int match_event(int i, struct op_event *event, unsigned um)
@@ -959,8 +1069,10 @@ struct op_event * find_event_by_name(char const * name, unsigned um, int um_vali
 {
 	struct list_head * pos;
 
-	list_for_each(pos, &events_list) {
-		struct op_event * event = list_entry(pos, struct op_event, event_next);
+	hash_events();
+
+	list_for_each(pos, &event_name_hash[op_hash_string(name) % EVENT_HASH_SIZE]) {
+		struct op_event * event = list_entry(pos, struct op_event, name_hash);
 		if (strcmp(event->name, name) == 0) {
 			if (um_valid) {
 				unsigned i;
@@ -978,12 +1090,15 @@ struct op_event * find_event_by_name(char const * name, unsigned um, int um_vali
 }
 
 
+/* e must come from find_event_by_name() */
 static struct op_event * find_next_event(struct op_event * e)
 {
+	struct list_head * slot =
+		&event_name_hash[op_hash_string(e->name) % EVENT_HASH_SIZE];
 	struct list_head * n;
 
-	for (n = e->event_next.next; n != &events_list; n = n->next) {
-		struct op_event * ne = list_entry(n, struct op_event, event_next);
+	for (n = e->name_hash.next; n != slot; n = n->next) {
+		struct op_event * ne = list_entry(n, struct op_event, name_hash);
 		if (!strcmp(e->name, ne->name))
 			return ne;
 	}
@@ -1116,9 +1231,10 @@ int op_check_events(char * evt_name, int ctr, u32 nr, u32 um, op_cpu cpu_type)
 	int ibm_power_proc = _is_ppc64_cpu_type(cpu_type);
 
 	load_events(cpu_type);
+	hash_events();
 
-	list_for_each(pos, &events_list) {
-		struct op_event * event = list_entry(pos, struct op_event, event_next);
+	list_for_each(pos, &event_val_hash[nr % EVENT_HASH_SIZE]) {
+		struct op_event * event = list_entry(pos, struct op_event, val_hash);
 		if (event->val != nr)
 			continue;
 
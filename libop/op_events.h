@@ -75,6 +75,8 @@ struct op_event {
 	int filter;		/**< architecture specific filter or -1 */
 	char * ext;		/**< extended events */
 	struct list_head event_next;   /**< next event in list */
+	struct list_head name_hash;    /**< next event in name hash slot */
+	struct list_head val_hash;     /**< next event in val hash slot */
 };
 
 /** Return the known events list. Idempotent */
@@ -90,7 +92,8 @@ struct op_event * find_event_by_name(char const * name, unsigned um,
 
 /**
  * Find a mapping for a given event ID for architectures requiring additional information
- * from what is held in the events file. 
+ * from what is held in the events file. The mapping file is read once per cpu type, the
+ * returned string is valid until op_free_events().
  */
 char const * find_mapping_for_event(u32 val, op_cpu cpu_type);
 
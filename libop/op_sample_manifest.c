@@ -0,0 +1,462 @@
+/**
+ * @file op_sample_manifest.c
+ * Index of the sample files of a session
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include "op_sample_manifest.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "op_libiberty.h"
+#include "op_growable_buffer.h"
+
+#define MANIFEST_MAGIC "OPMANIF"
+#define MANIFEST_VERSION 1
+/* written in the byte order of the machine, a manifest copied to a machine
+ * of the other byte order is ignored */
+#define MANIFEST_BYTE_ORDER 0x01020304
+
+#define RECORD_PARSED 1
+#define RECORD_CG 2
+
+struct manifest_header {
+	char magic[8];
+	u32 version;
+	u32 byte_order;
+	u64 nr_entries;
+	u64 strtab_size;
+};
+
+/* an entry, strings are offsets in the string table following the records */
+struct manifest_record {
+	u64 mtime;
+	u64 size;
+	u64 nr_nodes;
+	u64 total_samples;
+	u32 path;
+	u32 image;
+	u32 lib_image;
+	u32 event;
+	u32 count;
+	u32 unit_mask;
+	int32_t tgid;
+	int32_t tid;
+	int32_t cpu;
+	u32 flags;
+};
+
+struct op_manifest {
+	struct manifest_record * records;
+	size_t nr_entries;
+	char * strtab;
+	size_t strtab_size;
+};
+
+
+/* "all" or a decimal number */
+static int parse_all_or_int(char const * str, int * value)
+{
+	char * end;
+	long val;
+
+	if (!strcmp(str, "all")) {
+		*value = -1;
+		return 0;
+	}
+
+	errno = 0;
+	val = strtol(str, &end, 10);
+	if (errno || end == str || *end || val < 0)
+		return -1;
+	*value = val;
+	return 0;
+}
+
+
+static int parse_uint(char const * str, int base, unsigned int * value)
+{
+	char * end;
+	unsigned long val;
+
+	errno = 0;
+	val = strtoul(str, &end, base);
+	if (errno || end == str || *end)
+		return -1;
+	*value = val;
+	return 0;
+}
+
+
+/* PP:3.19 event_name.count.unitmask.tgid.tid.cpu */
+static int parse_event_spec(char * spec, struct op_manifest_entry * entry)
+{
+	char * parts[6];
+	size_t i;
+
+	for (i = 0; i < 6; ++i) {
+		parts[i] = spec;
+		spec = strchr(spec, '.');
+		if ((spec == NULL) != (i == 5))
+			return -1;
+		if (spec)
+			*spec++ = '\0';
+		if (!*parts[i])
+			return -1;
+	}
+
+	if (parse_uint(parts[1], 10, &entry->count) ||
+	    parse_uint(parts[2], 0, &entry->unit_mask) ||
+	    parse_all_or_int(parts[3], &entry->tgid) ||
+	    parse_all_or_int(parts[4], &entry->tid) ||
+	    parse_all_or_int(parts[5], &entry->cpu))
+		return -1;
+
+	entry->event = xstrdup(parts[0]);
+	return 0;
+}
+
+
+/* the components first to last - 1 joined as "/a/b" */
+static char * join(char ** components, size_t first, size_t last)
+{
+	size_t len = 1;
+	size_t i;
+	char * result;
+
+	for (i = first; i < last; ++i)
+		len += strlen(components[i]) + 1;
+
+	result = xmalloc(len);
+	result[0] = '\0';
+	for (i = first; i < last; ++i) {
+		strcat(result, "/");
+		strcat(result, components[i]);
+	}
+
+	return result;
+}
+
+
+static int is_image_tag(char const * component)
+{
+	return !strcmp(component, "{root}") || !strcmp(component, "{kern}");
+}
+
+
+/* see parse_filename() in libpp */
+int op_manifest_parse_path(struct op_manifest_entry * entry)
+{
+	char * path = xstrdup(entry->path);
+	char ** components;
+	size_t nr = 1;
+	size_t leaf, i, start;
+	char * p;
+	int ret = -1;
+
+	entry->parsed = 0;
+	entry->image = entry->lib_image = entry->event = NULL;
+	entry->cg = 0;
+
+	for (p = path; *p; ++p) {
+		if (*p == '/')
+			++nr;
+	}
+	components = xmalloc(nr * sizeof(char *));
+	components[0] = path;
+	for (nr = 1, p = path; *p; ++p) {
+		if (*p == '/') {
+			*p = '\0';
+			components[nr++] = p + 1;
+		}
+	}
+	leaf = nr - 1;
+
+	if (!is_image_tag(components[0]))
+		goto out;
+
+	for (i = 1; i < leaf && strcmp(components[i], "{dep}"); ++i)
+		;
+	if (i + 1 >= leaf)
+		goto out;
+	entry->image = join(components, 1, i);
+
+	/* {dep}/ must be followed by {kern}/, {root}/ or {anon...}/ */
+	++i;
+	if (!strncmp(components[i], "{anon", 5)) {
+		if (i + 2 > leaf)
+			goto out;
+		/* no leading '/' for an anon region */
+		p = xmalloc(strlen(components[i]) +
+		            strlen(components[i + 1]) + 2);
+		sprintf(p, "%s/%s", components[i], components[i + 1]);
+		entry->lib_image = p;
+		i += 2;
+	} else {
+		if (!is_image_tag(components[i]))
+			goto out;
+		start = ++i;
+		for (; i < leaf && strcmp(components[i], "{cg}"); ++i)
+			;
+		entry->lib_image = join(components, start, i);
+	}
+
+	if (i < leaf) {
+		if (strcmp(components[i], "{cg}") || i + 2 > leaf)
+			goto out;
+		entry->cg = 1;
+	}
+
+	if (parse_event_spec(components[leaf], entry))
+		goto out;
+
+	entry->parsed = 1;
+	ret = 0;
+out:
+	if (ret)
+		op_manifest_free_parsed(entry);
+	free(components);
+	free(path);
+	return ret;
+}
+
+
+void op_manifest_free_parsed(struct op_manifest_entry * entry)
+{
+	free((char *)entry->image);
+	free((char *)entry->lib_image);
+	free((char *)entry->event);
+	entry->image = entry->lib_image = entry->event = NULL;
+	entry->parsed = 0;
+}
+
+
+/* add a string to the string table, reusing the previous one if equal */
+static u32 add_string(struct growable_buffer * strtab, char const * str,
+                      u32 * last)
+{
+	size_t len;
+	u32 offset;
+
+	if (!str)
+		str = "";
+	len = strlen(str) + 1;
+
+	if (strtab->size && *last + len <= strtab->size &&
+	    !memcmp((char *)strtab->p + *last, str, len))
+		return *last;
+
+	offset = strtab->size;
+	add_data(strtab, str, len);
+	*last = offset;
+	return offset;
+}
+
+
+static int write_all(FILE * fp, void const * data, size_t size)
+{
+	if (size && fwrite(data, size, 1, fp) != 1)
+		return -1;
+	return 0;
+}
+
+
+int op_write_manifest(char const * dir, struct op_manifest_entry const * entries,
+                      size_t nr_entries)
+{
+	struct manifest_header header;
+	struct manifest_record * records;
+	struct growable_buffer strtab;
+	u32 last_image = 0, last_lib_image = 0, last_event = 0, unused = 0;
+	char * name;
+	char * tmp_name;
+	FILE * fp;
+	size_t i;
+	int ret = -1;
+	int saved_errno;
+
+	records = xmalloc(nr_entries * sizeof(*records) + 1);
+	init_buffer(&strtab);
+
+	for (i = 0; i < nr_entries; ++i) {
+		struct op_manifest_entry const * entry = &entries[i];
+		struct manifest_record * record = &records[i];
+
+		memset(record, 0, sizeof(*record));
+		record->mtime = entry->mtime;
+		record->size = entry->size;
+		record->nr_nodes = entry->nr_nodes;
+		record->total_samples = entry->total_samples;
+		record->path = add_string(&strtab, entry->path, &unused);
+		record->image = add_string(&strtab, entry->image, &last_image);
+		record->lib_image = add_string(&strtab, entry->lib_image,
+		                               &last_lib_image);
+		record->event = add_string(&strtab, entry->event, &last_event);
+		record->count = entry->count;
+		record->unit_mask = entry->unit_mask;
+		record->tgid = entry->tgid;
+		record->tid = entry->tid;
+		record->cpu = entry->cpu;
+		if (entry->parsed)
+			record->flags |= RECORD_PARSED;
+		if (entry->cg)
+			record->flags |= RECORD_CG;
+	}
+
+	memset(&header, 0, sizeof(header));
+	strcpy(header.magic, MANIFEST_MAGIC);
+	header.version = MANIFEST_VERSION;
+	header.byte_order = MANIFEST_BYTE_ORDER;
+	header.nr_entries = nr_entries;
+	header.strtab_size = strtab.size;
+
+	name = xmalloc(strlen(dir) + strlen("/" OP_MANIFEST_NAME ".tmp") + 1);
+	sprintf(name, "%s/%s", dir, OP_MANIFEST_NAME);
+	tmp_name = xmalloc(strlen(name) + strlen(".tmp") + 1);
+	sprintf(tmp_name, "%s.tmp", name);
+
+	fp = fopen(tmp_name, "w");
+	if (fp) {
+		if (!write_all(fp, &header, sizeof(header)) &&
+		    !write_all(fp, records, nr_entries * sizeof(*records)) &&
+		    !write_all(fp, strtab.p, strtab.size))
+			ret = 0;
+		if (fclose(fp))
+			ret = -1;
+		if (!ret)
+			ret = rename(tmp_name, name);
+		saved_errno = errno;
+		if (ret)
+			unlink(tmp_name);
+		errno = saved_errno;
+	}
+
+	free(tmp_name);
+	free(name);
+	free_buffer(&strtab);
+	free(records);
+	return ret;
+}
+
+
+static int read_all(FILE * fp, void * data, size_t size)
+{
+	if (size && fread(data, size, 1, fp) != 1)
+		return -1;
+	return 0;
+}
+
+
+struct op_manifest * op_read_manifest(char const * dir)
+{
+	struct manifest_header header;
+	struct op_manifest * manifest = NULL;
+	struct stat st;
+	u64 records_size;
+	char * name;
+	FILE * fp;
+	size_t i;
+
+	name = xmalloc(strlen(dir) + strlen("/" OP_MANIFEST_NAME) + 1);
+	sprintf(name, "%s/%s", dir, OP_MANIFEST_NAME);
+	fp = fopen(name, "r");
+	free(name);
+	if (!fp)
+		return NULL;
+
+	if (fstat(fileno(fp), &st) ||
+	    read_all(fp, &header, sizeof(header)) ||
+	    memcmp(header.magic, MANIFEST_MAGIC, sizeof(MANIFEST_MAGIC)) ||
+	    header.version != MANIFEST_VERSION ||
+	    header.byte_order != MANIFEST_BYTE_ORDER)
+		goto fail;
+
+	/* check sizes before trusting them for allocations */
+	if (header.nr_entries > (u64)st.st_size / sizeof(struct manifest_record))
+		goto fail;
+	records_size = header.nr_entries * sizeof(struct manifest_record);
+	if (sizeof(header) + records_size > (u64)st.st_size ||
+	    header.strtab_size != st.st_size - sizeof(header) - records_size ||
+	    header.strtab_size > 0xffffffffULL)
+		goto fail;
+
+	manifest = xmalloc(sizeof(*manifest));
+	manifest->nr_entries = header.nr_entries;
+	manifest->strtab_size = header.strtab_size;
+	manifest->records = xmalloc(manifest->nr_entries *
+	                            sizeof(struct manifest_record) + 1);
+	manifest->strtab = xmalloc(manifest->strtab_size + 1);
+
+	if (read_all(fp, manifest->records, records_size) ||
+	    read_all(fp, manifest->strtab, manifest->strtab_size))
+		goto fail;
+
+	/* all strings must be nul terminated inside the table */
+	if (manifest->strtab_size &&
+	    manifest->strtab[manifest->strtab_size - 1] != '\0')
+		goto fail;
+	for (i = 0; i < manifest->nr_entries; ++i) {
+		struct manifest_record const * record = &manifest->records[i];
+		if (record->path >= manifest->strtab_size ||
+		    record->image >= manifest->strtab_size ||
+		    record->lib_image >= manifest->strtab_size ||
+		    record->event >= manifest->strtab_size)
+			goto fail;
+	}
+
+	fclose(fp);
+	return manifest;
+
+fail:
+	fclose(fp);
+	op_free_manifest(manifest);
+	return NULL;
+}
+
+
+size_t op_manifest_nr_entries(struct op_manifest const * manifest)
+{
+	return manifest->nr_entries;
+}
+
+
+void op_manifest_get_entry(struct op_manifest const * manifest, size_t index,
+                           struct op_manifest_entry * entry)
+{
+	struct manifest_record const * record = &manifest->records[index];
+
+	entry->path = manifest->strtab + record->path;
+	entry->parsed = !!(record->flags & RECORD_PARSED);
+	entry->image = manifest->strtab + record->image;
+	entry->lib_image = manifest->strtab + record->lib_image;
+	entry->cg = !!(record->flags & RECORD_CG);
+	entry->event = manifest->strtab + record->event;
+	entry->count = record->count;
+	entry->unit_mask = record->unit_mask;
+	entry->tgid = record->tgid;
+	entry->tid = record->tid;
+	entry->cpu = record->cpu;
+	entry->mtime = record->mtime;
+	entry->size = record->size;
+	entry->nr_nodes = record->nr_nodes;
+	entry->total_samples = record->total_samples;
+}
+
+
+void op_free_manifest(struct op_manifest * manifest)
+{
+	if (!manifest)
+		return;
+	free(manifest->records);
+	free(manifest->strtab);
+	free(manifest);
+}
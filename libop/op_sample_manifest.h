@@ -0,0 +1,110 @@
+/**
+ * @file op_sample_manifest.h
+ * Index of the sample files of a session
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#ifndef OP_SAMPLE_MANIFEST_H
+#define OP_SAMPLE_MANIFEST_H
+
+#include <stddef.h>
+
+#include "op_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * name of the manifest file in a session samples directory, e.g.
+ * samples/current/manifest; it is removed when operf starts converting
+ * samples into the session and written again when it is done
+ */
+#define OP_MANIFEST_NAME "manifest"
+
+/** what is known of a sample file */
+struct op_manifest_entry {
+	/** path relative to the session samples directory */
+	char const * path;
+	/** true if the fields below path could be parsed from it */
+	int parsed;
+	/** path components up to {dep}, e.g. "/bin/ls" */
+	char const * image;
+	/** path components between {dep}/{root} and the event spec or {cg},
+	 * for an anon region the {anon:...}/tgid.start.end components */
+	char const * lib_image;
+	/** true for a call graph file */
+	int cg;
+	char const * event;
+	unsigned int count;
+	unsigned int unit_mask;
+	/** -1 for "all" */
+	int tgid;
+	int tid;
+	int cpu;
+	/** mtime and size of the sample file when the entry was written */
+	u64 mtime;
+	u64 size;
+	/** number of nodes with a non zero count, and total of the counts */
+	u64 nr_nodes;
+	u64 total_samples;
+};
+
+/**
+ * op_manifest_parse_path - fill the parsed fields of an entry
+ * @param entry  entry whose path is set
+ *
+ * The strings set are allocated, see op_manifest_free_parsed(). Returns
+ * 0 and sets entry->parsed if the path is a sample filename as built by
+ * op_mangle_filename(), else returns -1.
+ */
+int op_manifest_parse_path(struct op_manifest_entry * entry);
+
+/**
+ * op_manifest_free_parsed - free the strings set by op_manifest_parse_path()
+ */
+void op_manifest_free_parsed(struct op_manifest_entry * entry);
+
+/**
+ * op_write_manifest - write the manifest of a session
+ * @param dir  the session samples directory
+ * @param entries  one entry per sample file
+ * @param nr_entries  number of entries
+ *
+ * The manifest is written to a temporary file renamed over the previous
+ * manifest. Returns 0 on success, -1 with errno set on failure.
+ */
+int op_write_manifest(char const * dir, struct op_manifest_entry const * entries,
+                      size_t nr_entries);
+
+struct op_manifest;
+
+/**
+ * op_read_manifest - read the manifest of a session
+ * @param dir  the session samples directory
+ *
+ * Returns NULL if there is no manifest or it is not valid.
+ */
+struct op_manifest * op_read_manifest(char const * dir);
+
+/** return the number of entries of a manifest */
+size_t op_manifest_nr_entries(struct op_manifest const * manifest);
+
+/**
+ * op_manifest_get_entry - read one entry of a manifest
+ *
+ * The strings of entry point into the manifest and are valid until
+ * op_free_manifest().
+ */
+void op_manifest_get_entry(struct op_manifest const * manifest, size_t index,
+                           struct op_manifest_entry * entry);
+
+void op_free_manifest(struct op_manifest * manifest);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OP_SAMPLE_MANIFEST_H */
@@ -0,0 +1,126 @@
+/**
+ * @file manifest_tests.c
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "op_sample_manifest.h"
+
+struct parse_test {
+	char const * path;
+	int parsed;
+	char const * image;
+	char const * lib_image;
+	int cg;
+	char const * event;
+	unsigned int count;
+	unsigned int unit_mask;
+	int tgid;
+	int tid;
+	int cpu;
+};
+
+static struct parse_test const parse_tests[] = {
+	{ "{root}/bar/{dep}/{root}/foo/EVENT.0.0.all.all.all",
+	  1, "/bar", "/foo", 0, "EVENT", 0, 0, -1, -1, -1 },
+	{ "{kern}/bar/{dep}/{kern}/foo/EVENT.1234.0x20.34.35.2",
+	  1, "/bar", "/foo", 0, "EVENT", 1234, 0x20, 34, 35, 2 },
+	{ "{root}/bar1/bar2/{dep}/{root}/foo1/foo2/{cg}/{root}/to/EVENT.10.0.all.all.all",
+	  1, "/bar1/bar2", "/foo1/foo2", 1, "EVENT", 10, 0, -1, -1, -1 },
+	{ "{root}/bar/{dep}/{anon:anon}/1234.0x1000.0x2000/EVENT.10.0.all.all.all",
+	  1, "/bar", "{anon:anon}/1234.0x1000.0x2000", 0, "EVENT", 10, 0, -1, -1, -1 },
+	/* not sample files */
+	{ "{root}/bar/EVENT.10.0.all.all.all", 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+	{ "{root}/bar/{dep}/{root}/foo/EVENT.10.0.all.all", 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+	{ "{root}/bar/{dep}/{root}/foo/EVENT.x.0.all.all.all", 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+	{ "{root}/bar/{dep}/{xxx}/foo/EVENT.10.0.all.all.all", 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+	{ "stats/total_samples", 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+	{ NULL, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }
+};
+
+
+static int check_entry(struct op_manifest_entry const * entry,
+                       struct parse_test const * test)
+{
+	if (entry->parsed != test->parsed)
+		return 0;
+	if (!entry->parsed)
+		return 1;
+	return !strcmp(entry->image, test->image) &&
+		!strcmp(entry->lib_image, test->lib_image) &&
+		entry->cg == test->cg &&
+		!strcmp(entry->event, test->event) &&
+		entry->count == test->count &&
+		entry->unit_mask == test->unit_mask &&
+		entry->tgid == test->tgid &&
+		entry->tid == test->tid &&
+		entry->cpu == test->cpu;
+}
+
+
+int main(void)
+{
+	struct op_manifest_entry entries[sizeof(parse_tests) / sizeof(parse_tests[0])];
+	struct op_manifest * manifest;
+	char dir[] = "/tmp/manifest_tests.XXXXXX";
+	char name[sizeof(dir) + sizeof("/" OP_MANIFEST_NAME)];
+	size_t nr, i;
+
+	for (nr = 0; parse_tests[nr].path; ++nr) {
+		struct op_manifest_entry * entry = &entries[nr];
+
+		memset(entry, 0, sizeof(*entry));
+		entry->path = parse_tests[nr].path;
+		op_manifest_parse_path(entry);
+		if (!check_entry(entry, &parse_tests[nr])) {
+			fprintf(stderr, "parse of %s failed\n", entry->path);
+			exit(EXIT_FAILURE);
+		}
+		entry->size = nr;
+		entry->total_samples = nr * 1000;
+	}
+
+	if (!mkdtemp(dir)) {
+		perror("mkdtemp");
+		exit(EXIT_FAILURE);
+	}
+
+	if (op_write_manifest(dir, entries, nr)) {
+		perror("op_write_manifest");
+		exit(EXIT_FAILURE);
+	}
+
+	manifest = op_read_manifest(dir);
+	if (!manifest || op_manifest_nr_entries(manifest) != nr) {
+		fprintf(stderr, "op_read_manifest() failed\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (i = 0; i < nr; ++i) {
+		struct op_manifest_entry entry;
+
+		op_manifest_get_entry(manifest, i, &entry);
+		if (strcmp(entry.path, parse_tests[i].path) ||
+		    !check_entry(&entry, &parse_tests[i]) ||
+		    entry.size != i || entry.total_samples != i * 1000) {
+			fprintf(stderr, "entry %s not read back\n",
+			        parse_tests[i].path);
+			exit(EXIT_FAILURE);
+		}
+		op_manifest_free_parsed(&entries[i]);
+	}
+
+	op_free_manifest(manifest);
+
+	sprintf(name, "%s/%s", dir, OP_MANIFEST_NAME);
+	unlink(name);
+	rmdir(dir);
+
+	return EXIT_SUCCESS;
+}
@@ -32,6 +32,9 @@
 #include "op_libiberty.h"
 #include "operf_stats.h"
 #include "op_pe_utils.h"
+#include "operf_sample_writer.h"
+#include "operf_record_writer.h"
+#include "operf_shm_ring.h"
 
 
 using namespace std;
@@ -155,6 +158,46 @@ out:
 	return rc;
 }
 
+/* Return the next event from the sample data ring.  It is parsed in place
+ * when it is contiguous in the ring, and copied to scratch otherwise.
+ * Either way, it remains valid until the caller consumes it from the ring.
+ * Returns NULL once the operf_record process is gone and the ring is drained.
+ */
+static event_t * _get_perf_event_from_ring(operf_shm_ring * ring, event_t * scratch)
+{
+	static size_t pe_header_size = sizeof(perf_event_header);
+	perf_event_header header;
+	unsigned char const * evt;
+	size_t contiguous;
+
+again:
+	if (ring->wait_for_data(pe_header_size) < pe_header_size)
+		return NULL;
+	ring->copy_out(&header, pe_header_size);
+
+	if (header.size == pe_header_size) {
+		// empty record, see _get_perf_event_from_pipe
+		ring->consume(pe_header_size);
+		goto again;
+	}
+
+	if (header.size < pe_header_size) {
+		// bogus header size, caught by the caller's is_header_valid()
+		memcpy(scratch, &header, pe_header_size);
+		return scratch;
+	}
+
+	if (ring->wait_for_data(header.size) < header.size)
+		return NULL;
+
+	evt = ring->read_ptr(contiguous);
+	if (contiguous >= header.size && !((unsigned long)evt & 7))
+		return (event_t *)evt;
+
+	ring->copy_out(scratch, header.size);
+	return scratch;
+}
+
 static event_t * _get_perf_event_from_file(struct mmap_info & info)
 {
 	uint32_t size = 0;
@@ -292,6 +335,8 @@ int operf_counter::perf_event_open(pid_t pid, int cpu, operf_record * rec, bool
 operf_record::~operf_record()
 {
 	cverb << vrecord << "operf_record::~operf_record()" << endl;
+	// recordPerfData may have thrown before stopping the writer thread
+	delete writer;
 	opHeader.data_size = total_bytes_recorded;
 	// If recording to a file, we re-write the op_header info
 	// in order to update the data_size field.
@@ -334,6 +379,8 @@ operf_record::operf_record(int out_fd, bool sys_wide, pid_t the_pid, bool pid_ru
 	evts = events;
 	valid = false;
 	poll_data = NULL;
+	writer = NULL;
+	output_ring = NULL;
 	num_mmaps = 0;
 	output_fd = out_fd;
 	read_comm_pipe = _convert_read_pipe;
@@ -759,6 +806,35 @@ void operf_record::record_process_info(void)
 	}
 }
 
+void operf_record::start_writer(void)
+{
+	writer = new operf_record_writer(output_fd, samples_array.size(), output_ring);
+	if (!writer->start()) {
+		cerr << "Unable to create the sample data writer thread, "
+		     << "writing sample data synchronously." << endl;
+		delete writer;
+		writer = NULL;
+	}
+}
+
+void operf_record::stop_writer(void)
+{
+	if (!writer)
+		return;
+
+	// Once stopped, the writer must not be used by the destructor even
+	// if stop() throws on an earlier write error.
+	operf_record_writer * w = writer;
+	writer = NULL;
+	try {
+		total_bytes_recorded += w->stop();
+	} catch (...) {
+		delete w;
+		throw;
+	}
+	delete w;
+}
+
 int operf_record::_start_recoding_new_thread(pid_t id)
 {
 	string err_msg;
@@ -829,12 +905,16 @@ int operf_record::_start_recoding_new_thread(pid_t id)
 void operf_record::recordPerfData(void)
 {
 	bool disabled = false;
+	// the header went through output_fd, everything else goes to the ring
+	if (output_ring)
+		op_set_output_ring(output_ring);
 	if (pid_started || system_wide)
 		record_process_info();
 	else
 		op_get_vsyscall_mapping(pid_to_profile, output_fd, this);
 
 	op_record_kernel_info(vmlinux_file, kernel_start, kernel_end, output_fd, this);
+	start_writer();
 	cerr << "operf: Profiler started" << endl;
 	while (1) {
 		int prev = sample_reads;
@@ -843,7 +923,7 @@ void operf_record::recordPerfData(void)
 
 		for (size_t i = 0; i < samples_array.size(); i++) {
 			if (samples_array[i].base)
-				op_get_kernel_event_data(&samples_array[i], this);
+				op_get_kernel_event_data(&samples_array[i], i, this);
 		}
 		if (quit && disabled)
 			break;
@@ -873,6 +953,7 @@ void operf_record::recordPerfData(void)
 			cverb << vrecord << "operf_record::recordPerfData received signal to quit." << endl;
 		}
 	}
+	stop_writer();
 
 	cverb << vdebug << "operf recording finished." << endl;
 }
@@ -1090,6 +1171,8 @@ unsigned int operf_read::convertPerfData(void)
 	struct mmap_info info;
 	bool error = false;
 	event_t * event = NULL;
+	event_t * scratch = NULL;
+	unsigned long num_copied = 0;
 
 	if (fcntl(post_profiling_pipe, F_SETFL, O_NONBLOCK) < 0) {
 		cerr << "Error: fcntl failed with errno:\n\t" << strerror(errno) << endl;
@@ -1115,13 +1198,15 @@ unsigned int operf_read::convertPerfData(void)
 		}
 	} else {
 		// Allocate way more than enough space for a really big event with a long callchain
-		event = (event_t *)xmalloc(65536);
-		memset(event, '\0', 65536);
+		scratch = (event_t *)xmalloc(65536);
+		memset(scratch, '\0', 65536);
 	}
 
 	for (int i = 0; i < OPERF_MAX_STATS; i++)
 		operf_stats[i] = 0;
 
+	operf_writers_start(operf_options::convert_threads);
+
 	ostringstream message;
 	message << "Converting operf data to oprofile sample data format" << endl;
 	message << "sample type is " << hex <<  opHeader.h_attrs[0].attr.sample_type << endl;
@@ -1137,7 +1222,14 @@ unsigned int operf_read::convertPerfData(void)
 			event = _get_perf_event_from_file(info);
 			if (event == NULL)
 				break;
+		} else if (input_ring) {
+			event = _get_perf_event_from_ring(input_ring, scratch);
+			if (event == NULL)
+				break;
+			if (event == scratch)
+				num_copied++;
 		} else {
+			event = scratch;
 			if (_get_perf_event_from_pipe(event, sample_data_fd) < 0)
 				break;
 		}
@@ -1151,6 +1243,8 @@ unsigned int operf_read::convertPerfData(void)
 		}
 		num_bytes += rec_size;
 		num_recs++;
+		if (input_ring)
+			input_ring->consume(rec_size);
 		if ((num_recs % 1000000 == 0) && (print_progress || _print_pp_progress(post_profiling_pipe))) {
 			if (!printed_progress_msg) {
 				cerr << "\nConverting profile data to OProfile format " << endl;
@@ -1178,7 +1272,11 @@ unsigned int operf_read::convertPerfData(void)
 
 	if (printed_progress_msg)
 		cerr << endl;
+	if (input_ring)
+		cverb << vdebug << "Parsed " << num_recs - num_copied << " of " << num_recs
+		      << " events in place in the sample data ring" << endl;
 
+	operf_writers_stop();
 	op_release_resources();
 	operf_print_stats(operf_options::session_dir, start_time_human_readable, throttled, evts);
 
@@ -1191,6 +1289,6 @@ unsigned int operf_read::convertPerfData(void)
 	if (!inputFname.empty())
 		close(info.traceFD);
 	else
-		free(event);
+		free(scratch);
 	return num_bytes;
 }
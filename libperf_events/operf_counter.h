@@ -37,6 +37,8 @@
 extern char * start_time_human_readable;
 
 class operf_record;
+class operf_record_writer;
+class operf_shm_ring;
 
 #define OP_BASIC_SAMPLE_FORMAT (PERF_SAMPLE_ID | PERF_SAMPLE_IP \
     | PERF_SAMPLE_TID)
@@ -93,6 +95,11 @@ public:
 	unsigned int get_total_bytes_recorded(void) const { return total_bytes_recorded; }
 	void register_perf_event_id(unsigned counter, u64 id, perf_event_attr evt_attr);
 	bool get_valid(void) { return valid; }
+	operf_record_writer * get_writer(void) const { return writer; }
+	/* Send the sample data through ring rather than writing it to output_fd,
+	 * which must then be ring's socket.  The header is still written to output_fd.
+	 */
+	void set_output_ring(operf_shm_ring * ring) { output_ring = ring; }
 
 private:
 	void create(std::string outfile, std::vector<operf_event_t> & evts);
@@ -101,6 +108,8 @@ private:
 	int _prepare_to_record_one_fd(int idx, int fd);
 	int _start_recoding_new_thread(pid_t id);
 	void record_process_info(void);
+	void start_writer(void);
+	void stop_writer(void);
 	void write_op_header_info(void);
 	int _write_header_to_file(void);
 	int _write_header_to_pipe(void);
@@ -111,6 +120,11 @@ private:
 	// Array of size 'num_cpus_used_for_perf_event_open * num_pids * num_events'
 	struct pollfd * poll_data;
 	std::vector<struct mmap_data> samples_array;
+	/* Writes out the sample data drained from samples_array while
+	 * recording; NULL if the data is written synchronously.
+	 */
+	operf_record_writer * writer;
+	operf_shm_ring * output_ring;
 	int num_mmaps;
 	int num_cpus;
 	pid_t pid_to_profile;
@@ -137,7 +151,8 @@ private:
 class operf_read {
 public:
 	operf_read(std::vector<operf_event_t> & _evts)
-	: sample_data_fd(-1), inputFname(""), evts(_evts), cpu_type(CPU_NO_GOOD)
+	: sample_data_fd(-1), input_ring(NULL), inputFname(""), evts(_evts),
+	  cpu_type(CPU_NO_GOOD)
 	  { valid = syswide = false;
 	  write_comm_pipe = read_comm_pipe = 1;
 	  post_profiling_pipe = -1; }
@@ -153,9 +168,14 @@ public:
 	int get_write_comm_pipe(void) { return write_comm_pipe; }
 	int get_read_comm_pipe(void)  { return read_comm_pipe; }
 	void add_sample_id_to_opHeader(u64 sample_id);
+	/* Read the sample data following the header from ring rather than
+	 * from the sample data pipe; see operf_record::set_output_ring().
+	 */
+	void set_input_ring(operf_shm_ring * ring) { input_ring = ring; }
 
 private:
 	int sample_data_fd;
+	operf_shm_ring * input_ring;
 	int write_comm_pipe;
 	int read_comm_pipe;
 	int post_profiling_pipe;
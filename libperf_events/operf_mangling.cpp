@@ -19,6 +19,7 @@
 #include "operf_kernel.h"
 #include "operf_sfile.h"
 #include "operf_counter.h"
+#include "operf_sample_writer.h"
 #include "op_file.h"
 #include "op_sample_file.h"
 #include "op_mangle.h"
@@ -150,6 +151,12 @@ int operf_open_sample_file(odb_t *file, struct operf_sfile *last,
 		goto out;
 	}
 
+	/* odb_open() may share an odb_data_t already being updated by a
+	 * writer thread, and we write the header below.  Updates still
+	 * aggregated in memory don't touch the mapping and can stay there.
+	 */
+	operf_writers_wait();
+
 	/* locking sf will lock associated cg files too */
 	operf_sfile_get(sf);
 	if (sf != last)
@@ -20,6 +20,7 @@
 #include <iostream>
 #include <sstream>
 #include <map>
+#include <algorithm>
 #include <string.h>
 #include <errno.h>
 #include "operf_process_info.h"
@@ -32,7 +33,8 @@ using namespace OP_perf_utils;
 operf_process_info::operf_process_info(pid_t tgid, const char * appname,
                                        bool app_arg_is_fullname, bool is_valid)
 : pid(tgid), valid(is_valid), appname_valid(false), look_for_appname_match(false),
-  forked(false), appname_is_fullname(NOT_FULLNAME), num_app_chars_matched(-1)
+  forked(false), appname_is_fullname(NOT_FULLNAME), num_app_chars_matched(-1),
+  mapping_index_valid(false), mappings_overlap(false), last_hit(NULL)
 {
 	_appname = "";
 	set_appname(appname, app_arg_is_fullname);
@@ -217,16 +219,72 @@ void operf_process_info::find_best_match_appname_all_mappings(void)
 
 }
 
+struct operf_process_info::start_addr_less {
+	bool operator()(u64 addr, mapping_index_entry const & entry) const {
+		return addr < entry.start_addr;
+	}
+};
+
+void operf_process_info::invalidate_mapping_index(void)
+{
+	mapping_index_valid = false;
+	last_hit = NULL;
+}
+
+void operf_process_info::build_mapping_index(void)
+{
+	map<u64, struct operf_mmap *>::const_iterator it;
+	u64 max_end = 0ULL;
+
+	mapping_index.clear();
+	mapping_index.reserve(mmappings.size());
+	mappings_overlap = false;
+	for (it = mmappings.begin(); it != mmappings.end(); it++) {
+		mapping_index_entry entry;
+		entry.start_addr = it->second->start_addr;
+		entry.end_addr = it->second->end_addr;
+		entry.mapping = it->second;
+		if (!mapping_index.empty() && entry.start_addr <= max_end)
+			mappings_overlap = true;
+		max_end = max(max_end, entry.end_addr);
+		entry.max_end_addr = max_end;
+		mapping_index.push_back(entry);
+	}
+	mapping_index_valid = true;
+	last_hit = NULL;
+}
+
+/* Returns the mapping with the lowest start address which contains sample_addr,
+ * as a linear walk of mmappings would.  Samples usually come in runs from the
+ * same mapping, so the last match is tried first.
+ */
 const struct operf_mmap * operf_process_info::find_mapping_for_sample(u64 sample_addr, bool hypervisor_sample)
 {
-	map<u64, struct operf_mmap *>::iterator it = mmappings.begin();
-	while (it != mmappings.end()) {
-		if (sample_addr >= it->second->start_addr && sample_addr <= it->second->end_addr &&
-				it->second->is_hypervisor == hypervisor_sample)
-			return it->second;
-		it++;
+	const struct operf_mmap * found = NULL;
+
+	if (!mapping_index_valid)
+		build_mapping_index();
+
+	if (last_hit && sample_addr >= last_hit->start_addr &&
+	    sample_addr <= last_hit->end_addr &&
+	    last_hit->is_hypervisor == hypervisor_sample)
+		return last_hit;
+
+	vector<mapping_index_entry>::const_iterator it =
+		upper_bound(mapping_index.begin(), mapping_index.end(),
+		            sample_addr, start_addr_less());
+	while (it != mapping_index.begin()) {
+		--it;
+		if (it->max_end_addr < sample_addr)
+			break;
+		if (sample_addr <= it->end_addr &&
+		    it->mapping->is_hypervisor == hypervisor_sample)
+			found = it->mapping;
 	}
-	return NULL;
+
+	if (found && !mappings_overlap)
+		last_hit = found;
+	return found;
 }
 
 /**
@@ -264,11 +322,14 @@ void operf_process_info::process_hypervisor_mapping(u64 ip)
 			curr_end = _mmap->end_addr;
 			if (curr_start > ip) {
 				mmappings.erase(it);
+				invalidate_mapping_index();
 				delete _mmap;
 			} else {
 				create_new_hyperv_mmap = false;
-				if (curr_end <= ip)
+				if (curr_end <= ip) {
 					_mmap->end_addr = ip;
+					invalidate_mapping_index();
+				}
 			}
 			break;
 		}
@@ -372,6 +433,7 @@ void operf_process_info::try_disassociate_from_parent(char * app_shortname)
 		if (mmappings_from_parent[cur->start_addr]) {
 			mmappings_from_parent[cur->start_addr] = false;
 			mmappings.erase(it++);
+			invalidate_mapping_index();
 		} else {
 			process_mapping(cur, false);
 			it++;
@@ -408,6 +470,7 @@ void operf_process_info::set_new_mapping_recursive(struct operf_mmap * mapping,
 		mmappings_from_parent[mapping->start_addr] = false;
 	}
 	mmappings[mapping->start_addr] = mapping;
+	invalidate_mapping_index();
 	std::vector<operf_process_info *>::iterator it = forked_processes.begin();
 	while (it != forked_processes.end()) {
 		operf_process_info * fp = *it;
@@ -15,6 +15,7 @@
 #define OPERF_PROCESS_INFO_H_
 
 #include <map>
+#include <vector>
 #include <limits.h>
 #include "op_types.h"
 #include "cverb.h"
@@ -89,6 +90,27 @@ private:
 	int  num_app_chars_matched;
 	std::map<u64, struct operf_mmap *> mmappings;
 	std::map<u64, bool> mmappings_from_parent;
+	/* find_mapping_for_sample() is called for every user space sample, so
+	 * we keep a copy of mmappings sorted by start address, rebuilt lazily
+	 * whenever mmappings changes, allowing a binary search.  max_end_addr
+	 * is the highest end_addr among this entry and all its predecessors,
+	 * which bounds the backward walk needed to honour overlapping mappings.
+	 */
+	struct mapping_index_entry {
+		u64 start_addr;
+		u64 end_addr;
+		u64 max_end_addr;
+		struct operf_mmap * mapping;
+	};
+	struct start_addr_less;
+	std::vector<mapping_index_entry> mapping_index;
+	bool mapping_index_valid;
+	/* true if any two mappings overlap; the last_hit cache is only
+	 * used when they don't, since with overlaps the lowest matching
+	 * mapping must be returned.
+	 */
+	bool mappings_overlap;
+	const struct operf_mmap * last_hit;
 	/* When a FORK event is received, we associate that forked process
 	 * with its parent by adding it to the parent's forked_processes
 	 * collection. The main reason we need this collection is because
@@ -104,6 +126,8 @@ private:
 	void set_new_mapping_recursive(struct operf_mmap * mapping, bool do_self);
 	int get_num_matching_chars(std::string mapped_filename, std::string & basename);
 	void find_best_match_appname_all_mappings(void);
+	void build_mapping_index(void);
+	void invalidate_mapping_index(void);
 };
 
 
@@ -0,0 +1,303 @@
+/**
+ * @file libperf_events/operf_record_writer.cpp
+ * Decouple draining of the perf_events ring buffers from writing the
+ * sample data to the output file or pipe.
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <iostream>
+#include <stdexcept>
+
+#include "operf_record_writer.h"
+#include "operf_shm_ring.h"
+#include "cverb.h"
+
+extern verbose vrecord;
+
+using namespace std;
+
+struct operf_record_writer::chunk {
+	size_t ring;
+	size_t size;
+	struct timeval copied;
+	unsigned char data[1];
+};
+
+namespace {
+
+/** number of chunks the recording thread can queue before it blocks */
+size_t const nr_slots = 256;
+
+/** max number of chunks written by one writev() */
+#ifdef IOV_MAX
+size_t const max_batch = IOV_MAX < 1024 ? IOV_MAX : 1024;
+#else
+size_t const max_batch = 16;
+#endif
+
+
+u64 elapsed_us(struct timeval const & from, struct timeval const & to)
+{
+	return (to.tv_sec - from.tv_sec) * 1000000ULL
+		+ to.tv_usec - from.tv_usec;
+}
+
+
+void sem_wait_nointr(sem_t * sem)
+{
+	while (sem_wait(sem) < 0 && errno == EINTR)
+		;
+}
+
+}  // anonymous namespace
+
+
+operf_record_writer::operf_record_writer(int fd, size_t nr_rings,
+                                         operf_shm_ring * shm_ring)
+	:
+	output_fd(fd),
+	output_ring(shm_ring),
+	running(false),
+	filling(NULL),
+	slots(new chunk *[nr_slots]),
+	head(0),
+	tail(0),
+	stats(nr_rings, ring_stats()),
+	bytes_written(0),
+	nr_writes(0),
+	failed(false)
+{
+	sem_init(&free_slots, 0, nr_slots);
+	sem_init(&used_slots, 0, 0);
+}
+
+
+operf_record_writer::~operf_record_writer()
+{
+	if (running) {
+		try {
+			stop();
+		} catch (runtime_error const &) {
+			// already reported by whoever threw first
+		}
+	}
+	free(filling);
+	sem_destroy(&used_slots);
+	sem_destroy(&free_slots);
+	delete [] slots;
+}
+
+
+bool operf_record_writer::start(void)
+{
+	sigset_t all, old;
+
+	// Signals must keep going to the recording thread, which relies on
+	// them to interrupt its poll().
+	sigfillset(&all);
+	pthread_sigmask(SIG_BLOCK, &all, &old);
+	running = pthread_create(&thread, NULL, writer_thread, this) == 0;
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	return running;
+}
+
+
+unsigned char * operf_record_writer::new_chunk(size_t ring, size_t size)
+{
+	filling = (chunk *)realloc(filling, offsetof(chunk, data) + size);
+	if (!filling)
+		throw runtime_error("Unable to allocate memory for sample data");
+	filling->ring = ring;
+	filling->size = size;
+	return filling->data;
+}
+
+
+void operf_record_writer::queue_chunk(void)
+{
+	if (failed)
+		throw runtime_error(error);
+
+	gettimeofday(&filling->copied, NULL);
+	push(filling);
+	filling = NULL;
+}
+
+
+void operf_record_writer::push(chunk * c)
+{
+	sem_wait_nointr(&free_slots);
+	slots[head % nr_slots] = c;
+	++head;
+	sem_post(&used_slots);
+}
+
+
+u64 operf_record_writer::stop(void)
+{
+	if (running) {
+		// a NULL chunk tells the writer thread to exit
+		push(NULL);
+		pthread_join(thread, NULL);
+		running = false;
+		print_stats();
+	}
+
+	if (failed)
+		throw runtime_error(error);
+
+	return bytes_written;
+}
+
+
+void * operf_record_writer::writer_thread(void * arg)
+{
+	static_cast<operf_record_writer *>(arg)->write_loop();
+	return NULL;
+}
+
+
+void operf_record_writer::write_loop(void)
+{
+	vector<chunk *> batch;
+	bool done = false;
+
+	batch.reserve(max_batch);
+	while (!done) {
+		size_t nr_taken = 0;
+
+		sem_wait_nointr(&used_slots);
+		do {
+			chunk * c = slots[tail % nr_slots];
+			++tail;
+			++nr_taken;
+			if (!c) {
+				done = true;
+				break;
+			}
+			batch.push_back(c);
+		} while (batch.size() < max_batch && sem_trywait(&used_slots) == 0);
+
+		// After a write error, keep consuming so that the recording
+		// thread never blocks on a full queue; it will pick up the
+		// error on its next queue_chunk() call.
+		if (!failed && !batch.empty()) {
+			try {
+				bytes_written += write_batch(batch);
+			} catch (runtime_error const & e) {
+				error = e.what();
+				__sync_synchronize();
+				failed = true;
+			}
+		}
+
+		for (size_t i = 0; i < batch.size(); ++i)
+			free(batch[i]);
+		batch.clear();
+		for (size_t i = 0; i < nr_taken; ++i)
+			sem_post(&free_slots);
+	}
+}
+
+
+size_t operf_record_writer::write_batch(vector<chunk *> & batch)
+{
+	struct iovec iov[max_batch];
+	struct iovec * next = iov;
+	size_t nr_iov = batch.size();
+	size_t total = 0;
+	struct timeval now;
+
+	for (size_t i = 0; i < nr_iov; ++i) {
+		iov[i].iov_base = batch[i]->data;
+		iov[i].iov_len = batch[i]->size;
+	}
+
+	if (output_ring) {
+		for (size_t i = 0; i < nr_iov; ++i) {
+			output_ring->write(iov[i].iov_base, iov[i].iov_len);
+			total += iov[i].iov_len;
+		}
+		nr_writes += nr_iov;
+		nr_iov = 0;
+	}
+
+	while (nr_iov) {
+		ssize_t ret = writev(output_fd, next, nr_iov);
+
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+
+			string errmsg = "Internal error:  Failed to write sample data to output fd. errno is ";
+			errmsg += strerror(errno);
+			throw runtime_error(errmsg);
+		}
+
+		++nr_writes;
+		total += ret;
+		// skip what was written, possibly stopping in the middle of a chunk
+		while (nr_iov && (size_t)ret >= next->iov_len) {
+			ret -= next->iov_len;
+			++next;
+			--nr_iov;
+		}
+		if (nr_iov) {
+			next->iov_base = (char *)next->iov_base + ret;
+			next->iov_len -= ret;
+		}
+	}
+
+	gettimeofday(&now, NULL);
+	for (size_t i = 0; i < batch.size(); ++i) {
+		chunk const * c = batch[i];
+		if (c->ring >= stats.size())
+			stats.resize(c->ring + 1, ring_stats());
+		ring_stats & s = stats[c->ring];
+		u64 latency = elapsed_us(c->copied, now);
+		s.bytes += c->size;
+		s.nr_chunks++;
+		s.in_batch++;
+		s.total_latency += latency;
+		if (latency > s.max_latency)
+			s.max_latency = latency;
+	}
+
+	for (size_t i = 0; i < batch.size(); ++i) {
+		ring_stats & s = stats[batch[i]->ring];
+		if (s.in_batch > s.max_queued)
+			s.max_queued = s.in_batch;
+		s.in_batch = 0;
+	}
+
+	return total;
+}
+
+
+void operf_record_writer::print_stats(void) const
+{
+	if (!(cverb << vrecord))
+		return;
+
+	cout << "Record writer: " << bytes_written << " bytes in "
+	     << nr_writes << " writes" << endl;
+	for (size_t i = 0; i < stats.size(); ++i) {
+		ring_stats const & s = stats[i];
+		if (!s.nr_chunks)
+			continue;
+		cout << "  ring " << i << ": " << s.bytes << " bytes in "
+		     << s.nr_chunks << " chunks, max queued " << s.max_queued
+		     << ", drain latency avg " << s.total_latency / s.nr_chunks
+		     << " us, max " << s.max_latency << " us" << endl;
+	}
+}
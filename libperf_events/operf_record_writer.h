@@ -0,0 +1,114 @@
+/**
+ * @file libperf_events/operf_record_writer.h
+ * Decouple draining of the perf_events ring buffers from writing the
+ * sample data to the output file or pipe.
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#ifndef OPERF_RECORD_WRITER_H
+#define OPERF_RECORD_WRITER_H
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "op_types.h"
+
+class operf_shm_ring;
+
+/**
+ * The recording thread copies the data it finds in a ring buffer into a
+ * chunk, hands the chunk over with queue_chunk() and can immediately give
+ * the ring space back to the kernel.  A writer thread picks up the queued
+ * chunks and writes them out with as few writev() calls as possible, so a
+ * slow output file or pipe no longer delays draining of the rings.
+ *
+ * The queue between the two threads is a single producer, single consumer
+ * ring of chunk pointers; the two semaphores only count free and used
+ * slots so that either side can sleep when there is nothing to do.
+ */
+class operf_record_writer {
+public:
+	/**
+	 * @param fd  the output file or pipe
+	 * @param nr_rings  number of ring buffers known at start; more can
+	 *  show up later with a higher index
+	 * @param shm_ring  if not NULL, write to this shared memory ring
+	 *  instead of fd
+	 */
+	operf_record_writer(int fd, size_t nr_rings, operf_shm_ring * shm_ring);
+	~operf_record_writer();
+
+	/** create the writer thread, return false on failure */
+	bool start(void);
+
+	/**
+	 * Return a buffer of size bytes in which to copy data from ring.
+	 * The buffer must be passed to queue_chunk() before the next call.
+	 */
+	unsigned char * new_chunk(size_t ring, size_t size);
+
+	/**
+	 * Queue the chunk returned by the last new_chunk() call.  Blocks if
+	 * the queue is full.  Throws a runtime_error if the writer thread
+	 * failed to write earlier data.
+	 */
+	void queue_chunk(void);
+
+	/**
+	 * Write out everything queued, terminate the writer thread and
+	 * return the total number of bytes written.  Throws a runtime_error
+	 * if the writer thread failed.
+	 */
+	u64 stop(void);
+
+private:
+	struct chunk;
+
+	/** per ring buffer counters, only touched by the writer thread */
+	struct ring_stats {
+		u64 bytes;
+		u64 nr_chunks;
+		/** max chunks of this ring found in the queue at once */
+		unsigned int max_queued;
+		unsigned int in_batch;
+		/** time from copy out of the ring to write completion, in us */
+		u64 total_latency;
+		u64 max_latency;
+	};
+
+	static void * writer_thread(void * arg);
+	void write_loop(void);
+	size_t write_batch(std::vector<chunk *> & batch);
+	void push(chunk * c);
+	void print_stats(void) const;
+
+	int output_fd;
+	operf_shm_ring * output_ring;
+	pthread_t thread;
+	bool running;
+
+	/** chunk being filled by the recording thread */
+	chunk * filling;
+
+	chunk ** slots;
+	/** next slot to fill, recording thread only */
+	size_t head;
+	/** next slot to write, writer thread only */
+	size_t tail;
+	sem_t free_slots;
+	sem_t used_slots;
+
+	std::vector<ring_stats> stats;
+	u64 bytes_written;
+	u64 nr_writes;
+	/** set by the writer thread on a write error */
+	volatile bool failed;
+	std::string error;
+};
+
+#endif /* OPERF_RECORD_WRITER_H */
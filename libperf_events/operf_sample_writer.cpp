@@ -0,0 +1,325 @@
+/**
+ * @file libperf_events/operf_sample_writer.cpp
+ * Apply sample counts to oprofile sample files, optionally from a pool
+ * of writer threads running alongside the perf data conversion.
+ *
+ * Updates first go through a small direct mapped aggregation cache, so the
+ * many hits of a hot loop cost a single sample file update.  An entry is
+ * applied when a conflicting update evicts it; when the cache is flushed,
+ * the entries are applied sorted by file and hash table slot so the mapped
+ * sample files are walked sequentially instead of faulting in random pages.
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include <iostream>
+
+#include "operf_sample_writer.h"
+#include "cverb.h"
+
+extern verbose vconvert;
+
+using namespace std;
+
+namespace {
+
+/** number of updates handed over to a writer thread at once */
+size_t const batch_size = 4096;
+
+/** max number of batches queued on a writer before the converter waits */
+size_t const max_queued_batches = 64;
+
+struct sample_update {
+	odb_t * file;
+	odb_key_t key;
+	unsigned long count;
+};
+
+typedef vector<sample_update> update_batch;
+
+/** log2 of the number of aggregation cache entries */
+unsigned int const cache_bits = 12;
+
+size_t const cache_size = 1 << cache_bits;
+
+/** an entry with a NULL file is unused */
+sample_update cache[cache_size];
+
+/** a cache entry being flushed and where it will land */
+struct flushed_update {
+	odb_data_t const * data;
+	odb_index_t slot;
+	sample_update update;
+};
+
+unsigned long long nr_cache_lookups;
+unsigned long long nr_cache_hits;
+
+struct sample_writer {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	/** signaled when a batch is queued or the writer must stop */
+	pthread_cond_t work_ready;
+	/** signaled when the writer finished a batch */
+	pthread_cond_t work_done;
+	deque<update_batch *> queue;
+	/** batch being filled by the converter, not yet visible to the writer */
+	update_batch * filling;
+	bool busy;
+	bool stopping;
+	unsigned long long nr_updates;
+};
+
+vector<sample_writer *> writers;
+
+
+void apply_update(sample_update const & update)
+{
+	int err = odb_update_node_with_offset(update.file, update.key,
+	                                      update.count);
+	if (err) {
+		fprintf(stderr, "%s: %s\n", __FUNCTION__, strerror(err));
+		abort();
+	}
+}
+
+
+void * writer_thread(void * arg)
+{
+	sample_writer * w = static_cast<sample_writer *>(arg);
+
+	pthread_mutex_lock(&w->lock);
+	for (;;) {
+		while (w->queue.empty() && !w->stopping)
+			pthread_cond_wait(&w->work_ready, &w->lock);
+		if (w->queue.empty())
+			break;
+
+		update_batch * batch = w->queue.front();
+		w->queue.pop_front();
+		w->busy = true;
+		pthread_mutex_unlock(&w->lock);
+
+		for (size_t i = 0; i < batch->size(); ++i)
+			apply_update((*batch)[i]);
+
+		pthread_mutex_lock(&w->lock);
+		w->nr_updates += batch->size();
+		w->busy = false;
+		delete batch;
+		pthread_cond_broadcast(&w->work_done);
+	}
+	pthread_mutex_unlock(&w->lock);
+
+	return NULL;
+}
+
+
+void submit(sample_writer * w)
+{
+	pthread_mutex_lock(&w->lock);
+	while (w->queue.size() >= max_queued_batches)
+		pthread_cond_wait(&w->work_done, &w->lock);
+	w->queue.push_back(w->filling);
+	pthread_cond_signal(&w->work_ready);
+	pthread_mutex_unlock(&w->lock);
+
+	w->filling = new update_batch;
+	w->filling->reserve(batch_size);
+}
+
+
+/**
+ * All files sharing the same odb_data_t are routed to the same writer,
+ * so no two threads ever touch the same mapping.
+ */
+sample_writer * writer_for(odb_t const * file)
+{
+	unsigned long hash = (unsigned long)file->data;
+	hash ^= hash >> 12;
+	return writers[(hash >> 4) % writers.size()];
+}
+
+void dispatch(sample_update const & update)
+{
+	if (writers.empty()) {
+		apply_update(update);
+		return;
+	}
+
+	sample_writer * w = writer_for(update.file);
+	w->filling->push_back(update);
+	if (w->filling->size() >= batch_size)
+		submit(w);
+}
+
+
+size_t cache_index(odb_t const * file, odb_key_t key)
+{
+	uint64_t hash = key ^ ((unsigned long)file >> 4);
+
+	return (hash * 0x9e3779b97f4a7c15ULL) >> (64 - cache_bits);
+}
+
+
+/** order updates by sample file, then by hash table slot in that file */
+struct slot_order {
+	bool operator()(flushed_update const & lhs,
+	                flushed_update const & rhs) const {
+		if (lhs.data != rhs.data)
+			return (unsigned long)lhs.data < (unsigned long)rhs.data;
+		return lhs.slot < rhs.slot;
+	}
+};
+
+
+void flush_cache(void)
+{
+	vector<flushed_update> run;
+
+	/* odb_do_hash() reads the table size, which a writer thread growing
+	 * the file changes: let the writers go idle before computing slots.
+	 * The slots only order the updates, a file growing afterwards while
+	 * they are applied is harmless. */
+	operf_writers_wait();
+
+	for (size_t i = 0; i < cache_size; ++i) {
+		sample_update & entry = cache[i];
+		if (!entry.file)
+			continue;
+
+		flushed_update f;
+		f.data = entry.file->data;
+		f.slot = odb_do_hash(f.data, entry.key);
+		f.update = entry;
+		run.push_back(f);
+		entry.file = NULL;
+	}
+
+	sort(run.begin(), run.end(), slot_order());
+	for (size_t i = 0; i < run.size(); ++i)
+		dispatch(run[i].update);
+}
+
+}  // anonymous namespace
+
+
+void operf_writers_start(int nr_threads)
+{
+	nr_cache_lookups = nr_cache_hits = 0;
+
+	if (nr_threads <= 1)
+		return;
+
+	for (int i = 0; i < nr_threads; ++i) {
+		sample_writer * w = new sample_writer;
+		pthread_mutex_init(&w->lock, NULL);
+		pthread_cond_init(&w->work_ready, NULL);
+		pthread_cond_init(&w->work_done, NULL);
+		w->filling = new update_batch;
+		w->filling->reserve(batch_size);
+		w->busy = false;
+		w->stopping = false;
+		w->nr_updates = 0;
+		if (pthread_create(&w->thread, NULL, writer_thread, w)) {
+			cerr << "Unable to create sample writer thread, "
+			     << "continuing with " << writers.size()
+			     << " writer threads" << endl;
+			delete w->filling;
+			delete w;
+			break;
+		}
+		writers.push_back(w);
+	}
+
+	/* a single writer thread would only add queueing overhead */
+	if (writers.size() == 1)
+		operf_writers_stop();
+	else
+		cverb << vconvert << "Started " << writers.size()
+		      << " sample writer threads" << endl;
+}
+
+
+void operf_writers_update(odb_t * file, odb_key_t key, unsigned long count)
+{
+	sample_update & entry = cache[cache_index(file, key)];
+
+	++nr_cache_lookups;
+	if (entry.file == file && entry.key == key) {
+		++nr_cache_hits;
+		entry.count += count;
+		return;
+	}
+
+	if (entry.file)
+		dispatch(entry);
+	entry.file = file;
+	entry.key = key;
+	entry.count = count;
+}
+
+
+void operf_writers_drain(void)
+{
+	flush_cache();
+	operf_writers_wait();
+}
+
+
+void operf_writers_wait(void)
+{
+	for (size_t i = 0; i < writers.size(); ++i) {
+		if (!writers[i]->filling->empty())
+			submit(writers[i]);
+	}
+
+	for (size_t i = 0; i < writers.size(); ++i) {
+		sample_writer * w = writers[i];
+		pthread_mutex_lock(&w->lock);
+		while (!w->queue.empty() || w->busy)
+			pthread_cond_wait(&w->work_done, &w->lock);
+		pthread_mutex_unlock(&w->lock);
+	}
+}
+
+
+void operf_writers_stop(void)
+{
+	operf_writers_drain();
+
+	for (size_t i = 0; i < writers.size(); ++i) {
+		sample_writer * w = writers[i];
+		pthread_mutex_lock(&w->lock);
+		w->stopping = true;
+		pthread_cond_signal(&w->work_ready);
+		pthread_mutex_unlock(&w->lock);
+		pthread_join(w->thread, NULL);
+
+		cverb << vconvert << "Sample writer thread " << i << " applied "
+		      << w->nr_updates << " updates" << endl;
+
+		pthread_cond_destroy(&w->work_done);
+		pthread_cond_destroy(&w->work_ready);
+		pthread_mutex_destroy(&w->lock);
+		delete w->filling;
+		delete w;
+	}
+	writers.clear();
+}
+
+
+void operf_writers_cache_stats(unsigned long long & nr_updates,
+                               unsigned long long & nr_hits)
+{
+	nr_updates = nr_cache_lookups;
+	nr_hits = nr_cache_hits;
+}
@@ -0,0 +1,54 @@
+/**
+ * @file libperf_events/operf_sample_writer.h
+ * Apply sample counts to oprofile sample files, optionally from a pool
+ * of writer threads running alongside the perf data conversion.
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#ifndef OPERF_SAMPLE_WRITER_H
+#define OPERF_SAMPLE_WRITER_H
+
+#include "odb.h"
+
+/**
+ * Start nr_threads sample file writer threads.  With nr_threads <= 1,
+ * no thread is created and updates leaving the aggregation cache are
+ * applied to the sample files directly.
+ *
+ * Each open sample file is owned by exactly one writer thread, and updates
+ * for a given file are applied in the order they were queued, so sample
+ * files are identical to those produced by a single-threaded conversion.
+ */
+void operf_writers_start(int nr_threads);
+
+/**
+ * Add count to the node for key in file.  The update is only aggregated
+ * in memory, then possibly queued for a writer thread; the caller must
+ * not close or sync a sample file without first calling
+ * operf_writers_drain(), nor (re)open one or otherwise touch the mapped
+ * memory of any sample file without first calling operf_writers_wait().
+ */
+void operf_writers_update(odb_t * file, odb_key_t key, unsigned long count);
+
+/** apply all aggregated updates and wait until they have been applied */
+void operf_writers_drain(void);
+
+/**
+ * wait until all queued updates have been applied, leaving the ones
+ * still aggregated in memory alone
+ */
+void operf_writers_wait(void);
+
+/** drain the queues and terminate the writer threads */
+void operf_writers_stop(void);
+
+/**
+ * Return the number of updates since operf_writers_start() and how many
+ * of them were merged into an update already aggregated in memory.
+ */
+void operf_writers_cache_stats(unsigned long long & nr_updates,
+                               unsigned long long & nr_hits);
+
+#endif /* OPERF_SAMPLE_WRITER_H */
@@ -14,8 +14,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <errno.h>
+#include <ftw.h>
+#include <sys/stat.h>
 #include <iostream>
 #include <sstream>
+#include <algorithm>
+#include <vector>
+#include <string>
 
 #include "operf_sfile.h"
 #include "operf_kernel.h"
@@ -25,6 +31,9 @@
 #include "operf_mangling.h"
 #include "operf_stats.h"
 #include "op_libiberty.h"
+#include "operf_sample_writer.h"
+#include "op_sample_file.h"
+#include "op_sample_manifest.h"
 
 #define HASH_SIZE 2048
 #define HASH_BITS (HASH_SIZE - 1)
@@ -330,7 +339,6 @@ verbose_arc(struct operf_transient const * trans, vma_t from, vma_t to)
 
 void  operf_sfile_log_arc(struct operf_transient const * trans)
 {
-	int err;
 	vma_t from = trans->pc;
 	vma_t to = trans->last_pc;
 	uint64_t key;
@@ -363,12 +371,7 @@ void  operf_sfile_log_arc(struct operf_transient const * trans)
 	key = to & (0xffffffff);
 	key |= ((uint64_t)from) << 32;
 
-	err = odb_update_node(file, key);
-	if (err) {
-		fprintf(stderr, "%s: %s\n", __FUNCTION__, strerror(err));
-		abort();
-	}
-
+	operf_writers_update(file, key, 1);
 }
 
 void operf_sfile_log_sample(struct operf_transient const * trans)
@@ -380,7 +383,6 @@ void operf_sfile_log_sample(struct operf_transient const * trans)
 void operf_sfile_log_sample_count(struct operf_transient const * trans,
                             unsigned long int count)
 {
-	int err;
 	vma_t pc = trans->pc;
 	odb_t * file;
 
@@ -398,13 +400,7 @@ void operf_sfile_log_sample_count(struct operf_transient const * trans,
 		operf_stats[OPERF_LOST_SAMPLEFILE]++;
 		return;
 	}
-	err = odb_update_node_with_offset(file,
-					  (odb_key_t)pc,
-					  count);
-	if (err) {
-		fprintf(stderr, "%s: %s\n", __FUNCTION__, strerror(err));
-		abort();
-	}
+	operf_writers_update(file, (odb_key_t)pc, count);
 	operf_stats[OPERF_SAMPLES]++;
 	if (trans->in_kernel)
 		operf_stats[OPERF_KERNEL]++;
@@ -490,6 +486,8 @@ static void for_each_sfile(operf_sfile_func func, void * data)
 	struct list_head * pos;
 	struct list_head * pos2;
 
+	operf_writers_drain();
+
 	list_for_each_safe(pos, pos2, &lru_list) {
 		struct operf_sfile * sf = list_entry(pos, struct operf_sfile, lru);
 		for_one_sfile(sf, func, data);
@@ -541,6 +539,8 @@ int operf_sfile_lru_clear(void)
 	if (list_empty(&lru_list))
 		return 1;
 
+	operf_writers_drain();
+
 	list_for_each_safe(pos, pos2, &lru_list) {
 		struct operf_sfile * sf;
 		if (!--amount)
@@ -574,3 +574,95 @@ void operf_sfile_init(void)
 	for (; i < HASH_SIZE; ++i)
 		list_init(&hashes[i]);
 }
+
+
+/** the files found under the samples directory by operf_sfile_write_manifest() */
+static vector<string> manifest_files;
+static size_t manifest_dir_len;
+
+static int add_manifest_file(char const * fpath,
+                             struct stat const * sb __attribute__((unused)),
+                             int tflag,
+                             struct FTW * ftwbuf __attribute__((unused)))
+{
+	if (tflag == FTW_F)
+		manifest_files.push_back(fpath + manifest_dir_len);
+	return 0;
+}
+
+
+/* count the nodes and samples of a sample file; on failure, leave the size
+ * and mtime unset so readers of the manifest don't trust the counts */
+static void count_samples(string const & filename,
+                          struct op_manifest_entry * entry)
+{
+	struct stat st;
+	odb_t db;
+	odb_node_nr_t node_nr, pos;
+	odb_node_t * node;
+
+	if (stat(filename.c_str(), &st))
+		return;
+	if (odb_open(&db, filename.c_str(), ODB_RDONLY,
+	             sizeof(struct opd_header)))
+		return;
+
+	node = odb_get_iterator(&db, &node_nr);
+	for (pos = 0; pos < node_nr; ++pos) {
+		// unused slots have a zero value
+		if (node[pos].value) {
+			++entry->nr_nodes;
+			entry->total_samples += node[pos].value;
+		}
+	}
+	odb_close(&db);
+
+	entry->mtime = st.st_mtime;
+	entry->size = st.st_size;
+}
+
+
+void operf_sfile_write_manifest(char const * samples_dir)
+{
+	string dir = samples_dir;
+	while (dir.length() > 1 && dir[dir.length() - 1] == '/')
+		dir.erase(dir.length() - 1);
+
+	manifest_files.clear();
+	manifest_dir_len = dir.length() + 1;
+	if (nftw(dir.c_str(), add_manifest_file, 32, FTW_PHYS)) {
+		cerr << "Unable to list the sample files of " << dir << endl;
+		return;
+	}
+
+	// sorted, consecutive entries share their image strings
+	sort(manifest_files.begin(), manifest_files.end());
+
+	vector<struct op_manifest_entry> entries;
+	for (size_t i = 0; i < manifest_files.size(); ++i) {
+		string const & path = manifest_files[i];
+		// see valid_candidate() in libpp
+		if (path.compare(0, 7, "{root}/") && path.compare(0, 7, "{kern}/"))
+			continue;
+
+		struct op_manifest_entry entry;
+		memset(&entry, 0, sizeof(entry));
+		entry.path = path.c_str();
+		if (!op_manifest_parse_path(&entry))
+			count_samples(dir + "/" + path, &entry);
+		entries.push_back(entry);
+	}
+
+	if (op_write_manifest(dir.c_str(), entries.empty() ? NULL : &entries[0],
+	                      entries.size())) {
+		cerr << "Unable to write the sample file manifest in " << dir
+		     << ": " << strerror(errno) << endl;
+	} else {
+		cverb << vdebug << "wrote manifest of " << entries.size()
+		      << " sample files in " << dir << endl;
+	}
+
+	for (size_t i = 0; i < entries.size(); ++i)
+		op_manifest_free_parsed(&entries[i]);
+	manifest_files.clear();
+}
@@ -146,4 +146,10 @@ void operf_sfile_log_arc(struct operf_transient const * trans);
 /** initialise hashes */
 void operf_sfile_init(void);
 
+/**
+ * Write the manifest of the sample files found under samples_dir, once
+ * all of them are closed. See op_sample_manifest.h
+ */
+void operf_sfile_write_manifest(char const * samples_dir);
+
 #endif /* OPD_SFILE_H */
@@ -0,0 +1,212 @@
+/**
+ * @file libperf_events/operf_shm_ring.cpp
+ * Single producer, single consumer byte ring in shared memory, used to
+ * pass sample data from the operf-record process to the operf-read process.
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <stdexcept>
+#include <string>
+
+#include "operf_shm_ring.h"
+
+using namespace std;
+
+/** lives in the first page of the mapping */
+struct operf_shm_ring::control {
+	/* Total bytes ever written and consumed, each only written by one
+	 * side.  Only their difference matters, so they can wrap, and a
+	 * native word avoids torn reads on 32 bit platforms.
+	 */
+	volatile unsigned long head;
+	volatile unsigned long tail;
+	/** set by a side about to sleep, cleared by the side waking it */
+	volatile int consumer_waiting;
+	volatile int producer_waiting;
+};
+
+namespace {
+
+/** Write a single byte doorbell, return false if nobody listens anymore */
+bool ring_doorbell(int fd)
+{
+	char c = 0;
+
+	// no SIGPIPE: the caller reports a vanished peer itself
+	while (send(fd, &c, 1, MSG_NOSIGNAL) < 0) {
+		if (errno != EINTR)
+			return false;
+	}
+	return true;
+}
+
+
+/**
+ * Wait for a doorbell and swallow any accumulated ones.  Return false
+ * on end of file or error, i.e. when the other side closed its end.
+ */
+bool wait_doorbell(int fd)
+{
+	char buf[64];
+	ssize_t ret;
+
+	do {
+		ret = read(fd, buf, sizeof(buf));
+	} while (ret < 0 && errno == EINTR);
+
+	return ret > 0;
+}
+
+}  // anonymous namespace
+
+
+operf_shm_ring::operf_shm_ring(size_t size)
+	:
+	peer_fd(-1)
+{
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	size_t ring_size = page_size;
+
+	while (ring_size < size)
+		ring_size <<= 1;
+	mask = ring_size - 1;
+	map_size = page_size + ring_size;
+
+	void * base = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+	                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED) {
+		string errmsg = "Unable to map the sample data ring: ";
+		errmsg += strerror(errno);
+		throw runtime_error(errmsg);
+	}
+
+	ctl = (control *)base;
+	data = (unsigned char *)base + page_size;
+	ctl->head = ctl->tail = 0;
+	ctl->consumer_waiting = ctl->producer_waiting = 0;
+}
+
+
+operf_shm_ring::~operf_shm_ring()
+{
+	munmap(ctl, map_size);
+}
+
+
+void operf_shm_ring::wait_for_space(void)
+{
+	ctl->producer_waiting = 1;
+	__sync_synchronize();
+	if (ctl->head - ctl->tail <= mask)
+		return;
+
+	if (!wait_doorbell(peer_fd))
+		throw runtime_error("Sample data ring closed by the converter");
+}
+
+
+void operf_shm_ring::write(void const * buf, size_t size)
+{
+	unsigned char const * src = (unsigned char const *)buf;
+
+	while (size) {
+		unsigned long head = ctl->head;
+		size_t space = mask + 1 - (head - ctl->tail);
+
+		if (!space) {
+			wait_for_space();
+			continue;
+		}
+		// make sure the consumer is done with the space before reuse
+		__sync_synchronize();
+
+		size_t offset = head & mask;
+		size_t len = size < space ? size : space;
+		size_t first = mask + 1 - offset;
+		if (first > len)
+			first = len;
+		memcpy(data + offset, src, first);
+		memcpy(data, src + first, len - first);
+
+		// publish the data before the new head
+		__sync_synchronize();
+		ctl->head = head + len;
+		src += len;
+		size -= len;
+
+		__sync_synchronize();
+		if (ctl->consumer_waiting &&
+		    __sync_bool_compare_and_swap(&ctl->consumer_waiting, 1, 0) &&
+		    !ring_doorbell(peer_fd))
+			throw runtime_error("Sample data ring closed by the converter");
+	}
+}
+
+
+size_t operf_shm_ring::wait_for_data(size_t size)
+{
+	for (;;) {
+		size_t avail = ctl->head - ctl->tail;
+		if (avail >= size)
+			break;
+
+		ctl->consumer_waiting = 1;
+		__sync_synchronize();
+		if (ctl->head - ctl->tail >= size)
+			break;
+
+		if (!wait_doorbell(peer_fd)) {
+			// the producer is gone, whatever it wrote is all we get
+			__sync_synchronize();
+			return ctl->head - ctl->tail;
+		}
+	}
+
+	// read the data only after seeing the head covering it
+	__sync_synchronize();
+	return ctl->head - ctl->tail;
+}
+
+
+unsigned char const * operf_shm_ring::read_ptr(size_t & contiguous) const
+{
+	size_t offset = ctl->tail & mask;
+	size_t avail = ctl->head - ctl->tail;
+
+	contiguous = mask + 1 - offset;
+	if (contiguous > avail)
+		contiguous = avail;
+	return data + offset;
+}
+
+
+void operf_shm_ring::copy_out(void * buf, size_t size) const
+{
+	size_t offset = ctl->tail & mask;
+	size_t first = mask + 1 - offset;
+
+	if (first > size)
+		first = size;
+	memcpy(buf, data + offset, first);
+	memcpy((unsigned char *)buf + first, data, size - first);
+}
+
+
+void operf_shm_ring::consume(size_t size)
+{
+	// done with the data before handing the space back
+	__sync_synchronize();
+	ctl->tail += size;
+
+	__sync_synchronize();
+	if (ctl->producer_waiting &&
+	    __sync_bool_compare_and_swap(&ctl->producer_waiting, 1, 0))
+		ring_doorbell(peer_fd);
+}
@@ -0,0 +1,81 @@
+/**
+ * @file libperf_events/operf_shm_ring.h
+ * Single producer, single consumer byte ring in shared memory, used to
+ * pass sample data from the operf-record process to the operf-read process.
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#ifndef OPERF_SHM_RING_H
+#define OPERF_SHM_RING_H
+
+#include <stddef.h>
+
+/**
+ * The ring is mapped shared and anonymous, so it must be created before
+ * forking the producer and the consumer.  Each side only writes its own
+ * index.  The two processes are also connected by a stream socket pair,
+ * on which a side sends a single byte to wake the other one up when it
+ * sleeps waiting for data (consumer) or for space (producer).  End of file
+ * on the socket tells a side that the other one is gone.
+ *
+ * Anything sent on the socket before the first write() to the ring, such
+ * as the perf header, is not affected and can be read with read(2).
+ */
+class operf_shm_ring {
+public:
+	/**
+	 * Map a ring of at least size bytes, rounded up to a power of two.
+	 * Throws a runtime_error on failure.
+	 */
+	operf_shm_ring(size_t size);
+	~operf_shm_ring();
+
+	/** set this process's end of the socket pair */
+	void set_fd(int fd) { peer_fd = fd; }
+
+	int get_fd(void) const { return peer_fd; }
+
+	/**
+	 * Producer: copy size bytes into the ring, waiting for space as
+	 * needed.  Throws a runtime_error if the consumer is gone.
+	 */
+	void write(void const * buf, size_t size);
+
+	/**
+	 * Consumer: wait until at least size bytes can be read or the
+	 * producer is gone, return the number of bytes available.
+	 */
+	size_t wait_for_data(size_t size);
+
+	/**
+	 * Consumer: return a pointer to the unread data and set contiguous
+	 * to the number of bytes that can be read there before the ring wraps.
+	 */
+	unsigned char const * read_ptr(size_t & contiguous) const;
+
+	/** Consumer: copy size unread bytes, without consuming them */
+	void copy_out(void * buf, size_t size) const;
+
+	/** Consumer: release size bytes to the producer */
+	void consume(size_t size);
+
+	size_t get_size(void) const { return mask + 1; }
+
+private:
+	struct control;
+
+	operf_shm_ring(operf_shm_ring const &);
+	operf_shm_ring & operator=(operf_shm_ring const &);
+
+	void wait_for_space(void);
+
+	control * ctl;
+	unsigned char * data;
+	size_t mask;
+	size_t map_size;
+	int peer_fd;
+};
+
+#endif /* OPERF_SHM_RING_H */
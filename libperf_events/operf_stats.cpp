@@ -19,6 +19,7 @@
 #include <errno.h>
 
 #include "operf_stats.h"
+#include "operf_sample_writer.h"
 #include "op_get_time.h"
 
 unsigned long operf_stats[OPERF_MAX_STATS];
@@ -90,6 +91,11 @@ void operf_print_stats(string sessiondir, char * starttime, bool throttled,
 	fprintf(fp, "Nr. samples lost reported by perf_events kernel: %lu\n",
 	       operf_stats[OPERF_RECORD_LOST_SAMPLE]);
 
+	unsigned long long nr_updates, nr_hits;
+	operf_writers_cache_stats(nr_updates, nr_hits);
+	fprintf(fp, "Nr. sample file updates merged in memory: %llu of %llu (%.1f%% hit rate)\n",
+	        nr_hits, nr_updates, nr_updates ? 100.0 * nr_hits / nr_updates : 0.0);
+
 	if (operf_stats[OPERF_RECORD_LOST_SAMPLE]) {
 		fprintf(stderr, "\n\n * * * ATTENTION: The kernel lost %lu samples. * * *\n",
 		        operf_stats[OPERF_RECORD_LOST_SAMPLE]);
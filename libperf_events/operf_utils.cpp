@@ -25,6 +25,8 @@
 #include <sstream>
 #include "operf_counter.h"
 #include "operf_utils.h"
+#include "operf_record_writer.h"
+#include "operf_shm_ring.h"
 #ifdef HAVE_LIBPFM
 #include <perfmon/pfmlib.h>
 #endif
@@ -991,9 +993,24 @@ int OP_perf_utils::op_mmap_trace_file(struct mmap_info & info, bool init)
 }
 
 
+/* When set, sample data written to the ring's socket goes into the ring
+ * instead; see op_set_output_ring().
+ */
+static operf_shm_ring * output_ring;
+
+void OP_perf_utils::op_set_output_ring(operf_shm_ring * ring)
+{
+	output_ring = ring;
+}
+
 int OP_perf_utils::op_write_output(int output, void *buf, size_t size)
 {
 	int sum = 0;
+
+	if (output_ring && output == output_ring->get_fd()) {
+		output_ring->write(buf, size);
+		return size;
+	}
 	while (size) {
 		int ret = write(output, buf, size);
 
@@ -1412,9 +1429,11 @@ void OP_perf_utils::op_record_kernel_info(string vmlinux_file, u64 start_addr, u
 		_record_module_info(output_fd, pr);
 }
 
-void OP_perf_utils::op_get_kernel_event_data(struct mmap_data *md, operf_record * pr)
+void OP_perf_utils::op_get_kernel_event_data(struct mmap_data *md, size_t ring,
+                                             operf_record * pr)
 {
 	struct perf_event_mmap_page *pc = (struct perf_event_mmap_page *)md->base;
+	operf_record_writer * writer = pr->get_writer();
 	int out_fd = pr->out_fd();
 
 	uint64_t head = pc->data_head;
@@ -1424,6 +1443,7 @@ void OP_perf_utils::op_get_kernel_event_data(struct mmap_data *md, operf_record
 
 	uint64_t old = md->prev;
 	unsigned char *data = ((unsigned char *)md->base) + pagesize;
+	unsigned char *copy = NULL;
 	uint64_t size;
 	void *buf;
 	int64_t diff;
@@ -1441,17 +1461,38 @@ void OP_perf_utils::op_get_kernel_event_data(struct mmap_data *md, operf_record
 
 	size = head - old;
 
+	/* With a writer thread, the data is copied out into one chunk, wrapped
+	 * part included, and the ring space is given back to the kernel without
+	 * waiting for the data to be written.
+	 */
+	if (writer)
+		copy = writer->new_chunk(ring, size);
+
 	if ((old & md->mask) + size != (head & md->mask)) {
 		buf = &data[old & md->mask];
 		size = md->mask + 1 - (old & md->mask);
 		old += size;
-		pr->add_to_total(op_write_output(out_fd, buf, size));
+		if (copy) {
+			memcpy(copy, buf, size);
+			copy += size;
+		} else {
+			pr->add_to_total(op_write_output(out_fd, buf, size));
+		}
 	}
 
 	buf = &data[old & md->mask];
 	size = head - old;
 	old += size;
-	pr->add_to_total(op_write_output(out_fd, buf, size));
+	if (copy) {
+		memcpy(copy, buf, size);
+		// order the copy before the kernel may overwrite the data
+		__sync_synchronize();
+	} else {
+		pr->add_to_total(op_write_output(out_fd, buf, size));
+	}
 	md->prev = old;
 	pc->data_tail = old;
+
+	if (writer)
+		writer->queue_chunk();
 }
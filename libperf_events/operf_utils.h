@@ -32,6 +32,7 @@ extern int mmap_pages_mult;
 extern std::string session_dir;
 extern bool separate_cpu;
 extern bool separate_thread;
+extern int convert_threads;
 }
 
 extern bool no_vmlinux;
@@ -65,6 +66,7 @@ static inline size_t align_64bit(u64 x)
 }
 
 class operf_record;
+class operf_shm_ring;
 namespace OP_perf_utils {
 typedef struct vmlinux_info {
 	std::string image_name;
@@ -72,7 +74,7 @@ typedef struct vmlinux_info {
 } vmlinux_info_t;
 void op_record_kernel_info(std::string vmlinux_file, u64 start_addr, u64 end_addr,
                            int output_fd, operf_record * pr);
-void op_get_kernel_event_data(struct mmap_data *md, operf_record * pr);
+void op_get_kernel_event_data(struct mmap_data *md, size_t ring, operf_record * pr);
 void op_perfrecord_sigusr1_handler(int sig __attribute__((unused)),
 		siginfo_t * siginfo __attribute__((unused)),
 		void *u_context __attribute__((unused)));
@@ -80,6 +82,8 @@ int op_get_process_info(bool system_wide, pid_t pid, operf_record * pr);
 void op_record_process_exec_mmaps(pid_t pid, pid_t tgid, int output_fd, operf_record * pr);
 void op_get_vsyscall_mapping(pid_t tgid, int output_fd, operf_record * pr);
 int op_write_output(int output, void *buf, size_t size);
+/* Route what op_write_output() writes to ring->get_fd() into ring; NULL to stop. */
+void op_set_output_ring(operf_shm_ring * ring);
 int op_write_event(event_t * event, u64 sample_type);
 int op_read_from_stream(std::ifstream & is, char * buf, std::streamsize sz);
 int op_mmap_trace_file(struct mmap_info & info, bool init);
@@ -0,0 +1,229 @@
+/**
+ * @file mapping_lookup_tests.cpp
+ * tests operf_process_info::find_mapping_for_sample() against a linear
+ * walk of the mappings, and optionally times both.
+ *
+ * usage: mapping_lookup_tests [-v] [replay_file]
+ *
+ * With -v, the per-sample cost of the linear walk and of the indexed
+ * lookup is printed.  A replay file holds one record per line, with
+ * addresses in hex:
+ *   m <start_addr> <end_addr>    an mmap event
+ *   h <start_addr> <end_addr>    a hypervisor mapping
+ *   s <sample_addr>              a user space sample
+ * Without a replay file, a JVM-like process with a few thousand mappings
+ * and a skewed sample stream is synthesized.
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <map>
+
+#include "operf_process_info.h"
+
+using namespace std;
+
+verbose vmisc("misc");
+
+namespace {
+
+struct sample {
+	u64 addr;
+	bool hypervisor;
+};
+
+struct replay {
+	vector<operf_mmap *> mappings;
+	vector<sample> samples;
+};
+
+bool verbose_output;
+int nr_error;
+
+
+operf_mmap * new_mapping(u64 start, u64 end, bool hypervisor)
+{
+	operf_mmap * mapping = new operf_mmap;
+	memset(mapping, 0, sizeof(*mapping));
+	mapping->start_addr = start;
+	mapping->end_addr = end;
+	mapping->is_anon_mapping = hypervisor;
+	mapping->is_hypervisor = hypervisor;
+	strcpy(mapping->filename, hypervisor ? "[hypervisor_bucket]" : "//anon");
+	return mapping;
+}
+
+
+/* the pre-index implementation, used as reference */
+operf_mmap const * linear_lookup(map<u64, operf_mmap *> const & mmappings,
+                                 u64 addr, bool hypervisor)
+{
+	map<u64, operf_mmap *>::const_iterator it = mmappings.begin();
+	for (; it != mmappings.end(); ++it) {
+		if (addr >= it->second->start_addr && addr <= it->second->end_addr &&
+		    it->second->is_hypervisor == hypervisor)
+			return it->second;
+	}
+	return NULL;
+}
+
+
+void synthesize(replay & r)
+{
+	u64 addr = 0x400000ULL;
+
+	srand(42);
+	for (int i = 0; i < 4000; ++i) {
+		u64 len = (1 + rand() % 64) * 4096ULL;
+		r.mappings.push_back(new_mapping(addr, addr + len - 1, false));
+		addr += len + (rand() % 4) * 4096ULL;
+	}
+	// a few overlapping mappings and a hypervisor bucket
+	r.mappings.push_back(new_mapping(0x500000ULL, 0x5fffffULL, false));
+	r.mappings.push_back(new_mapping(0x480000ULL, 0x4fffffULL, false));
+	r.mappings.push_back(new_mapping(0x10ULL, 0xfffffULL, true));
+
+	// 80% of samples in 20 hot mappings, in runs of 1 to 16
+	while (r.samples.size() < 2000000) {
+		operf_mmap const * m;
+		if (rand() % 5)
+			m = r.mappings[(rand() % 20) * 97];
+		else
+			m = r.mappings[rand() % r.mappings.size()];
+		u64 len = m->end_addr - m->start_addr + 1;
+		int run = 1 + rand() % 16;
+		for (int i = 0; i < run; ++i) {
+			sample s;
+			// include some addresses outside any mapping
+			s.addr = m->start_addr + (rand() % (len + 8192)) - 4096;
+			s.hypervisor = m->is_hypervisor;
+			r.samples.push_back(s);
+		}
+	}
+}
+
+
+bool load(char const * filename, replay & r)
+{
+	ifstream in(filename);
+	string line;
+
+	if (!in) {
+		cerr << "Unable to open " << filename << endl;
+		return false;
+	}
+
+	while (getline(in, line)) {
+		istringstream is(line);
+		char type;
+		u64 start, end;
+
+		if (!(is >> type))
+			continue;
+		is >> hex;
+		switch (type) {
+		case 'm':
+		case 'h':
+			if (is >> start >> end)
+				r.mappings.push_back(new_mapping(start, end, type == 'h'));
+			break;
+		case 's':
+			if (is >> start) {
+				sample s;
+				s.addr = start;
+				s.hypervisor = false;
+				r.samples.push_back(s);
+			}
+			break;
+		}
+	}
+	return true;
+}
+
+
+double now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1E9 + tv.tv_usec * 1E3;
+}
+
+
+void check_and_time(replay const & r)
+{
+	operf_process_info proc(getpid(), "mapping_lookup_tests", true, true);
+	map<u64, operf_mmap *> mmappings;
+	vector<operf_mmap const *> expected;
+	double begin, linear_ns, indexed_ns;
+
+	for (size_t i = 0; i < r.mappings.size(); ++i) {
+		proc.process_mapping(r.mappings[i], false);
+		mmappings[r.mappings[i]->start_addr] = r.mappings[i];
+	}
+
+	expected.reserve(r.samples.size());
+	begin = now();
+	for (size_t i = 0; i < r.samples.size(); ++i)
+		expected.push_back(linear_lookup(mmappings, r.samples[i].addr,
+		                                 r.samples[i].hypervisor));
+	linear_ns = now() - begin;
+
+	begin = now();
+	for (size_t i = 0; i < r.samples.size(); ++i) {
+		operf_mmap const * found =
+			proc.find_mapping_for_sample(r.samples[i].addr,
+			                             r.samples[i].hypervisor);
+		if (found != expected[i]) {
+			cerr << "mapping mismatch for sample 0x" << hex
+			     << r.samples[i].addr << dec << endl;
+			++nr_error;
+		}
+	}
+	indexed_ns = now() - begin;
+
+	if (verbose_output && !r.samples.empty()) {
+		cout << r.mappings.size() << " mappings, " << r.samples.size()
+		     << " samples" << endl;
+		cout << "linear walk: " << linear_ns / r.samples.size()
+		     << " ns/sample" << endl;
+		cout << "indexed lookup: " << indexed_ns / r.samples.size()
+		     << " ns/sample" << endl;
+	}
+}
+
+}  // anonymous namespace
+
+
+int main(int argc, char * argv[])
+{
+	replay r;
+	int i = 1;
+
+	if (i < argc && !strcmp(argv[i], "-v")) {
+		verbose_output = true;
+		++i;
+	}
+
+	if (i < argc) {
+		if (!load(argv[i], r))
+			return EXIT_FAILURE;
+	} else {
+		synthesize(r);
+	}
+
+	check_and_time(r);
+
+	for (size_t j = 0; j < r.mappings.size(); ++j)
+		delete r.mappings[j];
+
+	return nr_error ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,241 @@
+/**
+ * @file bfd_cache.cpp
+ * Share op_bfd objects between all the users of a binary image
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <map>
+#include <sstream>
+
+#include "bfd_cache.h"
+#include "op_bfd.h"
+#include "locate_images.h"
+#include "string_filter.h"
+#include "utility.h"
+#include "cverb.h"
+
+using namespace std;
+
+extern verbose vbfd;
+
+struct shared_bfd::entry {
+	entry(op_bfd * abfd_, bool ok_, string const & key_)
+		: abfd(abfd_), ok(ok_), key(key_), refcount(0) {}
+
+	op_bfd * abfd;
+	/// the ok output of the op_bfd ctor
+	bool ok;
+	/// empty if this entry is not shared
+	string key;
+	unsigned int refcount;
+	/// position in the idle list if refcount is zero
+	list<entry *>::iterator idle_pos;
+};
+
+
+namespace {
+
+/**
+ * The cache is never destroyed: a shared_bfd with static storage duration
+ * can release its entry after main() returns.
+ */
+class bfd_cache {
+public:
+	bfd_cache() : max_idle(0), nr_hits(0), nr_misses(0) {}
+
+	shared_bfd::entry * get(string const & image,
+	                        string_filter const & symbol_filter,
+	                        extra_images const & extra, bool & ok);
+	void release(shared_bfd::entry * e);
+	void print_stats() const;
+
+	size_t get_max_idle() const { return max_idle; }
+	/// set the max number of op_bfd kept while nobody uses them
+	void set_max_idle(size_t nr);
+
+private:
+	typedef map<string, shared_bfd::entry *> entries_t;
+
+	void destroy(shared_bfd::entry * e);
+	/// free the least recently used idle entries past max_idle
+	void trim_idle();
+
+	/// all the shared entries, by key
+	entries_t entries;
+	/// shared entries not in use, most recently used first
+	list<shared_bfd::entry *> idle;
+	/**
+	 * op_bfd keeps a reference to the extra_images it was built with,
+	 * which must outlive it: shared op_bfd refer to a copy kept here
+	 */
+	map<int, extra_images> extras;
+	size_t max_idle;
+	unsigned long nr_hits;
+	unsigned long nr_misses;
+};
+
+
+shared_bfd::entry *
+bfd_cache::get(string const & image, string_filter const & symbol_filter,
+               extra_images const & extra, bool & ok)
+{
+	bool const kallsyms = strncmp(image.c_str(), KALL_SYM_FILE,
+	                              image.length()) == 0;
+
+	// a failed op_bfd is cheap to build, no need to share it
+	if (!ok) {
+		op_bfd * abfd = kallsyms ? new op_bfd(image, extra)
+			: new op_bfd(image, symbol_filter, extra, ok);
+		return new shared_bfd::entry(abfd, ok, string());
+	}
+
+	ostringstream os;
+	os << image << '\0' << extra.get_uid() << '\0';
+	if (!kallsyms)
+		os << symbol_filter.key();
+	string const key = os.str();
+
+	entries_t::iterator it = entries.find(key);
+	if (it != entries.end()) {
+		++nr_hits;
+		shared_bfd::entry * e = it->second;
+		if (!e->refcount)
+			idle.erase(e->idle_pos);
+		ok = e->ok;
+		return e;
+	}
+
+	++nr_misses;
+
+	map<int, extra_images>::iterator extra_it = extras.find(extra.get_uid());
+	if (extra_it == extras.end())
+		extra_it = extras.insert(make_pair(extra.get_uid(), extra)).first;
+
+	op_bfd * abfd = kallsyms ? new op_bfd(image, extra_it->second)
+		: new op_bfd(image, symbol_filter, extra_it->second, ok);
+
+	shared_bfd::entry * e = new shared_bfd::entry(abfd, ok, key);
+	entries[key] = e;
+	return e;
+}
+
+
+void bfd_cache::release(shared_bfd::entry * e)
+{
+	if (e->key.empty()) {
+		destroy(e);
+		return;
+	}
+
+	idle.push_front(e);
+	e->idle_pos = idle.begin();
+	trim_idle();
+}
+
+
+void bfd_cache::set_max_idle(size_t nr)
+{
+	max_idle = nr;
+	trim_idle();
+}
+
+
+void bfd_cache::trim_idle()
+{
+	while (idle.size() > max_idle) {
+		shared_bfd::entry * oldest = idle.back();
+		idle.pop_back();
+		entries.erase(oldest->key);
+		destroy(oldest);
+	}
+}
+
+
+void bfd_cache::destroy(shared_bfd::entry * e)
+{
+	delete e->abfd;
+	delete e;
+}
+
+
+void bfd_cache::print_stats() const
+{
+	cverb << vbfd << "bfd cache: " << nr_hits << " hits, " << nr_misses
+	      << " misses" << endl;
+}
+
+
+bfd_cache & cache = *new bfd_cache;
+
+}  // anonymous namespace
+
+
+shared_bfd::shared_bfd(entry * e)
+	: bfd_entry(e)
+{
+	++bfd_entry->refcount;
+}
+
+
+shared_bfd::shared_bfd(shared_bfd const & rhs)
+	: bfd_entry(rhs.bfd_entry)
+{
+	if (bfd_entry)
+		++bfd_entry->refcount;
+}
+
+
+shared_bfd::~shared_bfd()
+{
+	if (bfd_entry && !--bfd_entry->refcount)
+		cache.release(bfd_entry);
+}
+
+
+shared_bfd & shared_bfd::operator=(shared_bfd const & rhs)
+{
+	if (rhs.bfd_entry)
+		++rhs.bfd_entry->refcount;
+	if (bfd_entry && !--bfd_entry->refcount)
+		cache.release(bfd_entry);
+	bfd_entry = rhs.bfd_entry;
+	return *this;
+}
+
+
+op_bfd const & shared_bfd::operator*() const
+{
+	return *bfd_entry->abfd;
+}
+
+
+shared_bfd const get_bfd(string const & image,
+                         string_filter const & symbol_filter,
+                         extra_images const & extra, bool & ok)
+{
+	return shared_bfd(cache.get(image, symbol_filter, extra, ok));
+}
+
+
+keep_idle_bfds::keep_idle_bfds(size_t nr)
+	: saved_max_idle(cache.get_max_idle())
+{
+	cache.set_max_idle(nr);
+}
+
+
+keep_idle_bfds::~keep_idle_bfds()
+{
+	cache.set_max_idle(saved_max_idle);
+}
+
+
+void print_bfd_cache_stats()
+{
+	cache.print_stats();
+}
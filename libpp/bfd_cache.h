@@ -0,0 +1,88 @@
+/**
+ * @file bfd_cache.h
+ * Share op_bfd objects between all the users of a binary image
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#ifndef BFD_CACHE_H
+#define BFD_CACHE_H
+
+#include <cstddef>
+#include <string>
+
+class op_bfd;
+class string_filter;
+class extra_images;
+
+/**
+ * A reference counted handle to an op_bfd owned by the bfd cache. The
+ * op_bfd stays alive as long as a handle refers to it, and a while after
+ * if a keep_idle_bfds is alive, so that the next get_bfd() for the same
+ * image can reuse it.
+ */
+class shared_bfd {
+public:
+	struct entry;
+
+	shared_bfd() : bfd_entry(0) {}
+	shared_bfd(shared_bfd const & rhs);
+	~shared_bfd();
+
+	shared_bfd & operator=(shared_bfd const & rhs);
+
+	/// return true if this handle refers to no op_bfd
+	bool empty() const { return !bfd_entry; }
+
+	op_bfd const & operator*() const;
+	op_bfd const * operator->() const { return &**this; }
+
+private:
+	friend shared_bfd const get_bfd(std::string const &,
+		string_filter const &, extra_images const &, bool &);
+
+	explicit shared_bfd(entry * e);
+
+	entry * bfd_entry;
+};
+
+
+/**
+ * @param image  the image name
+ * @param symbol_filter  filter to apply to symbols
+ * @param extra  container where all extra candidate filenames are stored
+ * @param ok  in-out parameter, as for the op_bfd ctor
+ *
+ * Return the op_bfd for image, built as by the op_bfd ctor taking the
+ * same parameters, or by the kallsyms one if image is the kallsyms file.
+ * An op_bfd for the same image, extra images and symbol filter is shared
+ * if one is in use, or was recently used while a keep_idle_bfds is alive.
+ * An op_bfd for which ok is false on input is never shared.
+ */
+shared_bfd const get_bfd(std::string const & image,
+                         string_filter const & symbol_filter,
+                         extra_images const & extra, bool & ok);
+
+/**
+ * By default an op_bfd is freed with its last shared_bfd, as most paths
+ * visit each image once. While a keep_idle_bfds is alive, up to nr op_bfd
+ * nobody uses are kept for the paths going back to the same images.
+ */
+class keep_idle_bfds {
+public:
+	explicit keep_idle_bfds(size_t nr);
+	~keep_idle_bfds();
+
+private:
+	keep_idle_bfds(keep_idle_bfds const &);
+	keep_idle_bfds & operator=(keep_idle_bfds const &);
+
+	/// the limit to restore
+	size_t saved_max_idle;
+};
+
+/// output the bfd cache hit and miss counters to cverb << vbfd
+void print_bfd_cache_stats();
+
+#endif /* !BFD_CACHE_H */
@@ -27,6 +27,7 @@
 #include "populate.h"
 #include "string_filter.h"
 #include "op_bfd.h"
+#include "bfd_cache.h"
 #include "op_sample_file.h"
 #include "locate_images.h"
 #include "utility.h"
@@ -389,24 +390,29 @@ symbol_collection const & arc_recorder::get_symbols() const
 
 void callgraph_container::populate(list<inverted_profile> const & iprofiles,
    extra_images const & extra, bool debug_info, double threshold,
-   bool merge_lib, string_filter const & sym_filter)
+   bool merge_lib, string_filter const & sym_filter, int nr_jobs)
 {
 	this->extra_found_images = extra;
 	// non callgraph samples container, we record sample at symbol level
 	// not at vma level.
 	profile_container pc(debug_info, false, extra_found_images);
 
-	list<inverted_profile>::const_iterator it;
-	list<inverted_profile>::const_iterator const end = iprofiles.end();
-	for (it = iprofiles.begin(); it != end; ++it) {
-		// populate_caller_image take care about empty sample filename
-		populate_for_image(pc, *it, sym_filter, 0);
-	}
+	// populate_for_images take care about empty sample filename
+	populate_for_images(pc, iprofiles, sym_filter, 0, nr_jobs);
 
 	add_symbols(pc);
 
 	total_count = pc.samples_count();
 
+	// the recorder matches and names the symbols by their demangled name
+	vector<symbol_name_id> names;
+	symbol_container::const_iterator sit = pc.begin_symbol();
+	for (; sit != pc.end_symbol(); ++sit)
+		names.push_back((*sit)->name);
+	symbol_names.demangle(names, nr_jobs);
+
+	list<inverted_profile>::const_iterator it;
+	list<inverted_profile>::const_iterator const end = iprofiles.end();
 	for (it = iprofiles.begin(); it != end; ++it) {
 		for (size_t i = 0; i < it->groups.size(); ++i) {
 			populate(it->groups[i], it->image,
@@ -440,12 +446,13 @@ void callgraph_container::populate(list<string> const & cg_files,
 	string const & app_image, size_t pclass,
 	profile_container const & pc, bool debug_info, bool merge_lib)
 {
+	// the arcs of an image are spread over many cg files
+	keep_idle_bfds const keep(8);
+
 	list<string>::const_iterator it;
 	list<string>::const_iterator const end = cg_files.end();
 	for (it = cg_files.begin(); it != end; ++it) {
 		cverb << vdebug << "samples file : " << *it << endl;
-		op_bfd *caller_bfd;
-		op_bfd *callee_bfd;
 
 		parsed_filename caller_file =
 			parse_filename(*it, extra_found_images);
@@ -460,14 +467,8 @@ void callgraph_container::populate(list<string> const & cg_files,
 					   error, false, extra_found_images);
 
 		bool caller_bfd_ok = true;
-
-		if (strncmp(caller_file.lib_image.c_str(), KALL_SYM_FILE,
-			    strlen(caller_file.lib_image.c_str())) == 0)
-			caller_bfd = new op_bfd(caller_file.lib_image, extra_found_images);
-
-		else
-			caller_bfd = new op_bfd(caller_file.lib_image, string_filter(),
-						extra_found_images, caller_bfd_ok);
+		shared_bfd const caller_bfd = get_bfd(caller_file.lib_image,
+			string_filter(), extra_found_images, caller_bfd_ok);
 
 		if (!caller_bfd_ok)
 			report_image_error(caller_file.lib_image,
@@ -484,13 +485,8 @@ void callgraph_container::populate(list<string> const & cg_files,
 					   error, false, extra_found_images);
 
 		bool callee_bfd_ok = true;
-		if (strncmp(callee_file.cg_image.c_str(), KALL_SYM_FILE,
-			    strlen(callee_file.cg_image.c_str())) == 0)
-			callee_bfd = new op_bfd(callee_file.cg_image, extra_found_images);
-
-		else
-			callee_bfd = new op_bfd(callee_file.cg_image, string_filter(),
-						extra_found_images, callee_bfd_ok);
+		shared_bfd const callee_bfd = get_bfd(callee_file.cg_image,
+			string_filter(), extra_found_images, callee_bfd_ok);
 
 		if (!callee_bfd_ok)
 			report_image_error(callee_file.cg_image,
@@ -505,9 +501,6 @@ void callgraph_container::populate(list<string> const & cg_files,
 		add(profile, *caller_bfd, caller_bfd_ok, *callee_bfd,
 		    merge_lib ? app_image : app_name, pc,
 		    debug_info, pclass);
-
-		delete caller_bfd;
-		delete callee_bfd;
 	}
 }
 
@@ -584,11 +577,11 @@ add(profile_t const & profile, op_bfd const & caller_bfd, bool caller_bfd_ok,
 
 void callgraph_container::add_symbols(profile_container const & pc)
 {
-	symbol_container::symbols_t::iterator it;
-	symbol_container::symbols_t::iterator const end = pc.end_symbol();
+	symbol_container::const_iterator it;
+	symbol_container::const_iterator const end = pc.end_symbol();
 
 	for (it = pc.begin_symbol(); it != end; ++it)
-		recorder.add(*it, 0, count_array_t());
+		recorder.add(**it, 0, count_array_t());
 }
 
 
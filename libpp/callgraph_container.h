@@ -111,6 +111,7 @@ public:
 	 * @param threshold  ignore sample percent below this threshold
 	 * @param merge_lib  merge library samples
 	 * @param sym_filter  symbol filter
+	 * @param nr_jobs  number of threads loading the sample files
 	 *
 	 * Currently all errors core dump.
 	 * FIXME: consider if this should be a ctor
@@ -118,7 +119,7 @@ public:
 	void populate(std::list<inverted_profile> const & iprofiles,
 		      extra_images const & extra, bool debug_info,
 		      double threshold, bool merge_lib,
-		      string_filter const & sym_filter);
+		      string_filter const & sym_filter, int nr_jobs);
 
 	/// return hint on how data must be displayed.
 	column_flags output_hint() const;
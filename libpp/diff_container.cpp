@@ -124,30 +124,30 @@ diff_container::get_symbols(profile_container::symbol_choice & choice) const
 	 * two lists (see less_symbol).
 	 */
 
-	symbol_container::symbols_t::iterator it1 = pc1.begin_symbol();
-	symbol_container::symbols_t::iterator end1 = pc1.end_symbol();
-	symbol_container::symbols_t::iterator it2 = pc2.begin_symbol();
-	symbol_container::symbols_t::iterator end2 = pc2.end_symbol();
+	symbol_container::const_iterator it1 = pc1.begin_symbol();
+	symbol_container::const_iterator end1 = pc1.end_symbol();
+	symbol_container::const_iterator it2 = pc2.begin_symbol();
+	symbol_container::const_iterator end2 = pc2.end_symbol();
 
 	while (it1 != end1 && it2 != end2) {
-		if (rough_less(*it1, *it2)) {
-			symbol_old(syms, *it1, choice);
+		if (rough_less(**it1, **it2)) {
+			symbol_old(syms, **it1, choice);
 			++it1;
-		} else if (rough_less(*it2, *it1)) {
-			symbol_new(syms, *it2, choice);
+		} else if (rough_less(**it2, **it1)) {
+			symbol_new(syms, **it2, choice);
 			++it2;
 		} else {
-			symbol_diff(syms, *it1, total1, *it2, total2, choice);
+			symbol_diff(syms, **it1, total1, **it2, total2, choice);
 			++it1;
 			++it2;
 		}
 	}
 
 	for (; it1 != end1; ++it1)
-		symbol_old(syms, *it1, choice);
+		symbol_old(syms, **it1, choice);
 
 	for (; it2 != end2; ++it2)
-		symbol_new(syms, *it2, choice);
+		symbol_new(syms, **it2, choice);
 
 	return syms;
 }
@@ -660,23 +660,20 @@ void xml_formatter::output(ostream & out)
 }
 
 bool
-xml_formatter::get_bfd_object(symbol_entry const * symb, op_bfd * & abfd) const
+xml_formatter::get_bfd_object(symbol_entry const * symb, shared_bfd & abfd) const
 {
 	bool ok = true;
 
 	string const & image_name = get_image_name(symb->image_name,
 	                                           image_name_storage::int_filename, extra_found_images);
-	if (abfd && abfd->get_filename() == image_name)
+	if (!abfd.empty() && abfd->get_filename() == image_name)
 		return true;
-	delete abfd;
-	abfd = new op_bfd(image_name, symbol_filter,
-	                  extra_found_images, ok);
+	abfd = get_bfd(image_name, symbol_filter, extra_found_images, ok);
 
 	if (!ok) {
 		report_image_error(image_name, image_format_failure,
 				   false, extra_found_images);
-		delete abfd;
-		abfd = 0;
+		abfd = shared_bfd();
 		return false;
 	}
 
@@ -684,7 +681,7 @@ xml_formatter::get_bfd_object(symbol_entry const * symb, op_bfd * & abfd) const
 }
 
 void xml_formatter::
-output_the_symbol_data(ostream & out, symbol_entry const * symb, op_bfd * & abfd)
+output_the_symbol_data(ostream & out, symbol_entry const * symb, shared_bfd & abfd)
 {
 	string const name = symbol_names.name(symb->name);
 	assert(name.size() > 0);
@@ -714,7 +711,7 @@ output_the_symbol_data(ostream & out, symbol_entry const * symb, op_bfd * & abfd
 
 			if (need_details) {
 				get_bfd_object(symb, abfd);
-				if (abfd && abfd->symbol_has_contents(symb->sym_index))
+				if (!abfd.empty() && abfd->symbol_has_contents(symb->sym_index))
 					xml_support->output_symbol_bytes(bytes_out, symb, sd_it->second, *abfd);
 			}
 		}
@@ -726,7 +723,7 @@ output_the_symbol_data(ostream & out, symbol_entry const * symb, op_bfd * & abfd
 }
 
 void xml_formatter::output_cg_children(ostream & out, 
-	cg_symbol::children const cg_symb, op_bfd * & abfd)
+	cg_symbol::children const cg_symb, shared_bfd & abfd)
 {
 	cg_symbol::children::const_iterator cit;
 	cg_symbol::children::const_iterator cend = cg_symb.end();
@@ -747,7 +744,9 @@ void xml_formatter::output_cg_children(ostream & out,
 
 void xml_formatter::output_symbol_data(ostream & out)
 {
-	op_bfd * abfd = NULL;
+	// symbols sorted by samples interleave the images
+	keep_idle_bfds const keep(need_details ? 8 : 0);
+	shared_bfd abfd;
 	sym_iterator it = symbols.begin();
 	sym_iterator end = symbols.end();
 
@@ -763,8 +762,6 @@ void xml_formatter::output_symbol_data(ostream & out)
 		}
 	}
 	out << close_element(SYMBOL_TABLE);
-
-	delete abfd;
 }
 
 string  xml_formatter::
@@ -22,6 +22,7 @@
 #include "symbol.h"
 #include "string_filter.h"
 #include "xml_output.h"
+#include "bfd_cache.h"
 
 class symbol_entry;
 class sample_entry;
@@ -288,13 +289,13 @@ private:
 
 	/// Retrieve a bfd object for this symbol, reopening a new bfd object
 	/// only if necessary
-	bool get_bfd_object(symbol_entry const * symb, op_bfd * & abfd) const;
+	bool get_bfd_object(symbol_entry const * symb, shared_bfd & abfd) const;
 
 	void output_the_symbol_data(std::ostream & out,
-		symbol_entry const * symb, op_bfd * & abfd);
+		symbol_entry const * symb, shared_bfd & abfd);
 
 	void output_cg_children(std::ostream & out,
-		cg_symbol::children const cg_symb, op_bfd * & abfd);
+		cg_symbol::children const cg_symb, shared_bfd & abfd);
 };
 
 // callgraph XML output version
@@ -9,20 +9,286 @@
  * @author John Levon
  */
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+#include "config.h"
+
 #include "name_storage.h"
 #include "demangle_symbol.h"
 #include "file_manip.h"
 #include "string_manip.h"
 #include "locate_images.h"
 #include "op_exception.h"
+#include "op_config.h"
+#include "op_types.h"
+#include "op_file.h"
+#include "cverb.h"
 
 using namespace std;
 
+extern verbose vbfd;
+
+namespace options {
+	extern demangle_type demangle;
+	extern bool demangle_cache;
+}
+
 image_name_storage image_names;
 debug_name_storage debug_names;
 symbol_name_storage symbol_names;
 
 
+namespace {
+
+/**
+ * The demangle cache maps mangled names to the demangle_symbol() result
+ * for one demangling type. It is valid as long as the stl.pat used
+ * by smart demangling is the same. Layout is a demangle_cache_header,
+ * nr_names demangle_cache_entry sorted by mangled name then a table of
+ * nul terminated strings, so it can be used in place from a mmap().
+ *
+ * The cache is only used with --demangle-cache: opreport doesn't write
+ * in the session directory otherwise. Failing to write it, e.g. to a
+ * read-only session directory, is not an error.
+ */
+char const demangle_cache_magic[8] = "OPDEMC";
+/// bump this when the layout or the demangling changes
+u32 const demangle_cache_version = 1;
+/// past this many names the cache isn't written anymore
+size_t const max_demangle_cache_names = 1 << 20;
+
+struct demangle_cache_header {
+	char magic[8];
+	u32 version;
+	/// the demangle_type of the names
+	u32 demangle;
+	/// stl.pat mtime and size, zero unless smart demangling
+	u64 pattern_mtime;
+	u64 pattern_size;
+	u32 nr_names;
+	u32 strings_size;
+};
+
+struct demangle_cache_entry {
+	/// offsets of the names in the string table
+	u32 mangled;
+	u32 demangled;
+};
+
+
+/// the demangle cache of the session directory, if any
+class demangle_cache {
+public:
+	demangle_cache();
+	~demangle_cache();
+
+	/// return the cached demangled name of mangled or NULL
+	char const * find(string const & mangled) const;
+
+	/// write back the cached names plus the given ones
+	void save(vector<string> const & mangled,
+	          vector<string> const & demangled) const;
+
+private:
+	/// load the cache file if it is valid for this header
+	void load();
+
+	/// compare an entry by its mangled name
+	struct less_mangled {
+		less_mangled(char const * s) : strings(s) {}
+		bool operator()(demangle_cache_entry const & lhs,
+		                string const & rhs) const {
+			return rhs.compare(strings + lhs.mangled) > 0;
+		}
+		char const * strings;
+	};
+
+	string filename;
+	/// the expected header, nr_names and strings_size excepted
+	demangle_cache_header header;
+	void * map;
+	size_t map_size;
+	demangle_cache_entry const * entries;
+	char const * strings;
+	u32 nr_names;
+};
+
+
+demangle_cache::demangle_cache()
+	: map(MAP_FAILED), map_size(0), entries(0), strings(0), nr_names(0)
+{
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, demangle_cache_magic, sizeof(header.magic));
+	header.version = demangle_cache_version;
+	header.demangle = options::demangle;
+
+	if (!options::demangle_cache || !*op_session_dir)
+		return;
+
+	if (options::demangle == dmt_smart) {
+		struct stat st;
+		if (stat(OP_DATADIR "/stl.pat", &st))
+			return;
+		header.pattern_mtime = st.st_mtime;
+		header.pattern_size = st.st_size;
+	}
+
+	ostringstream os;
+	os << op_session_dir << "/symbols/demangled."
+	   << (options::demangle == dmt_smart ? "smart" : "normal");
+	filename = os.str();
+
+	load();
+}
+
+
+demangle_cache::~demangle_cache()
+{
+	if (map != MAP_FAILED)
+		munmap(map, map_size);
+}
+
+
+void demangle_cache::load()
+{
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd == -1)
+		return;
+
+	struct stat st;
+	if (!fstat(fd, &st) && size_t(st.st_size) >= sizeof(header)) {
+		map_size = st.st_size;
+		map = mmap(0, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	close(fd);
+	if (map == MAP_FAILED)
+		return;
+
+	char const * base = static_cast<char const *>(map);
+	demangle_cache_header const * file_header =
+		reinterpret_cast<demangle_cache_header const *>(base);
+	demangle_cache_entry const * file_entries =
+		reinterpret_cast<demangle_cache_entry const *>(file_header + 1);
+	char const * file_strings =
+		reinterpret_cast<char const *>(file_entries + file_header->nr_names);
+
+	bool valid = !memcmp(file_header, &header,
+	                     offsetof(demangle_cache_header, nr_names)) &&
+		file_header->strings_size &&
+		map_size == sizeof(header) +
+			u64(file_header->nr_names) * sizeof(*file_entries) +
+			file_header->strings_size &&
+		!file_strings[file_header->strings_size - 1];
+
+	for (u32 i = 0; valid && i < file_header->nr_names; ++i) {
+		valid = file_entries[i].mangled < file_header->strings_size &&
+			file_entries[i].demangled < file_header->strings_size;
+	}
+
+	if (!valid) {
+		cverb << vbfd << "ignoring demangle cache " << filename << endl;
+		return;
+	}
+
+	entries = file_entries;
+	strings = file_strings;
+	nr_names = file_header->nr_names;
+	cverb << vbfd << "loaded " << nr_names << " demangled names from "
+	      << filename << endl;
+}
+
+
+char const * demangle_cache::find(string const & mangled) const
+{
+	demangle_cache_entry const * last = entries + nr_names;
+	demangle_cache_entry const * it =
+		lower_bound(entries, last, mangled, less_mangled(strings));
+	if (it == last || mangled != strings + it->mangled)
+		return 0;
+	return strings + it->demangled;
+}
+
+
+void demangle_cache::save(vector<string> const & mangled,
+                          vector<string> const & demangled) const
+{
+	if (filename.empty())
+		return;
+
+	if (nr_names + mangled.size() > max_demangle_cache_names) {
+		cverb << vbfd << "demangle cache " << filename
+		      << " full, not updated" << endl;
+		return;
+	}
+
+	string const dir = op_dirname(filename);
+	if (create_dir(dir.c_str())) {
+		cverb << vbfd << "can't create demangle cache " << dir << endl;
+		return;
+	}
+
+	vector<pair<string, string> > names;
+	names.reserve(nr_names + mangled.size());
+	for (u32 i = 0; i < nr_names; ++i) {
+		names.push_back(make_pair(string(strings + entries[i].mangled),
+		                          string(strings + entries[i].demangled)));
+	}
+	for (size_t i = 0; i < mangled.size(); ++i)
+		names.push_back(make_pair(mangled[i], demangled[i]));
+	sort(names.begin(), names.end());
+
+	demangle_cache_header file_header = header;
+	vector<demangle_cache_entry> file_entries;
+	file_entries.reserve(names.size());
+	string file_strings;
+	for (size_t i = 0; i < names.size(); ++i) {
+		if (i && names[i].first == names[i - 1].first)
+			continue;
+		demangle_cache_entry entry;
+		entry.mangled = file_strings.size();
+		file_strings.append(names[i].first.c_str(),
+		                    names[i].first.size() + 1);
+		entry.demangled = file_strings.size();
+		file_strings.append(names[i].second.c_str(),
+		                    names[i].second.size() + 1);
+		file_entries.push_back(entry);
+	}
+	file_header.nr_names = file_entries.size();
+	file_header.strings_size = file_strings.size();
+
+	// write a temporary file then rename it so a concurrent reader
+	// never sees a partial file
+	ostringstream tmp;
+	tmp << filename << "." << getpid();
+	ofstream out(tmp.str().c_str(), ios::out | ios::binary);
+	out.write(reinterpret_cast<char const *>(&file_header),
+	          sizeof(file_header));
+	out.write(reinterpret_cast<char const *>(&file_entries[0]),
+	          file_entries.size() * sizeof(file_entries[0]));
+	out.write(file_strings.data(), file_strings.size());
+	out.close();
+
+	if (!out || rename(tmp.str().c_str(), filename.c_str())) {
+		cverb << vbfd << "can't write demangle cache "
+		      << filename << endl;
+		unlink(tmp.str().c_str());
+	}
+}
+
+} // anonymous namespace
+
+
 string const & image_name_storage::basename(image_name_id id) const
 {
 	stored_filename const & n = get(id);
@@ -100,3 +366,48 @@ string const & symbol_name_storage::demangle(symbol_name_id id) const
 	n.name_processed += ltrim(n.name, "?");
 	return n.name_processed;
 }
+
+
+void symbol_name_storage::demangle(vector<symbol_name_id> const & ids,
+                                   int nr_jobs) const
+{
+	if (options::demangle == dmt_none)
+		return;
+
+	// the names demangle(symbol_name_id) would pass to demangle_symbol()
+	vector<stored_name const *> todo;
+	for (size_t i = 0; i < ids.size(); ++i) {
+		stored_name const & n = get(ids[i]);
+		if (n.name_processed.empty() && !n.name.empty() &&
+		    n.name[0] != '?')
+			todo.push_back(&n);
+	}
+	sort(todo.begin(), todo.end());
+	todo.erase(unique(todo.begin(), todo.end()), todo.end());
+	if (todo.empty())
+		return;
+
+	demangle_cache cache;
+
+	vector<stored_name const *> misses;
+	vector<string> mangled;
+	for (size_t i = 0; i < todo.size(); ++i) {
+		char const * demangled = cache.find(todo[i]->name);
+		if (demangled) {
+			todo[i]->name_processed = demangled;
+		} else {
+			misses.push_back(todo[i]);
+			mangled.push_back(todo[i]->name);
+		}
+	}
+
+	if (misses.empty())
+		return;
+
+	vector<string> demangled;
+	demangle_symbols(mangled, demangled, nr_jobs);
+	for (size_t i = 0; i < misses.size(); ++i)
+		misses[i]->name_processed = demangled[i];
+
+	cache.save(mangled, demangled);
+}
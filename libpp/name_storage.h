@@ -13,6 +13,7 @@
 #define NAME_STORAGE_H
 
 #include <string>
+#include <vector>
 
 #include "unique_storage.h"
 
@@ -27,6 +28,13 @@ struct stored_name {
 		return name < rhs.name;
 	}
 
+	typedef std::string key_type;
+
+	/// the key unique_storage identifies the name by
+	std::string const & key() const {
+		return name;
+	}
+
 	std::string name;
 	mutable std::string name_processed;
 };
@@ -62,6 +70,13 @@ struct stored_filename {
 		return filename < rhs.filename;
 	}
 
+	typedef std::string key_type;
+
+	/// the key unique_storage identifies the filename by
+	std::string const & key() const {
+		return filename;
+	}
+
 	std::string filename;
 	mutable std::string base_filename;
 	mutable std::string real_filename;
@@ -128,6 +143,18 @@ typedef name_storage<symbol_name_tag>::id_value symbol_name_id;
 struct symbol_name_storage : name_storage<symbol_name_tag> {
 	/// return the demangled name for the given ID
 	std::string const & demangle(symbol_name_id id) const;
+
+	/**
+	 * @param ids  the symbols to demangle
+	 * @param nr_jobs  number of threads demangling
+	 *
+	 * Demangle the names of all ids at once so later calls to
+	 * demangle(symbol_name_id) don't have to. With --demangle-cache,
+	 * the results are cached in the session directory and reused by
+	 * the next reports.
+	 */
+	void demangle(std::vector<symbol_name_id> const & ids,
+	              int nr_jobs) const;
 };
 
 
@@ -16,11 +16,15 @@
 #include "profile_container.h"
 #include "arrange_profiles.h"
 #include "op_bfd.h"
+#include "bfd_cache.h"
 #include "op_header.h"
 #include "populate.h"
 
 #include "image_errors.h"
+#include "op_exception.h"
+#include "cverb.h"
 #include "utility.h"
+#include <pthread.h>
 #include <string.h>
 
 #include <iostream>
@@ -29,47 +33,202 @@ using namespace std;
 
 namespace {
 
-/// load merged files for one set of sample files
-bool
-populate_from_files(profile_t & profile, op_bfd const & abfd,
-                    list<profile_sample_files> const & files)
+/// the samples of all the image_set of one inverted_profile
+struct image_samples {
+	~image_samples() {
+		for (size_t i = 0; i < profiles.size(); ++i)
+			delete profiles[i];
+	}
+
+	/// one entry per image_set of each group, in order, NULL if the
+	/// image_set has no sample file, only cg ones
+	vector<profile_t *> profiles;
+	/// what went wrong while loading, reported by the populating thread
+	string error;
+};
+
+
+/// load merged files for one set of sample files, NULL if none
+profile_t * load_files(list<profile_sample_files> const & files)
 {
 	list<profile_sample_files>::const_iterator it = files.begin();
 	list<profile_sample_files>::const_iterator const end = files.end();
 
-	bool found = false;
+	profile_t * profile = 0;
 	// we can't handle cg files here obviously
 	for (; it != end; ++it) {
 		// A bit ugly but we must accept silently empty sample filename
 		// since we can create a profile_sample_files for cg file only
 		// (i.e no sample to the binary)
 		if (!it->sample_filename.empty()) {
-			profile.add_sample_file(it->sample_filename);
-			profile.set_offset(abfd);
-			found = true;
+			if (!profile)
+				profile = new profile_t;
+			profile->add_sample_file(it->sample_filename);
 		}
 	}
 
-	return found;
+	return profile;
 }
 
-}  // anon namespace
 
+image_samples * load_samples(inverted_profile const & ip)
+{
+	image_samples * loaded = new image_samples;
 
-void
-populate_for_image(profile_container & samples, inverted_profile const & ip,
-	string_filter const & symbol_filter, bool * has_debug_info)
+	try {
+		for (size_t i = 0; i < ip.groups.size(); ++i) {
+			list<image_set>::const_iterator it
+				= ip.groups[i].begin();
+			list<image_set>::const_iterator const end
+				= ip.groups[i].end();
+			for (; it != end; ++it)
+				loaded->profiles.push_back(load_files(it->files));
+		}
+	} catch (exception const & e) {
+		loaded->error = e.what();
+	}
+
+	return loaded;
+}
+
+
+/**
+ * Load the samples of a list of images with a pool of threads, in order
+ * and a few images ahead of the ones being populated. Only the sample
+ * files are loaded this way: neither libbfd nor the name storage used
+ * while populating a profile_container can be used by several threads.
+ */
+class sample_loader : noncopyable {
+public:
+	sample_loader(list<inverted_profile> const & ips, int nr_jobs);
+	~sample_loader();
+
+	/// wait for the samples of image index and hand them over
+	image_samples * get(size_t index);
+
+private:
+	static void * loader_thread(void * arg);
+	void load_loop();
+
+	vector<inverted_profile const *> images;
+	/// loaded samples not yet handed over, by image index
+	vector<image_samples *> loaded;
+	/// next image to load
+	size_t next;
+	/// images from index window_start + window can't be loaded yet
+	size_t window_start;
+	size_t window;
+	bool stopping;
+	vector<pthread_t> threads;
+	pthread_mutex_t lock;
+	/// signaled when an image is loaded or the window moves
+	pthread_cond_t changed;
+};
+
+
+sample_loader::sample_loader(list<inverted_profile> const & ips, int nr_jobs)
+	:
+	images(ips.size()),
+	loaded(ips.size()),
+	next(0),
+	window_start(0),
+	window(2 * nr_jobs),
+	stopping(false)
 {
-	op_bfd *abfd;
+	list<inverted_profile>::const_iterator it = ips.begin();
+	for (size_t i = 0; it != ips.end(); ++it, ++i)
+		images[i] = &*it;
+
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&changed, NULL);
+
+	for (int i = 0; i < nr_jobs; ++i) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, loader_thread, this))
+			break;
+		threads.push_back(thread);
+	}
+	// get() loads the images itself if no thread could be created
+	cverb << vdebug << "loading sample files with " << threads.size()
+	      << " threads" << endl;
+}
+
+
+sample_loader::~sample_loader()
+{
+	pthread_mutex_lock(&lock);
+	stopping = true;
+	pthread_cond_broadcast(&changed);
+	pthread_mutex_unlock(&lock);
+
+	for (size_t i = 0; i < threads.size(); ++i)
+		pthread_join(threads[i], NULL);
+
+	for (size_t i = 0; i < loaded.size(); ++i)
+		delete loaded[i];
+
+	pthread_cond_destroy(&changed);
+	pthread_mutex_destroy(&lock);
+}
+
+
+void * sample_loader::loader_thread(void * arg)
+{
+	static_cast<sample_loader *>(arg)->load_loop();
+	return NULL;
+}
 
-	bool ok = ip.error == image_ok;
 
-	if (strncmp(ip.image.c_str(), KALL_SYM_FILE, strlen(ip.image.c_str())) == 0)
-		abfd = new op_bfd(ip.image, samples.extra_found_images);
+void sample_loader::load_loop()
+{
+	pthread_mutex_lock(&lock);
+	for (;;) {
+		while (!stopping && next < images.size() &&
+		       next >= window_start + window)
+			pthread_cond_wait(&changed, &lock);
+		if (stopping || next >= images.size())
+			break;
+
+		size_t index = next++;
+		pthread_mutex_unlock(&lock);
+
+		image_samples * samples = load_samples(*images[index]);
+
+		pthread_mutex_lock(&lock);
+		loaded[index] = samples;
+		pthread_cond_broadcast(&changed);
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+
+image_samples * sample_loader::get(size_t index)
+{
+	if (threads.empty())
+		return load_samples(*images[index]);
+
+	pthread_mutex_lock(&lock);
+	window_start = index;
+	pthread_cond_broadcast(&changed);
+	while (!loaded[index])
+		pthread_cond_wait(&changed, &lock);
+	image_samples * samples = loaded[index];
+	loaded[index] = 0;
+	pthread_mutex_unlock(&lock);
 
-	else
-		abfd = new op_bfd(ip.image, symbol_filter,
-				  samples.extra_found_images, ok);
+	return samples;
+}
+
+
+void
+populate_from_samples(profile_container & samples, inverted_profile const & ip,
+	string_filter const & symbol_filter, bool * has_debug_info,
+	image_samples const & loaded)
+{
+	bool ok = ip.error == image_ok;
+
+	shared_bfd const abfd = get_bfd(ip.image, symbol_filter,
+					samples.extra_found_images, ok);
 
 	if (!ok && ip.error == image_ok)
 		ip.error = image_format_failure;
@@ -77,9 +236,13 @@ populate_for_image(profile_container & samples, inverted_profile const & ip,
 	if (ip.error == image_format_failure)
 		report_image_error(ip, false, samples.extra_found_images);
 
+	if (!loaded.error.empty())
+		throw op_fatal_error(loaded.error);
+
 	opd_header header;
 
 	bool found = false;
+	size_t index = 0;
 	for (size_t i = 0; i < ip.groups.size(); ++i) {
 		list<image_set>::const_iterator it
 			= ip.groups[i].begin();
@@ -91,10 +254,11 @@ populate_for_image(profile_container & samples, inverted_profile const & ip,
 		// changes, and the .add() would mis-attribute
 		// to the wrong app_image otherwise
 		for (; it != end; ++it) {
-			profile_t profile;
-			if (populate_from_files(profile, *abfd, it->files)) {
-				header = profile.get_header();
-				samples.add(profile, *abfd, it->app_image, i);
+			profile_t * profile = loaded.profiles[index++];
+			if (profile) {
+				profile->set_offset(*abfd);
+				header = profile->get_header();
+				samples.add(*profile, *abfd, it->app_image, i);
 				found = true;
 			}
 		}
@@ -110,6 +274,52 @@ populate_for_image(profile_container & samples, inverted_profile const & ip,
 
 	if (has_debug_info)
 		*has_debug_info = abfd->has_debug_info();
+}
 
-	delete abfd;
+}  // anon namespace
+
+
+void
+populate_for_image(profile_container & samples, inverted_profile const & ip,
+	string_filter const & symbol_filter, bool * has_debug_info)
+{
+	scoped_ptr<image_samples> loaded(load_samples(ip));
+
+	populate_from_samples(samples, ip, symbol_filter, has_debug_info,
+	                      *loaded);
+}
+
+
+void
+populate_for_images(profile_container & samples,
+	list<inverted_profile> const & ips,
+	string_filter const & symbol_filter, bool * has_debug_info,
+	int nr_jobs)
+{
+	if (has_debug_info)
+		*has_debug_info = false;
+
+	if (nr_jobs <= 1) {
+		list<inverted_profile>::const_iterator it = ips.begin();
+		for (; it != ips.end(); ++it) {
+			bool debug_info = false;
+			populate_for_image(samples, *it, symbol_filter,
+			                   &debug_info);
+			if (has_debug_info && debug_info)
+				*has_debug_info = true;
+		}
+		return;
+	}
+
+	sample_loader loader(ips, nr_jobs);
+
+	list<inverted_profile>::const_iterator it = ips.begin();
+	for (size_t i = 0; it != ips.end(); ++it, ++i) {
+		scoped_ptr<image_samples> loaded(loader.get(i));
+		bool debug_info = false;
+		populate_from_samples(samples, *it, symbol_filter,
+		                      &debug_info, *loaded);
+		if (has_debug_info && debug_info)
+			*has_debug_info = true;
+	}
 }
@@ -12,6 +12,8 @@
 #ifndef POPULATE_H
 #define POPULATE_H
 
+#include <list>
+
 class profile_container;
 class inverted_profile;
 class string_filter;
@@ -22,4 +24,16 @@ void
 populate_for_image(profile_container & samples, inverted_profile const & ip,
    string_filter const & symbol_filter, bool * has_debug_info);
 
+/**
+ * Load all sample file information for each image of ips, as if calling
+ * populate_for_image() for each of them in order. If nr_jobs > 1, the
+ * sample files of the next images are loaded by nr_jobs threads while the
+ * current one is populated. has_debug_info, if non NULL, is set to true
+ * if any image has debug information.
+ */
+void
+populate_for_images(profile_container & samples,
+   std::list<inverted_profile> const & ips,
+   string_filter const & symbol_filter, bool * has_debug_info, int nr_jobs);
+
 #endif /* POPULATE_H */
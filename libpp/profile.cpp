@@ -10,10 +10,14 @@
  * @author John Levon
  */
 
+#include <pthread.h>
 #include <unistd.h>
 #include <cstring>
 
+#include <algorithm>
+#include <functional>
 #include <iostream>
+#include <map>
 #include <string>
 #include <sstream>
 #include <cstring>
@@ -30,6 +34,110 @@
 
 using namespace std;
 
+namespace {
+
+/**
+ * libdb shares the mapping of a file opened more than once through a
+ * global list, serialize open and close since sample files can be loaded
+ * by several threads
+ */
+pthread_mutex_t odb_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/// sample counts given by set_sample_count(), by sample filename
+map<string, count_type> known_sample_counts;
+
+
+void close_sample_file(odb_t & db)
+{
+	pthread_mutex_lock(&odb_lock);
+	odb_close(&db);
+	pthread_mutex_unlock(&odb_lock);
+}
+
+
+typedef pair<odb_key_t, count_type> sample_entry;
+
+/// order sample entries by eip, to search a sorted array
+struct key_less {
+	bool operator()(sample_entry const & lhs, odb_key_t rhs) const {
+		return lhs.first < rhs;
+	}
+};
+
+
+/// order sample entries by eip only, to sort them
+struct entry_less {
+	bool operator()(sample_entry const & lhs,
+	                sample_entry const & rhs) const {
+		return lhs.first < rhs.first;
+	}
+};
+
+
+/**
+ * Sort samples by eip with a LSD radix sort, one pass per key byte.
+ * Passes for bytes shared by all keys, like the high order bytes of non
+ * call graph keys, are skipped.
+ */
+void radix_sort(vector<sample_entry> & samples)
+{
+	size_t const nr_bytes = sizeof(odb_key_t);
+	size_t const nr_samples = samples.size();
+
+	if (nr_samples < 256) {
+		sort(samples.begin(), samples.end(), entry_less());
+		return;
+	}
+
+	vector<size_t> histogram(nr_bytes * 256);
+	for (size_t i = 0; i < nr_samples; ++i) {
+		odb_key_t key = samples[i].first;
+		for (size_t byte = 0; byte < nr_bytes; ++byte)
+			++histogram[byte * 256 + ((key >> (byte * 8)) & 0xff)];
+	}
+
+	vector<sample_entry> buffer(nr_samples);
+	vector<sample_entry> * from = &samples;
+	vector<sample_entry> * to = &buffer;
+
+	for (size_t byte = 0; byte < nr_bytes; ++byte) {
+		size_t * offset = &histogram[byte * 256];
+		unsigned int shift = byte * 8;
+		if (offset[((*from)[0].first >> shift) & 0xff] == nr_samples)
+			continue;
+
+		size_t total = 0;
+		for (size_t i = 0; i < 256; ++i) {
+			size_t count = offset[i];
+			offset[i] = total;
+			total += count;
+		}
+
+		for (size_t i = 0; i < nr_samples; ++i) {
+			sample_entry const & entry = (*from)[i];
+			(*to)[offset[(entry.first >> shift) & 0xff]++] = entry;
+		}
+		swap(from, to);
+	}
+
+	if (from != &samples)
+		samples.swap(buffer);
+}
+
+
+/// add an entry to sorted samples, merging it with the last one if same eip
+inline void append(vector<sample_entry> & samples, sample_entry const & entry)
+{
+	if (!samples.empty() && samples.back().first == entry.first)
+		samples.back().second += entry.second;
+	else
+		samples.push_back(entry);
+}
+
+}  // anonymous namespace
+
+
 profile_t::profile_t()
 	: start_offset(0)
 {
@@ -39,6 +147,11 @@ profile_t::profile_t()
 // static member
 count_type profile_t::sample_count(string const & filename)
 {
+	map<string, count_type>::const_iterator it =
+		known_sample_counts.find(filename);
+	if (it != known_sample_counts.end())
+		return it->second;
+
 	odb_t samples_db;
 
 	open_sample_file(filename, samples_db);
@@ -47,14 +160,22 @@ count_type profile_t::sample_count(string const & filename)
 
 	odb_node_nr_t node_nr, pos;
 	odb_node_t * node = odb_get_iterator(&samples_db, &node_nr);
+	// unused slots have a zero value
 	for (pos = 0; pos < node_nr; ++pos)
 		count += node[pos].value;
 
-	odb_close(&samples_db);
+	close_sample_file(samples_db);
 
 	return count;
 }
 
+// static member
+void profile_t::set_sample_count(string const & filename, count_type count)
+{
+	known_sample_counts[filename] = count;
+}
+
+
 //static member
 void profile_t::open_sample_file(string const & filename, odb_t & db)
 {
@@ -62,7 +183,7 @@ void profile_t::open_sample_file(string const & filename, odb_t & db)
 	// fail and the error message will be obscure.
 	opd_header head = read_header(filename);
 
-	if (head.version != OPD_VERSION) {
+	if (head.version < OPD_MIN_VERSION || head.version > OPD_VERSION) {
 		ostringstream os;
 		os << "oprofpp: samples files version mismatch." << endl
 		   << "Be sure you are running the oprofile post-profile tool that" << endl
@@ -70,8 +191,10 @@ void profile_t::open_sample_file(string const & filename, odb_t & db)
 		throw op_fatal_error(os.str());
 	}
 
+	pthread_mutex_lock(&odb_lock);
 	int rc = odb_open(&db, filename.c_str(), ODB_RDONLY,
 		sizeof(struct opd_header));
+	pthread_mutex_unlock(&odb_lock);
 
 	if (rc)
 		throw op_fatal_error(filename + ": " + strerror(rc));
@@ -95,19 +218,65 @@ void profile_t::add_sample_file(string const & filename)
 	odb_node_nr_t node_nr, pos;
 	odb_node_t * node = odb_get_iterator(&samples_db, &node_nr);
 
+	runs.push_back(ordered_samples_t());
+	ordered_samples_t & run = runs.back();
+	run.reserve(samples_db.data->descr->current_size);
 	for (pos = 0; pos < node_nr; ++pos) {
-		ordered_samples_t::iterator it = 
-		    ordered_samples.find(node[pos].key);
-		if (it != ordered_samples.end()) {
-			it->second += node[pos].value;
-		} else {
-			ordered_samples_t::value_type
-				val(node[pos].key, node[pos].value);
-			ordered_samples.insert(val);
+		if (node[pos].value)
+			run.push_back(sample_entry(node[pos].key, node[pos].value));
+	}
+
+	close_sample_file(samples_db);
+
+	// keys are unique in a sample file, so no need to merge duplicates
+	radix_sort(run);
+}
+
+
+void profile_t::merge_runs() const
+{
+	if (runs.empty())
+		return;
+
+	if (ordered_samples.empty() && runs.size() == 1) {
+		ordered_samples.swap(runs[0]);
+		runs.clear();
+		return;
+	}
+
+	runs.push_back(ordered_samples_t());
+	runs.back().swap(ordered_samples);
+
+	size_t total = 0;
+	for (size_t i = 0; i < runs.size(); ++i)
+		total += runs[i].size();
+
+	// k-way merge through a min heap of the next eip of each run
+	typedef pair<odb_key_t, size_t> heap_entry;
+	vector<heap_entry> heap;
+	vector<size_t> next(runs.size(), 0);
+	for (size_t i = 0; i < runs.size(); ++i) {
+		if (!runs[i].empty())
+			heap.push_back(heap_entry(runs[i][0].first, i));
+	}
+	make_heap(heap.begin(), heap.end(), greater<heap_entry>());
+
+	ordered_samples_t merged;
+	merged.reserve(total);
+	while (!heap.empty()) {
+		pop_heap(heap.begin(), heap.end(), greater<heap_entry>());
+		size_t run = heap.back().second;
+		heap.pop_back();
+
+		append(merged, runs[run][next[run]]);
+		if (++next[run] < runs[run].size()) {
+			heap.push_back(heap_entry(runs[run][next[run]].first, run));
+			push_heap(heap.begin(), heap.end(), greater<heap_entry>());
 		}
 	}
 
-	odb_close(&samples_db);
+	ordered_samples.swap(merged);
+	runs.clear();
 }
 
 
@@ -137,6 +306,8 @@ profile_t::samples_range(odb_key_t start, odb_key_t end) const
 	// This can happen on e.g. ARM kernels, where .init is
 	// mapped before .text - we just have to skip any such
 	// .init symbols.
+	merge_runs();
+
 	if (start < start_offset) {
 		return make_pair(const_iterator(ordered_samples.end(), 0), 
 			const_iterator(ordered_samples.end(), 0));
@@ -153,10 +324,11 @@ profile_t::samples_range(odb_key_t start, odb_key_t end) const
 			"oprofile-list@lists.sourceforge.net");
 	}
 
-	ordered_samples_t::const_iterator first = 
-		ordered_samples.lower_bound(start);
+	ordered_samples_t const & samples = ordered_samples;
+	ordered_samples_t::const_iterator first =
+		lower_bound(samples.begin(), samples.end(), start, key_less());
 	ordered_samples_t::const_iterator last =
-		ordered_samples.lower_bound(end);
+		lower_bound(first, samples.end(), end, key_less());
 
 	return make_pair(const_iterator(first, start_offset),
 		const_iterator(last, start_offset));
@@ -165,6 +337,8 @@ profile_t::samples_range(odb_key_t start, odb_key_t end) const
 
 profile_t::iterator_pair profile_t::samples_range() const
 {
+	merge_runs();
+
 	ordered_samples_t::const_iterator first = ordered_samples.begin();
 	ordered_samples_t::const_iterator last = ordered_samples.end();
 
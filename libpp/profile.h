@@ -14,7 +14,8 @@
 #define PROFILE_H
 
 #include <string>
-#include <map>
+#include <vector>
+#include <utility>
 #include <iterator>
 
 #include "odb.h"
@@ -54,6 +55,17 @@ public:
 	 */
 	static count_type sample_count(std::string const & filename);
 
+	/**
+	 * @param filename  sample filename
+	 * @param count  its sample count
+	 *
+	 * record the sample count of a sample file, read from the session
+	 * manifest by the caller, so that sample_count() doesn't need to
+	 * open the file
+	 */
+	static void set_sample_count(std::string const & filename,
+	                             count_type count);
+
 	/**
 	 * cumulate sample file to our container of samples
 	 * @param filename  sample file name
@@ -76,6 +88,9 @@ public:
 	 * @param end  end offset
 	 *
 	 * return an iterator pair to [start, end) range
+	 *
+	 * The first call after add_sample_file() merges the samples of all
+	 * files added, it must not race with another call on the same object.
 	 */
 	iterator_pair
 	samples_range(odb_key_t start, odb_key_t end) const;
@@ -89,19 +104,28 @@ private:
 	static void
 	open_sample_file(std::string const & filename, odb_t &);
 
+	/// merge the pending runs into ordered_samples
+	void merge_runs() const;
+
 	/// copy of the samples file header
 	scoped_ptr<opd_header> file_header;
 
 	/// storage type for samples sorted by eip
-	typedef std::map<odb_key_t, count_type> ordered_samples_t;
+	typedef std::vector<std::pair<odb_key_t, count_type> > ordered_samples_t;
 
 	/**
 	 * Samples are stored in hash table, iterating over hash table don't
 	 * provide any ordering, the above count() interface rely on samples
-	 * ordered by eip. This map is only a temporary storage where samples
-	 * are ordered by eip.
+	 * ordered by eip. This array is only a temporary storage where
+	 * samples are ordered by eip, with at most one entry per eip.
+	 */
+	mutable ordered_samples_t ordered_samples;
+
+	/**
+	 * samples of each file added since the last merge_runs(), each
+	 * sorted by eip and merged into ordered_samples on first use
 	 */
-	ordered_samples_t ordered_samples;
+	mutable std::vector<ordered_samples_t> runs;
 
 	/**
 	 * For certain profiles, such as kernel/modules, and anon
@@ -46,6 +46,17 @@ struct filename_by_samples {
 	double percent;
 };
 
+
+/// return the first sample at or after vma, searching forward from it
+profile_t::const_iterator
+skip_samples(profile_t::const_iterator it, profile_t::const_iterator end,
+             unsigned long long vma)
+{
+	while (it != end && it.vma() < vma)
+		++it;
+	return it;
+}
+
 }  // anon namespace
 
 
@@ -75,8 +86,17 @@ void profile_container::add(profile_t const & profile,
                             size_t pclass)
 {
 	string const image_name = abfd.get_filename();
+	image_name_id const image_id = image_names.create(image_name);
+	image_name_id const app_id = image_names.create(app_name);
 	count_type sym_count_total = 0;
 
+	// Symbols and samples are both sorted by address, so walk them
+	// together rather than searching the samples of each symbol: a
+	// symbol without samples then costs a single comparison.
+	profile_t::iterator_pair const all_samples = profile.samples_range();
+	profile_t::const_iterator cursor = all_samples.first;
+	unsigned long long last_start = 0;
+
 	for (symbol_index_t i = 0; i < abfd.syms.size(); ++i) {
 
 		unsigned long long start = 0, end = 0;
@@ -84,8 +104,21 @@ void profile_container::add(profile_t const & profile,
 
 		abfd.get_symbol_range(i, start, end);
 
-		profile_t::iterator_pair p_it =
-			profile.samples_range(start, end);
+		// see profile_t::samples_range() about symbols before the
+		// start offset
+		if (start < profile.get_offset())
+			continue;
+
+		// symbols are sorted by vma, their file offsets nearly always
+		// follow the same order but fall back to a search if not
+		if (start < last_start)
+			cursor = profile.samples_range(start, end).first;
+		last_start = start;
+
+		profile_t::iterator_pair p_it;
+		cursor = skip_samples(cursor, all_samples.second, start);
+		p_it.first = cursor;
+		p_it.second = skip_samples(cursor, all_samples.second, end);
 		count_type count = accumulate(p_it.first, p_it.second, 0ull);
 
 		// skip entries with no samples
@@ -112,8 +145,8 @@ void profile_container::add(profile_t const & profile,
 			}
 		}
 
-		symb_entry.image_name = image_names.create(image_name);
-		symb_entry.app_name = image_names.create(app_name);
+		symb_entry.image_name = image_id;
+		symb_entry.app_name = app_id;
 
 		symb_entry.sample.vma = abfd.syms[i].vma();
 		symbol_entry const * symbol = symbols->insert(symb_entry);
@@ -175,22 +208,22 @@ profile_container::select_symbols(symbol_choice & choice) const
 
 	double const threshold = choice.threshold / 100.0;
 
-	symbol_container::symbols_t::iterator it = symbols->begin();
-	symbol_container::symbols_t::iterator const end = symbols->end();
+	symbol_container::const_iterator it = symbols->begin();
+	symbol_container::const_iterator const end = symbols->end();
 
 	for (; it != end; ++it) {
 		if (choice.match_image
-		    && (image_names.name(it->image_name) != choice.image_name))
+		    && (image_names.name((*it)->image_name) != choice.image_name))
 			continue;
 
 		for (size_t j = 0; j < total_count.size(); j++) {
 			double const percent =
-					op_ratio(it->sample.counts[j], total_count[j]);
+					op_ratio((*it)->sample.counts[j], total_count[j]);
 
 			if (percent >= threshold) {
-				result.push_back(&*it);
+				result.push_back(*it);
 
-				choice.hints = it->output_hint(choice.hints);
+				choice.hints = (*it)->output_hint(choice.hints);
 				break;
 			}
 		}
@@ -336,12 +369,12 @@ symbol_entry const * profile_container::find(symbol_entry const & symbol) const
 	return symbols->find(symbol);
 }
 
-symbol_container::symbols_t::iterator profile_container::begin_symbol() const
+symbol_container::const_iterator profile_container::begin_symbol() const
 {
 	return symbols->begin();
 }
 
-symbol_container::symbols_t::iterator profile_container::end_symbol() const
+symbol_container::const_iterator profile_container::end_symbol() const
 {
 	return symbols->end();
 }
@@ -126,9 +126,9 @@ public:
 			   size_t linenr) const;
 
 	/// return an iterator to the first symbol
-	symbol_container::symbols_t::iterator begin_symbol() const;
+	symbol_container::const_iterator begin_symbol() const;
 	/// return an iterator to the last symbol
-	symbol_container::symbols_t::iterator end_symbol() const;
+	symbol_container::const_iterator end_symbol() const;
 
 	/// return iterator to the first samples
 	sample_container::samples_iterator begin() const;
@@ -14,6 +14,8 @@
 #include <iterator>
 #include <iostream>
 #include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
 
 #include "file_manip.h"
 #include "op_config.h"
@@ -24,6 +26,10 @@
 #include "op_exception.h"
 #include "op_header.h"
 #include "op_fileio.h"
+#include "cverb.h"
+#include "scan_dir.h"
+#include "op_sample_manifest.h"
+#include "profile.h"
 
 using namespace std;
 
@@ -220,6 +226,20 @@ bool comma_match(comma_list<T> const & cl, generic_spec<T> const & value)
 	return cl.match(value.value());
 }
 
+
+/// as above for a value read from the manifest, -1 standing for "all"
+template<typename T>
+bool comma_match(comma_list<T> const & cl, int value)
+{
+	if (!cl.is_set())
+		return true;
+
+	if (value == -1)
+		return false;
+
+	return cl.match(T(value));
+}
+
 }
 
 
@@ -561,8 +581,176 @@ static void warn_if_sampling_problems(string const & session_samples_dir)
 }  // anonymous namespace
 
 
+/**
+ * Skip the parts of a session directory which can't hold a sample file
+ * matching the spec: the directory of an image not matching image: or
+ * image-exclude:, a sample file not matching tgid:, tid: or cpu:, and call
+ * graph files if they are not wanted. The files kept are still checked by
+ * valid_candidate(), this only saves walking directories and parsing
+ * sample filenames it would reject.
+ */
+class profile_spec::sample_scan_filter : public scan_filter {
+public:
+	sample_scan_filter(profile_spec const & spec_, bool exclude_cg_)
+		: spec(spec_), exclude_cg(exclude_cg_), last_image_match(false) {
+		pthread_mutex_init(&lock, NULL);
+	}
+
+	~sample_scan_filter() {
+		pthread_mutex_destroy(&lock);
+	}
+
+	bool enter(vector<string> const & path) const;
+	bool keep(vector<string> const & path, string const & name) const;
+	/// the same checks for a sample file listed by the manifest
+	bool keep(op_manifest_entry const & entry) const;
+
+private:
+	/// image is the path of the image up to the first {dep}
+	bool match_image(string const & image) const;
+
+	profile_spec const & spec;
+	bool exclude_cg;
+	/// consecutive manifest entries are mostly for the same image
+	mutable string last_image;
+	mutable bool last_image_match;
+	/// locate_images is not thread safe
+	mutable pthread_mutex_t lock;
+};
+
+
+bool profile_spec::sample_scan_filter::enter(vector<string> const & path) const
+{
+	string const & name = path.back();
+
+	// see valid_candidate()
+	if (path.size() == 1)
+		return name == "{root}" || name == "{kern}";
+
+	if (exclude_cg && name.find("{cg}") != string::npos)
+		return false;
+
+	// PP:3.7 3.8 the image is given by the path up to the first {dep},
+	// see match()
+	if (name != "{dep}" || !spec.image_or_lib_image.empty())
+		return true;
+	if (find(path.begin(), path.end() - 1, name) != path.end() - 1)
+		return true;
+
+	string image;
+	for (size_t i = 1; i + 1 < path.size(); ++i)
+		image += "/" + path[i];
+
+	return match_image(image);
+}
+
+
+bool profile_spec::sample_scan_filter::match_image(string const & image) const
+{
+	pthread_mutex_lock(&lock);
+	string const simage =
+		fixup_image_spec(image, spec.extra_found_images);
+	pthread_mutex_unlock(&lock);
+
+	glob_filter filter(spec.image, spec.image_exclude);
+	return filter.match(simage);
+}
+
+
+bool profile_spec::sample_scan_filter::keep(vector<string> const & path,
+                                            string const & name) const
+{
+	if (path.empty() || is_jit_sample(name))
+		return false;
+
+	// PP:3.19 event_name.count.unitmask.tgid.tid.cpu
+	vector<string> parts = separate_token(name, '.');
+	if (parts.size() != 6)
+		return true;
+
+	generic_spec<pid_t> tgid;
+	generic_spec<pid_t> tid;
+	generic_spec<int> cpu;
+	try {
+		tgid.set(parts[3]);
+		tid.set(parts[4]);
+		cpu.set(parts[5]);
+	} catch (invalid_argument const &) {
+		// let valid_candidate() deal with it
+		return true;
+	}
+
+	return comma_match(spec.tgid, tgid) && comma_match(spec.tid, tid) &&
+		comma_match(spec.cpu, cpu);
+}
+
+
+bool profile_spec::sample_scan_filter::keep(op_manifest_entry const & entry) const
+{
+	if (!entry.parsed)
+		return !is_jit_sample(entry.path);
+
+	if (exclude_cg && entry.cg)
+		return false;
+
+	if (!comma_match(spec.tgid, entry.tgid) ||
+	    !comma_match(spec.tid, entry.tid) ||
+	    !comma_match(spec.cpu, entry.cpu))
+		return false;
+
+	if (!spec.image_or_lib_image.empty())
+		return true;
+
+	if (last_image.empty() || last_image != entry.image) {
+		last_image = entry.image;
+		last_image_match = match_image(last_image);
+	}
+	return last_image_match;
+}
+
+
+bool profile_spec::read_manifest(list<string> & files, string const & base_dir,
+                                 sample_scan_filter const & filter) const
+{
+	op_manifest * manifest = op_read_manifest(base_dir.c_str());
+	if (!manifest)
+		return false;
+
+	size_t const nr_entries = op_manifest_nr_entries(manifest);
+	size_t nr_counted = 0;
+	for (size_t i = 0; i < nr_entries; ++i) {
+		op_manifest_entry entry;
+		op_manifest_get_entry(manifest, i, &entry);
+		if (!filter.keep(entry))
+			continue;
+
+		// the manifest is only written when operf is done, but
+		// a sample file can have been removed or changed since
+		string const filename = base_dir + '/' + entry.path;
+		struct stat st;
+		if (stat(filename.c_str(), &st))
+			continue;
+		files.push_back(filename);
+
+		if (entry.parsed && entry.size && entry.size == u64(st.st_size) &&
+		    entry.mtime == u64(st.st_mtime)) {
+			profile_t::set_sample_count(filename, entry.total_samples);
+			++nr_counted;
+		}
+	}
+
+	op_free_manifest(manifest);
+
+	cverb << vdebug << "manifest of " << base_dir << ": " << nr_entries
+	      << " entries, " << files.size() << " kept, " << nr_counted
+	      << " sample counts known" << endl;
+
+	return nr_entries != 0;
+}
+
+
 list<string> profile_spec::generate_file_list(bool exclude_dependent,
-  bool exclude_cg) const
+  bool exclude_cg, int nr_jobs) const
 {
 	// FIXME: isn't remove_duplicates faster than doing this, then copy() ?
 	set<string> unique_files;
@@ -599,9 +787,9 @@ list<string> profile_spec::generate_file_list(bool exclude_dependent,
 		base_dir = op_realpath(base_dir);
 
 		list<string> files;
-		create_file_list(files, base_dir, "*", true);
-
-		if (!files.empty()) {
+		sample_scan_filter filter(*this, exclude_cg);
+		if (read_manifest(files, base_dir, filter) ||
+		    scan_dir(files, base_dir, filter, nr_jobs)) {
 			found_file = true;
 			warn_if_sampling_problems(base_dir + "/");
 		}
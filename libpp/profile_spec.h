@@ -45,11 +45,13 @@ public:
 	/**
 	 * @param exclude_dependent  whether to exclude dependent sub-images
 	 * @param exclude_cg  whether to exclude call graph file
+	 * @param nr_jobs  number of threads scanning the session directories
 	 *
 	 * Use the spec to generate the list of candidate sample files.
 	 */
 	std::list<std::string>
-	generate_file_list(bool exclude_dependent, bool exclude_cg) const;
+	generate_file_list(bool exclude_dependent, bool exclude_cg,
+	                   int nr_jobs) const;
 
 	/**
 	 * @param file_spec  the filename specification to check
@@ -65,8 +67,22 @@ public:
 	std::string get_archive_path() const;
 
 private:
+	class sample_scan_filter;
+
 	profile_spec();
 
+	/**
+	 * @param files  the sample files listed are appended here
+	 * @param base_dir  the session samples directory
+	 * @param filter  the sample files to leave out
+	 *
+	 * List the sample files of a session from the manifest written by
+	 * operf, return false if the session has no usable manifest.
+	 */
+	bool read_manifest(std::list<std::string> & files,
+	                   std::string const & base_dir,
+	                   sample_scan_filter const & filter) const;
+
 	/**
 	 * @param tag_value  a "tag:value" to interpret, all error throw an
 	 * invalid_argument exception.
@@ -0,0 +1,246 @@
+/**
+ * @file scan_dir.cpp
+ * Parallel listing of the files of a directory tree
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <algorithm>
+#include <deque>
+#include <iostream>
+
+#include "scan_dir.h"
+#include "utility.h"
+#include "cverb.h"
+
+using namespace std;
+
+namespace {
+
+/// a directory waiting for a thread to scan it
+struct dir_job {
+	string path;
+	vector<string> components;
+};
+
+
+/**
+ * Each thread walks its directories depth first. A thread finding a
+ * sub-directory while others are idle hands it over to them instead of
+ * walking it itself.
+ */
+class dir_scanner : noncopyable {
+public:
+	dir_scanner(scan_filter const & filter_, int nr_jobs);
+	~dir_scanner();
+
+	size_t scan(list<string> & result, string const & base_dir);
+
+private:
+	static void * scan_thread(void * arg);
+	void scan_loop();
+	void scan_fd(int fd, string const & path, vector<string> & components,
+	             vector<string> & found, size_t & nr_found);
+	bool share(string const & path, vector<string> const & components);
+
+	scan_filter const & filter;
+	int nr_threads;
+	deque<dir_job> jobs;
+	/// threads waiting for a job
+	size_t nr_idle;
+	/// threads scanning a job
+	size_t nr_busy;
+	vector<string> files;
+	size_t nr_entries;
+	pthread_mutex_t lock;
+	/// signaled when a job is queued or the last busy thread is done
+	pthread_cond_t changed;
+};
+
+
+dir_scanner::dir_scanner(scan_filter const & filter_, int nr_jobs)
+	:
+	filter(filter_),
+	nr_threads(nr_jobs),
+	nr_idle(0),
+	nr_busy(0),
+	nr_entries(0)
+{
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&changed, NULL);
+}
+
+
+dir_scanner::~dir_scanner()
+{
+	pthread_cond_destroy(&changed);
+	pthread_mutex_destroy(&lock);
+}
+
+
+size_t dir_scanner::scan(list<string> & result, string const & base_dir)
+{
+	dir_job job;
+	job.path = base_dir;
+	jobs.push_back(job);
+
+	// this thread is one of the scanning threads
+	vector<pthread_t> threads;
+	for (int i = 1; i < nr_threads; ++i) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, scan_thread, this))
+			break;
+		threads.push_back(thread);
+	}
+
+	scan_loop();
+
+	for (size_t i = 0; i < threads.size(); ++i)
+		pthread_join(threads[i], NULL);
+
+	cverb << vdebug << "scanned " << base_dir << " with "
+	      << threads.size() + 1 << " threads, " << files.size()
+	      << " files found" << endl;
+
+	result.insert(result.end(), files.begin(), files.end());
+	return nr_entries;
+}
+
+
+void * dir_scanner::scan_thread(void * arg)
+{
+	static_cast<dir_scanner *>(arg)->scan_loop();
+	return NULL;
+}
+
+
+void dir_scanner::scan_loop()
+{
+	pthread_mutex_lock(&lock);
+	for (;;) {
+		while (jobs.empty() && nr_busy) {
+			++nr_idle;
+			pthread_cond_wait(&changed, &lock);
+			--nr_idle;
+		}
+		// nothing queued and nobody left to queue something
+		if (jobs.empty())
+			break;
+
+		dir_job job;
+		job.path.swap(jobs.front().path);
+		job.components.swap(jobs.front().components);
+		jobs.pop_front();
+		++nr_busy;
+		pthread_mutex_unlock(&lock);
+
+		vector<string> found;
+		size_t nr_found = 0;
+		int fd = open(job.path.c_str(), O_RDONLY | O_DIRECTORY);
+		if (fd >= 0)
+			scan_fd(fd, job.path, job.components, found, nr_found);
+
+		pthread_mutex_lock(&lock);
+		files.insert(files.end(), found.begin(), found.end());
+		nr_entries += nr_found;
+		if (!--nr_busy && jobs.empty())
+			pthread_cond_broadcast(&changed);
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+
+bool dir_scanner::share(string const & path,
+                        vector<string> const & components)
+{
+	if (nr_threads == 1)
+		return false;
+
+	pthread_mutex_lock(&lock);
+	bool const shared = nr_idle > jobs.size();
+	if (shared) {
+		jobs.push_back(dir_job());
+		jobs.back().path = path;
+		jobs.back().components = components;
+		pthread_cond_signal(&changed);
+	}
+	pthread_mutex_unlock(&lock);
+
+	return shared;
+}
+
+
+/// scan the directory open as fd, closing fd
+void dir_scanner::scan_fd(int fd, string const & path,
+                          vector<string> & components,
+                          vector<string> & found, size_t & nr_found)
+{
+	DIR * dir = fdopendir(fd);
+	if (!dir) {
+		close(fd);
+		return;
+	}
+
+	struct dirent * ent;
+	while ((ent = readdir(dir)) != 0) {
+		char const * name = ent->d_name;
+		if (name[0] == '.' && (name[1] == '\0' ||
+		    (name[1] == '.' && name[2] == '\0')))
+			continue;
+
+		bool is_dir;
+		if (ent->d_type == DT_DIR) {
+			is_dir = true;
+		} else if (ent->d_type == DT_REG) {
+			is_dir = false;
+		} else {
+			// unknown type or symlink, stat() what it points to
+			struct stat st;
+			if (fstatat(dirfd(dir), name, &st, 0))
+				continue;
+			is_dir = S_ISDIR(st.st_mode);
+		}
+
+		string const entry_path = path + '/' + name;
+
+		if (!is_dir) {
+			++nr_found;
+			if (filter.keep(components, name))
+				found.push_back(entry_path);
+			continue;
+		}
+
+		components.push_back(name);
+		if (!filter.enter(components)) {
+			++nr_found;
+		} else if (!share(entry_path, components)) {
+			int sub_fd = openat(dirfd(dir), name,
+			                    O_RDONLY | O_DIRECTORY);
+			if (sub_fd >= 0) {
+				scan_fd(sub_fd, entry_path, components,
+				        found, nr_found);
+			}
+		}
+		components.pop_back();
+	}
+
+	closedir(dir);
+}
+
+}  // anonymous namespace
+
+
+size_t scan_dir(list<string> & files, string const & base_dir,
+                scan_filter const & filter, int nr_jobs)
+{
+	dir_scanner scanner(filter, max(nr_jobs, 1));
+	return scanner.scan(files, base_dir);
+}
@@ -0,0 +1,61 @@
+/**
+ * @file scan_dir.h
+ * Parallel listing of the files of a directory tree
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#ifndef SCAN_DIR_H
+#define SCAN_DIR_H
+
+#include <string>
+#include <list>
+#include <vector>
+
+/**
+ * Decide which parts of a directory tree scan_dir() walks and returns.
+ * Both functions can be called by several threads at once.
+ */
+class scan_filter {
+public:
+	virtual ~scan_filter() {}
+
+	/**
+	 * @param path  the directory, as its path components relative to
+	 *  the scanned directory
+	 *
+	 * return false to skip the directory and all it contains
+	 */
+	virtual bool enter(std::vector<std::string> const & path) const = 0;
+
+	/**
+	 * @param path  the directory holding the file, as for enter()
+	 * @param name  the file name
+	 *
+	 * return false to leave the file out of the result
+	 */
+	virtual bool keep(std::vector<std::string> const & path,
+	                  std::string const & name) const = 0;
+};
+
+
+/**
+ * @param files  the path of the files found is appended here, in no
+ *  particular order
+ * @param base_dir  the directory to scan
+ * @param filter  the directories and files to skip
+ * @param nr_jobs  number of threads scanning
+ *
+ * Recursively list the files of base_dir, following symlinks, like
+ * create_file_list() does. Entries are not stat()ed when the file system
+ * gives their type, sub-directories are opened relatively to their
+ * parent and are spread over nr_jobs threads.
+ *
+ * Return the number of files found plus the number of directories
+ * skipped, whether the filter kept them or not.
+ */
+size_t scan_dir(std::list<std::string> & files, std::string const & base_dir,
+                scan_filter const & filter, int nr_jobs);
+
+#endif /* !SCAN_DIR_H */
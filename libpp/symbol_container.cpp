@@ -11,29 +11,97 @@
 
 #include <string>
 #include <algorithm>
-#include <set>
 #include <vector>
 
 #include "symbol_container.h"
 
 using namespace std;
 
+namespace {
+
+/// hash the fields compared by less_symbol
+size_t hash_symbol(symbol_entry const & symbol)
+{
+	unsigned long long h = symbol.image_name.hash();
+	h = h * 31 + symbol.app_name.hash();
+	h = h * 31 + symbol.name.hash();
+	h = h * 31 + symbol.sample.vma;
+	h = h * 31 + symbol.size;
+	h ^= h >> 29;
+	h *= 0xbf58476d1ce4e5b9ULL;
+	h ^= h >> 32;
+	return size_t(h);
+}
+
+
+struct less_symbol_ptr {
+	bool operator()(symbol_entry const * lhs,
+			symbol_entry const * rhs) const {
+		return less_symbol()(*lhs, *rhs);
+	}
+};
+
+
+struct less_by_vma {
+	bool operator()(symbol_entry const * lhs,
+			symbol_entry const * rhs) const {
+		return lhs->sample.vma < rhs->sample.vma;
+	}
+};
+
+}  // anonymous namespace
+
+
 symbol_container::size_type symbol_container::size() const
 {
 	return symbols.size();
 }
 
 
+size_t symbol_container::find_slot(symbol_entry const & symbol) const
+{
+	less_symbol cmp;
+	size_t const mask = slots.size() - 1;
+	size_t slot = hash_symbol(symbol) & mask;
+	for (; slots[slot]; slot = (slot + 1) & mask) {
+		symbol_entry const & entry = symbols[slots[slot] - 1];
+		if (!cmp(entry, symbol) && !cmp(symbol, entry))
+			break;
+	}
+
+	return slot;
+}
+
+
+void symbol_container::rehash()
+{
+	vector<size_t> old_slots(max(slots.size() * 2, size_t(64)), 0);
+	slots.swap(old_slots);
+
+	for (size_t i = 0; i < old_slots.size(); ++i) {
+		if (old_slots[i])
+			slots[find_slot(symbols[old_slots[i] - 1])] = old_slots[i];
+	}
+}
+
+
 symbol_entry const * symbol_container::insert(symbol_entry const & symb)
 {
-	pair<symbols_t::iterator, bool> p = symbols.insert(symb);
-	if (!p.second) {
-		// safe: count is not used by sorting criteria
-		symbol_entry * symbol = const_cast<symbol_entry*>(&*p.first);
-		symbol->sample.counts += symb.sample.counts;
+	// keep the load factor under one half
+	if (2 * (symbols.size() + 1) > slots.size())
+		rehash();
+
+	size_t const slot = find_slot(symb);
+	if (slots[slot]) {
+		symbol_entry & symbol = symbols[slots[slot] - 1];
+		symbol.sample.counts += symb.sample.counts;
+		return &symbol;
 	}
 
-	return &*p.first;
+	symbols.push_back(symb);
+	slots[slot] = symbols.size();
+
+	return &symbols.back();
 }
 
 
@@ -46,14 +114,11 @@ symbol_container::find(debug_name_id filename, size_t linenr) const
 	symbol.sample.file_loc.filename = filename;
 	symbol.sample.file_loc.linenr = linenr;
 
-	symbol_collection result;
-
-	typedef symbols_by_loc_t::const_iterator it;
-	pair<it, it> p_it = symbols_by_loc.equal_range(&symbol);
-	for ( ; p_it.first != p_it.second; ++p_it.first)
-		result.push_back(*p_it.first);
+	typedef symbol_collection::const_iterator it;
+	pair<it, it> p_it = equal_range(by_loc.begin(), by_loc.end(),
+	                                &symbol, less_by_file_loc());
 
-	return result;
+	return symbol_collection(p_it.first, p_it.second);
 }
 
 
@@ -66,59 +131,93 @@ symbol_container::find(debug_name_id filename) const
 	symbol.sample.file_loc.filename = filename;
 	symbol.sample.file_loc.linenr = 0;
 
-	typedef symbols_by_loc_t::const_iterator it;
-	it first = symbols_by_loc.lower_bound(&symbol);
+	typedef symbol_collection::const_iterator it;
+	it first = lower_bound(by_loc.begin(), by_loc.end(), &symbol,
+	                       less_by_file_loc());
 	symbol.sample.file_loc.linenr = (unsigned int)size_t(-1);
-	it last  = symbols_by_loc.upper_bound(&symbol);
+	it last = upper_bound(first, it(by_loc.end()), &symbol,
+	                      less_by_file_loc());
 
-	symbol_collection result;
-	for ( ; first != last ; ++first)
-		result.push_back(*first);
-
-	return result;
+	return symbol_collection(first, last);
 }
 
 
-void symbol_container::build_by_loc() const
+void symbol_container::build_sorted() const
 {
-	if (!symbols_by_loc.empty())
+	if (sorted.size() == symbols.size())
 		return;
 
+	sorted.clear();
+	sorted.reserve(symbols.size());
 	symbols_t::const_iterator cit = symbols.begin();
 	symbols_t::const_iterator end = symbols.end();
 	for (; cit != end; ++cit)
-		symbols_by_loc.insert(&*cit);
+		sorted.push_back(&*cit);
+
+	sort(sorted.begin(), sorted.end(), less_symbol_ptr());
+}
+
+
+void symbol_container::build_by_loc() const
+{
+	if (by_loc.size() == symbols.size())
+		return;
+
+	build_sorted();
+	by_loc = sorted;
+	stable_sort(by_loc.begin(), by_loc.end(), less_by_file_loc());
+}
+
+
+void symbol_container::build_by_vma() const
+{
+	if (by_vma.size() == symbols.size())
+		return;
+
+	build_sorted();
+	by_vma = sorted;
+	stable_sort(by_vma.begin(), by_vma.end(), less_by_vma());
 }
 
 
 symbol_entry const * symbol_container::find_by_vma(string const & image_name,
 						   bfd_vma vma) const
 {
-	// FIXME: this is too inefficient probably
-	symbols_t::const_iterator it;
-	for (it = symbols.begin(); it != symbols.end(); ++it) {
-		if (it->sample.vma == vma &&
-		    image_names.name(it->image_name) == image_name)
-			return &*it;
+	build_by_vma();
+
+	symbol_entry symbol;
+	symbol.sample.vma = vma;
+
+	typedef symbol_collection::const_iterator it;
+	pair<it, it> p_it = equal_range(by_vma.begin(), by_vma.end(),
+	                                &symbol, less_by_vma());
+	for (; p_it.first != p_it.second; ++p_it.first) {
+		if (image_names.name((*p_it.first)->image_name) == image_name)
+			return *p_it.first;
 	}
 
 	return 0;
 }
 
 
-symbol_container::symbols_t::iterator symbol_container::begin()
+symbol_container::const_iterator symbol_container::begin() const
 {
-	return symbols.begin();
+	build_sorted();
+	return sorted.begin();
 }
 
 
-symbol_container::symbols_t::iterator symbol_container::end()
+symbol_container::const_iterator symbol_container::end() const
 {
-	return symbols.end();
+	build_sorted();
+	return sorted.end();
 }
 
 symbol_entry const * symbol_container::find(symbol_entry const & symbol) const
 {
-	symbols_t::const_iterator it = symbols.find(symbol);
-	return it == symbols.end() ? 0 : &*it;
+	if (slots.empty())
+		return 0;
+
+	size_t const slot = find_slot(symbol);
+	return slots[slot] ? &symbols[slots[slot] - 1] : 0;
 }
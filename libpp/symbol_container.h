@@ -13,7 +13,8 @@
 #define SYMBOL_CONTAINER_H
 
 #include <string>
-#include <set>
+#include <deque>
+#include <vector>
 
 #include "symbol.h"
 #include "symbol_functors.h"
@@ -22,16 +23,22 @@
  * An arbitrary container of symbols. Supports lookup
  * by name, by VMA, and by file location.
  *
- * Lookup by name or by VMA is O(n). Lookup by file location
- * is O(log(n)).
+ * Symbols are appended to the container and hashed on the fields
+ * less_symbol compares (image, application, name, vma and size) to merge
+ * duplicates. The sorted views used for iteration and
+ * for lookup by VMA or by file location are built on the first use
+ * after an insertion; lookup through them is O(log(n)).
  */
 class symbol_container {
 public:
 	/// container type
-	typedef std::set<symbol_entry, less_symbol> symbols_t;
+	typedef std::deque<symbol_entry> symbols_t;
 
 	typedef symbols_t::size_type size_type;
 
+	/// iterator over the symbols in less_symbol order
+	typedef symbol_collection::const_iterator const_iterator;
+
 	/// return the number of symbols stored
 	size_type size() const;
 
@@ -41,8 +48,7 @@ public:
 	 * Returns the newly created symbol or the existing one. This pointer
 	 * remains valid during the whole life time of a symbol_container
 	 * object and is warranted unique according to less_symbol comparator.
-	 * Can only be done before any file-location based lookups, since the
-	 * two lookup methods are not synchronised.
+	 * Invalidates the iterators returned by begin() and end().
 	 */
 	symbol_entry const * insert(symbol_entry const &);
 
@@ -60,35 +66,51 @@ public:
 	symbol_entry const * find(symbol_entry const & symbol) const;
 
 	/// return start of symbols
-	symbols_t::iterator begin();
+	const_iterator begin() const;
 
 	/// return end of symbols
-	symbols_t::iterator end();
+	const_iterator end() const;
 
 private:
-	/// build the symbol by file-location cache
+	/// return the hash slot of symbol, or of the empty slot it goes to
+	size_t find_slot(symbol_entry const & symbol) const;
+
+	/// grow the hash table
+	void rehash();
+
+	/// build the symbol by less_symbol order view
+	void build_sorted() const;
+
+	/// build the symbol by file-location view
 	void build_by_loc() const;
 
+	/// build the symbol by vma view
+	void build_by_vma() const;
+
 	/**
 	 * The main container of symbols. Multiple symbols with the same
-	 * name are allowed.
+	 * name are allowed. A deque so the symbols never move.
 	 */
 	symbols_t symbols;
 
 	/**
-	 * Differently-named symbol at same file location are allowed e.g.
-	 * template instantiation.
+	 * Open addressing hash table of symbols, a slot holds an index
+	 * in symbols plus one, zero for an empty slot.
 	 */
-	typedef std::multiset<symbol_entry const *, less_by_file_loc>
-		symbols_by_loc_t;
+	std::vector<size_t> slots;
 
-	// must be declared after the set to ensure a correct life-time.
+	/// Symbols sorted by less_symbol. Lazily built, so mutable.
+	mutable symbol_collection sorted;
 
 	/**
-	 * Symbols sorted by location order. Lazily built on request,
-	 * so mutable.
+	 * Symbols sorted by location order, then by less_symbol.
+	 * Differently-named symbol at same file location are allowed e.g.
+	 * template instantiation.
 	 */
-	mutable symbols_by_loc_t symbols_by_loc;
+	mutable symbol_collection by_loc;
+
+	/// Symbols sorted by vma, then by less_symbol.
+	mutable symbol_collection by_vma;
 };
 
 #endif /* SYMBOL_CONTAINER_H */
@@ -0,0 +1,261 @@
+/**
+ * @file symbol_container_tests.cpp
+ * tests symbol_container against the set based container it replaced
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+
+#include "symbol_container.h"
+#include "symbol_functors.h"
+#include "name_storage.h"
+#include "demangle_symbol.h"
+#include "cverb.h"
+
+using namespace std;
+
+// defined by the pp tools options, which this test doesn't need
+namespace options {
+	demangle_type demangle = dmt_none;
+	bool demangle_cache;
+}
+
+// defined by op_bfd.cpp, which this test doesn't need
+verbose vbfd("bfd");
+
+namespace {
+
+/**
+ * The symbol_container before the sorted views: a set merging duplicates,
+ * a multiset by file location filled in set order, and a walk of the set
+ * for lookups by vma.
+ */
+class reference_container {
+public:
+	void insert(symbol_entry const & symb) {
+		pair<symbols_t::iterator, bool> p = symbols.insert(symb);
+		if (!p.second) {
+			symbol_entry * symbol = const_cast<symbol_entry*>(&*p.first);
+			symbol->sample.counts += symb.sample.counts;
+		}
+	}
+
+	symbol_collection const find(debug_name_id filename, size_t linenr) {
+		build_by_loc();
+		symbol_entry symbol;
+		symbol.sample.file_loc.filename = filename;
+		symbol.sample.file_loc.linenr = linenr;
+		typedef symbols_by_loc_t::const_iterator it;
+		pair<it, it> p_it = by_loc.equal_range(&symbol);
+		return symbol_collection(p_it.first, p_it.second);
+	}
+
+	symbol_collection const find(debug_name_id filename) {
+		build_by_loc();
+		symbol_entry symbol;
+		symbol.sample.file_loc.filename = filename;
+		symbol.sample.file_loc.linenr = 0;
+		typedef symbols_by_loc_t::const_iterator it;
+		it first = by_loc.lower_bound(&symbol);
+		symbol.sample.file_loc.linenr = (unsigned int)size_t(-1);
+		it last = by_loc.upper_bound(&symbol);
+		return symbol_collection(first, last);
+	}
+
+	symbol_entry const * find_by_vma(string const & image_name,
+	                                 bfd_vma vma) const {
+		symbols_t::const_iterator it;
+		for (it = symbols.begin(); it != symbols.end(); ++it) {
+			if (it->sample.vma == vma &&
+			    image_names.name(it->image_name) == image_name)
+				return &*it;
+		}
+		return 0;
+	}
+
+	symbol_collection const sorted() const {
+		symbol_collection result;
+		symbols_t::const_iterator it;
+		for (it = symbols.begin(); it != symbols.end(); ++it)
+			result.push_back(&*it);
+		return result;
+	}
+
+private:
+	typedef set<symbol_entry, less_symbol> symbols_t;
+	typedef multiset<symbol_entry const *, less_by_file_loc>
+		symbols_by_loc_t;
+
+	void build_by_loc() {
+		if (!by_loc.empty())
+			return;
+		symbols_t::const_iterator it;
+		for (it = symbols.begin(); it != symbols.end(); ++it)
+			by_loc.insert(&*it);
+	}
+
+	symbols_t symbols;
+	symbols_by_loc_t by_loc;
+};
+
+
+size_t const nr_images = 3;
+size_t const nr_files = 4;
+/// small ranges so the symbols collide on every key
+unsigned int const max_vma = 64;
+unsigned int const max_line = 8;
+
+image_name_id images[nr_images];
+debug_name_id files[nr_files];
+
+
+string image_path(size_t i)
+{
+	ostringstream path;
+	path << "/lib/lib" << i << ".so";
+	return path.str();
+}
+
+
+void create_names()
+{
+	for (size_t i = 0; i < nr_images; ++i)
+		images[i] = image_names.create(image_path(i));
+	for (size_t i = 0; i < nr_files; ++i) {
+		ostringstream path;
+		path << "/src/file" << i << ".c";
+		files[i] = debug_names.create(path.str());
+	}
+}
+
+
+symbol_entry random_symbol()
+{
+	symbol_entry symb;
+	symb.image_name = images[rand() % nr_images];
+	symb.app_name = rand() % 4 ? symb.image_name : images[0];
+	ostringstream name;
+	name << "f" << rand() % 16;
+	symb.name = symbol_names.create(name.str());
+	symb.sample.vma = rand() % max_vma;
+	symb.size = rand() % 2 ? 16 : 32;
+	symb.sample.file_loc.filename = files[rand() % nr_files];
+	symb.sample.file_loc.linenr = rand() % max_line;
+	symb.sample.counts[0] = rand() % 100;
+	symb.sample.counts[1] = rand() % 3;
+	return symb;
+}
+
+
+bool same_symbol(symbol_entry const * lhs, symbol_entry const * rhs)
+{
+	less_symbol cmp;
+	return !cmp(*lhs, *rhs) && !cmp(*rhs, *lhs) &&
+		lhs->sample.file_loc.filename == rhs->sample.file_loc.filename &&
+		lhs->sample.file_loc.linenr == rhs->sample.file_loc.linenr &&
+		lhs->sample.counts[0] == rhs->sample.counts[0] &&
+		lhs->sample.counts[1] == rhs->sample.counts[1];
+}
+
+
+void check_same(symbol_collection const & result,
+                symbol_collection const & expected, string const & what)
+{
+	size_t i = 0;
+	while (i < result.size() && i < expected.size() &&
+	       same_symbol(result[i], expected[i]))
+		++i;
+	if (i < result.size() || i < expected.size()) {
+		cerr << what << ": symbol " << i << " differs, got "
+		     << result.size() << " symbols, expected "
+		     << expected.size() << endl;
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+void check_container(symbol_container const & symbols,
+                     reference_container & reference)
+{
+	symbol_collection const sorted(symbols.begin(), symbols.end());
+	check_same(sorted, reference.sorted(), "iteration");
+
+	for (size_t i = 0; i < nr_files; ++i) {
+		ostringstream what;
+		what << "find(file" << i << ")";
+		check_same(symbols.find(files[i]), reference.find(files[i]),
+		           what.str());
+		for (unsigned int line = 0; line <= max_line; ++line) {
+			ostringstream what;
+			what << "find(file" << i << ", " << line << ")";
+			check_same(symbols.find(files[i], line),
+			           reference.find(files[i], line), what.str());
+		}
+	}
+
+	for (size_t i = 0; i < nr_images; ++i) {
+		string const image = image_path(i);
+		for (bfd_vma vma = 0; vma <= max_vma; ++vma) {
+			symbol_entry const * result =
+				symbols.find_by_vma(image, vma);
+			symbol_entry const * expected =
+				reference.find_by_vma(image, vma);
+			if ((result != 0) != (expected != 0) ||
+			    (result && !same_symbol(result, expected))) {
+				cerr << "find_by_vma(" << image << ", "
+				     << vma << ") differs" << endl;
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+}
+
+
+void check_random_symbols()
+{
+	srand(1);
+	create_names();
+
+	symbol_container symbols;
+	reference_container reference;
+	for (size_t i = 0; i < 4000; ++i) {
+		symbol_entry const symb = random_symbol();
+		symbol_entry const * p = symbols.insert(symb);
+		reference.insert(symb);
+		if (!p || symbols.find(symb) != p) {
+			cerr << "find() doesn't return the inserted symbol"
+			     << endl;
+			exit(EXIT_FAILURE);
+		}
+		// the sorted view is rebuilt after insertions
+		if (i % 1000 == 999) {
+			symbol_collection const sorted(symbols.begin(),
+			                               symbols.end());
+			check_same(sorted, reference.sorted(), "iteration");
+		}
+	}
+
+	check_container(symbols, reference);
+
+	symbol_entry absent = random_symbol();
+	absent.sample.vma = max_vma + 1;
+	if (symbols.find(absent)) {
+		cerr << "find() returns a symbol never inserted" << endl;
+		exit(EXIT_FAILURE);
+	}
+}
+
+}  // anonymous namespace
+
+
+int main()
+{
+	check_random_symbols();
+	return EXIT_SUCCESS;
+}
@@ -9,12 +9,16 @@
  */
 
 #include <cstdlib>
+#include <algorithm>
+#include <exception>
+#include <pthread.h>
 
 #include "config.h"
 
 #include "demangle_symbol.h"
 #include "demangle_java_symbol.h"
 #include "op_regex.h"
+#include "op_exception.h"
 
 // from libiberty
 /*@{\name demangle option parameter */
@@ -33,11 +37,12 @@ namespace options {
 	extern demangle_type demangle;
 }
 
-string const demangle_symbol(string const & name)
-{
-	if (options::demangle == dmt_none)
-		return name;
+namespace {
 
+/// demangle name, simplifying the result with regex if not NULL
+string const demangle(string const & name,
+                      regular_expression_replace const * regex)
+{
 	// Do not try to strip leading underscore, as this leads to many
 	// C++ demangling failures. However we strip off a leading '.'
         // as generated on PPC64
@@ -54,17 +59,125 @@ string const demangle_symbol(string const & name)
 	string result(unmangled);
 	free(unmangled);
 
-	if (options::demangle == dmt_smart) {
-		static bool init = false;
-		static regular_expression_replace regex;
-		if (init == false) {
-			setup_regex(regex, OP_DATADIR "/stl.pat");
-			init = true;
+	// we don't protect against exception here, pattern must be
+	// right and user can easily work-around by using -d
+	if (regex)
+		regex->execute(result);
+
+	return result;
+}
+
+
+/// the share of demangle_symbols() done by one thread
+struct demangle_job {
+	vector<string> const * names;
+	vector<string> * result;
+	/// this job demangles names first, first + step, ...
+	size_t first;
+	size_t step;
+	/// NULL unless smart demangling, regex can't be shared by threads
+	regular_expression_replace const * regex;
+	/// what() of an exception thrown while demangling
+	string error;
+};
+
+
+void * demangle_thread(void * arg)
+{
+	demangle_job * job = static_cast<demangle_job *>(arg);
+
+	try {
+		for (size_t i = job->first; i < job->names->size();
+		     i += job->step) {
+			(*job->result)[i] =
+				demangle((*job->names)[i], job->regex);
 		}
-		// we don't protect against exception here, pattern must be
-		// right and user can easily work-around by using -d
-		regex.execute(result);
+	} catch (exception const & e) {
+		job->error = e.what();
 	}
 
-	return result;
+	return NULL;
+}
+
+}  // anonymous namespace
+
+
+string const demangle_symbol(string const & name)
+{
+	if (options::demangle == dmt_none)
+		return name;
+
+	if (options::demangle != dmt_smart)
+		return demangle(name, 0);
+
+	static bool init = false;
+	static regular_expression_replace regex;
+	if (init == false) {
+		setup_regex(regex, OP_DATADIR "/stl.pat");
+		init = true;
+	}
+
+	return demangle(name, &regex);
+}
+
+
+void demangle_symbols(vector<string> const & names, vector<string> & result,
+                      int nr_jobs)
+{
+	result.resize(names.size());
+
+	if (options::demangle == dmt_none) {
+		result = names;
+		return;
+	}
+
+	// not worth a thread for a few symbols
+	size_t const nr_threads =
+		min(size_t(max(nr_jobs, 1)), names.size() / 64 + 1);
+
+	vector<demangle_job> jobs(nr_threads);
+	for (size_t i = 0; i < nr_threads; ++i) {
+		jobs[i].names = &names;
+		jobs[i].result = &result;
+		jobs[i].first = i;
+		jobs[i].step = nr_threads;
+		jobs[i].regex = 0;
+		if (options::demangle == dmt_smart) {
+			regular_expression_replace * regex =
+				new regular_expression_replace;
+			jobs[i].regex = regex;
+			try {
+				setup_regex(*regex, OP_DATADIR "/stl.pat");
+			} catch (...) {
+				for (size_t j = 0; j <= i; ++j)
+					delete jobs[j].regex;
+				throw;
+			}
+		}
+	}
+
+	// this thread does the first job
+	vector<pthread_t> threads;
+	for (size_t i = 1; i < nr_threads; ++i) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, demangle_thread, &jobs[i])) {
+			demangle_thread(&jobs[i]);
+			continue;
+		}
+		threads.push_back(thread);
+	}
+	demangle_thread(&jobs[0]);
+
+	for (size_t i = 0; i < threads.size(); ++i)
+		pthread_join(threads[i], NULL);
+
+	string error;
+	for (size_t i = 0; i < nr_threads; ++i) {
+		if (error.empty())
+			error = jobs[i].error;
+		delete jobs[i].regex;
+	}
+
+	if (!error.empty())
+		throw op_runtime_error(error);
 }
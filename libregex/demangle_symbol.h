@@ -12,6 +12,7 @@
 #define DEMANGLE_SYMBOL_H
 
 #include <string>
+#include <vector>
 
 /// demangle type: specify what demangling we use
 enum demangle_type {
@@ -37,4 +38,16 @@ enum demangle_type {
  */
 std::string const demangle_symbol(std::string const & name);
 
+/**
+ * demangle_symbols - demangle many symbols at once
+ * @param names the mangled symbol names
+ * @param result the demangled names, in the same order
+ * @param nr_jobs number of threads demangling
+ *
+ * Same as calling demangle_symbol() for each name, the names are
+ * spread over nr_jobs threads.
+ */
+void demangle_symbols(std::vector<std::string> const & names,
+                      std::vector<std::string> & result, int nr_jobs);
+
 #endif // DEMANGLE_SYMBOL_H
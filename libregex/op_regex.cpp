@@ -11,6 +11,8 @@
  */
 
 #include <cerrno>
+#include <cctype>
+#include <cstring>
 
 #include <iostream>
 #include <fstream>
@@ -69,6 +71,75 @@ size_t subexpr_index(char ch)
 	return size_t(-1);
 }
 
+
+// return the longest string any match of the POSIX extended regular
+// expression pattern contains, empty if none can be found. Only the
+// literal characters outside of any group are considered so this is
+// conservative.
+string required_literal(string const & pattern)
+{
+	string best, run;
+	size_t depth = 0;
+
+	for (size_t i = 0; i < pattern.length(); ++i) {
+		char ch = pattern[i];
+		bool literal = false;
+
+		if (ch == '\\' && i + 1 < pattern.length()) {
+			ch = pattern[++i];
+			// \<, \>, \w, \1 etc. aren't literal characters
+			literal = !isalnum((unsigned char)ch) &&
+				!strchr("<>`'", ch);
+		} else if (ch == '(') {
+			++depth;
+		} else if (ch == ')') {
+			if (depth)
+				--depth;
+		} else if (ch == '|') {
+			// alternation at the top level, nothing is required
+			if (!depth)
+				return string();
+		} else if (ch == '[') {
+			// skip the bracket expression, ']' can come first
+			size_t end = i + 1;
+			if (end < pattern.length() && pattern[end] == '^')
+				++end;
+			if (end < pattern.length() && pattern[end] == ']')
+				++end;
+			for (; end < pattern.length() && pattern[end] != ']';
+			     ++end) {
+				if (pattern[end] == '[' &&
+				    end + 1 < pattern.length() &&
+				    strchr(":.=", pattern[end + 1])) {
+					end = pattern.find(']', end + 2);
+					if (end == string::npos)
+						return string();
+				}
+			}
+			i = end;
+		} else {
+			literal = !strchr(".^$*+?{}", ch);
+		}
+
+		// a quantified character is optional or repeated
+		bool quantified = i + 1 < pattern.length() &&
+			strchr("*+?{", pattern[i + 1]);
+
+		if (literal && !quantified && !depth) {
+			run += ch;
+		} else {
+			if (run.length() > best.length())
+				best = run;
+			run.erase();
+		}
+	}
+
+	if (run.length() > best.length())
+		best = run;
+
+	return best;
+}
+
 }  // anonymous namespace
 
 
@@ -108,7 +179,8 @@ void regular_expression_replace::add_pattern(string const & pattern,
 
 	regex_t regexp;
 	op_regcomp(regexp, expanded_pattern);
-	replace_t regex = { regexp, replace };
+	replace_t regex = { regexp, replace,
+			    required_literal(expanded_pattern) };
 	regex_replace.push_back(regex);
 }
 
@@ -185,13 +257,23 @@ bool regular_expression_replace::execute(string & str) const
 }
 
 
+bool regular_expression_replace::may_match(string const & str,
+                                           replace_t const & regexp) const
+{
+	// most names contain none of the literals, strstr() is much
+	// cheaper than regexec() to tell so
+	return regexp.literal.empty() ||
+		strstr(str.c_str(), regexp.literal.c_str());
+}
+
+
 bool regular_expression_replace::do_execute(string & str,
                                             replace_t const & regexp) const
 {
 	bool changed = false;
 
 	regmatch_t match[max_match];
-	for (size_t iter = 0;
+	for (size_t iter = 0; may_match(str, regexp) &&
 	     op_regexec(regexp.regexp, str, match, max_match) && iter < limit;
 	     iter++) {
 		changed = true;
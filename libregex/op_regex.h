@@ -87,8 +87,14 @@ private:
 		regex_t regexp;
 		// replace the matched part with this string
 		std::string replace;
+		// a string all matches contain, empty if none is known
+		std::string literal;
 	};
 
+	// helper to execute, false if regexp can't match str
+	bool may_match(std::string const & str,
+		       replace_t const & regexp) const;
+
 	// helper to execute
 	bool do_execute(std::string & str, replace_t const & regexp) const;
 	void do_replace(std::string & str, std::string const & replace,
@@ -0,0 +1,124 @@
+/**
+ * @file regex_bench.cpp
+ *
+ * Measure how many names per second the stl.pat rules handle. Run it
+ * through:
+ * $ regex_bench
+ * or
+ * $ regex_bench filename [seconds]
+ * the names are the input names of mangled-name, see regex_test.cpp,
+ * then names matching none of the rules, as most names of a program,
+ * then both.
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include "string_manip.h"
+
+#include "op_regex.h"
+
+#include <sys/time.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <cstdlib>
+
+using namespace std;
+
+/// the input names of the test file, the expected output are skipped
+static void read_names(istream & fin, vector<string> & names)
+{
+	string line;
+	bool first = true;
+	while (getline(fin, line)) {
+		line = trim(line);
+		if (line.length() == 0 || line[0] == '#')
+			continue;
+		if (first)
+			names.push_back(line);
+		first = !first;
+	}
+}
+
+
+/// names matching none of the rules
+static void plain_names(vector<string> & names, size_t nr)
+{
+	for (size_t i = 0; i < nr; ++i) {
+		ostringstream os;
+		os << "ns" << i % 17 << "::class_" << i << "::method_"
+		   << i % 5 << "(int, char const*, class_" << i / 3
+		   << "&) const";
+		names.push_back(os.str());
+	}
+}
+
+
+static double now()
+{
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+
+/// run rep on names for about seconds, return the names per second
+static double bench(regular_expression_replace const & rep,
+                    vector<string> const & names, double seconds)
+{
+	size_t nr_names = 0;
+	double const start = now();
+	double elapsed;
+	do {
+		for (size_t i = 0; i < names.size(); ++i) {
+			string str(names[i]);
+			rep.execute(str);
+		}
+		nr_names += names.size();
+		elapsed = now() - start;
+	} while (elapsed < seconds);
+
+	return nr_names / elapsed;
+}
+
+
+int main(int argc, char * argv[])
+{
+	char const * filename = argc > 1 ? argv[1] : "mangled-name";
+	double const seconds = argc > 2 ? atof(argv[2]) : 1.0;
+
+	try {
+		regular_expression_replace rep;
+		setup_regex(rep, "../stl.pat");
+
+		ifstream fin(filename);
+		if (!fin) {
+			cerr << "Unable to open input test \"" << filename
+			     << "\"" << endl;
+			exit(EXIT_FAILURE);
+		}
+
+		vector<string> stl_names;
+		read_names(fin, stl_names);
+		vector<string> names;
+		plain_names(names, stl_names.size() * 9);
+
+		cout << "stl names:   " << size_t(bench(rep, stl_names, seconds))
+		     << " names/s" << endl;
+		cout << "plain names: " << size_t(bench(rep, names, seconds))
+		     << " names/s" << endl;
+		names.insert(names.end(), stl_names.begin(), stl_names.end());
+		cout << "mixed names: " << size_t(bench(rep, names, seconds))
+		     << " names/s" << endl;
+	}
+	catch (exception const & e) {
+		cerr << "exception: " << e.what() << endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
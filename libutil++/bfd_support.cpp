@@ -21,6 +21,7 @@
 #include "op_exception.h"
 #include "op_bfd_wrappers.h"
 
+#include <sys/stat.h>
 #include <unistd.h>
 #include <errno.h>
 #include <elf.h>
@@ -28,10 +29,12 @@
 #include <cstring>
 #include <cassert>
 #include <iostream>
+#include <iomanip>
 #include <sstream>
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <vector>
 #include <cstring>
 #include <cstdlib>
 
@@ -123,6 +126,35 @@ static bool find_debuginfo_file_by_buildid(unsigned char * buildid, string & deb
 	return retval;
 }
 
+/// the separate debug files to try, in order, for a .gnu_debuglink basename
+static vector<string>
+debug_link_candidates(string const & filepath, string const & basename)
+{
+	// Work out the image file's directory prefix
+	string filedir = op_dirname(filepath);
+	// Make sure it starts with /
+	if (filedir.size() > 0 && filedir.at(filedir.size() - 1) != '/')
+		filedir += '/';
+
+	vector<string> tries;
+	tries.push_back(filedir + ".debug/" + basename);
+	tries.push_back(DEBUGDIR + filedir + basename);
+	tries.push_back(filedir + basename);
+	return tries;
+}
+
+
+/// append the path, mtime and size of an existing file to key
+static void add_file_key(ostringstream & key, string const & path)
+{
+	struct stat st;
+
+	if (stat(path.c_str(), &st))
+		return;
+	key << path << ':' << st.st_mtime << ':' << st.st_size << ';';
+}
+
+
 static bool get_build_id(bfd * ibfd, unsigned char * build_id)
 {
 	Elf32_Nhdr op_note_hdr;
@@ -425,32 +457,69 @@ bool find_separate_debug_file(bfd * ibfd, string const & filepath_in,
 	 * debuginfo file's CRC.  But in practice, we shouldn't ever run into such
 	 * a scenario since the build-id should always be available.
 	 */
-
-	// Work out the image file's directory prefix
-	string filedir = op_dirname(filepath);
-	// Make sure it starts with /
-	if (filedir.size() > 0 && filedir.at(filedir.size() - 1) != '/')
-		filedir += '/';
-
-	string first_try(filedir + ".debug/" + basename);
-	string second_try(DEBUGDIR + filedir + basename);
-	string third_try(filedir + basename);
+	vector<string> const tries = debug_link_candidates(filepath, basename);
 
 	ostringstream message;
 	message << "looking for debugging file " << basename
 	        << " with crc32 = " << hex << crc32 << endl;
 	cverb << vbfd << message.str();
 
-	if (separate_debug_file_exists(first_try, crc32, extra)) 
-		debug_filename = first_try; 
-	else if (separate_debug_file_exists(second_try, crc32, extra))
-		debug_filename = second_try;
-	else if (separate_debug_file_exists(third_try, crc32, extra))
-		debug_filename = third_try;
-	else
-		return false;
-	
-	return true;
+	for (size_t i = 0; i < tries.size(); ++i) {
+		string name = tries[i];
+		if (separate_debug_file_exists(name, crc32, extra)) {
+			debug_filename = name;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+string separate_debug_file_key(bfd * ibfd, string const & filepath,
+                               extra_images const & extra)
+{
+	ostringstream key;
+	string basename;
+	string debug_filename;
+	unsigned long crc32 = 0;
+	unsigned char buildid[64];
+
+	if (get_build_id(ibfd, buildid) &&
+	    find_debuginfo_file_by_buildid(buildid, debug_filename)) {
+		add_file_key(key, debug_filename);
+		return key.str();
+	}
+
+	if (!get_debug_link_info(ibfd, basename, crc32))
+		return key.str();
+
+	// every candidate find_separate_debug_file() would check the crc of
+	key << hex << crc32 << dec << ';';
+	vector<string> const tries = debug_link_candidates(filepath, basename);
+	for (size_t i = 0; i < tries.size(); ++i) {
+		image_error img_ok;
+		string const path = extra.find_image_path(tries[i], img_ok, true);
+		if (img_ok == image_ok)
+			add_file_key(key, path);
+	}
+
+	return key.str();
+}
+
+
+string image_build_id(bfd * ibfd)
+{
+	unsigned char buildid[64];
+
+	if (!get_build_id(ibfd, buildid) || build_id_size > sizeof(buildid))
+		return string();
+
+	ostringstream os;
+	os << hex << setfill('0');
+	for (size_t i = 0; i < build_id_size; ++i)
+		os << setw(2) << unsigned(buildid[i]);
+	return os.str();
 }
 
 
@@ -560,6 +629,14 @@ void bfd_info::close()
 		bfd_close(abfd);
 }
 
+
+dwarf_line_table const & bfd_info::get_line_table() const
+{
+	if (!line_table.get())
+		line_table.reset(new dwarf_line_table(abfd));
+	return *line_table;
+}
+
 #if SYNTHESIZE_SYMBOLS
 /**
  * This function is intended solely for processing ppc64 debuginfo files.
@@ -826,6 +903,12 @@ find_nearest_line(bfd_info const & b, op_bfd_symbol const & sym,
 	if (pc >= op_bfd_section_size(abfd, section))
 		goto fail;
 
+	if (b.get_line_table().find(section->vma + pc, info.filename,
+	                            info.line)) {
+		info.found = true;
+		return info;
+	}
+
 	ret = bfd_find_nearest_line(abfd, section, syms, pc, &cfilename,
 	                                 &function, &linenr);
 
@@ -15,6 +15,7 @@
 #include "utility.h"
 #include "op_types.h"
 #include "locate_images.h"
+#include "dwarf_line_table.h"
 
 #include <bfd.h>
 #include <stdint.h>
@@ -49,6 +50,9 @@ struct bfd_info {
 	/// pick out the symbols from the bfd, if we can
 	void get_symbols();
 
+	/// return the line table of the BFD, built on first use
+	dwarf_line_table const & get_line_table() const;
+
 	/// the actual BFD
 	bfd * abfd;
 	/// normal symbols (includes synthesized symbols)
@@ -73,6 +77,9 @@ private:
 	 */
 	asymbol * synth_syms;
 
+	/// decoded .debug_line of abfd
+	mutable scoped_ptr<dwarf_line_table> line_table;
+
 	/**
 	 * Under certain circumstances, correct handling of the bfd for a
 	 * debuginfo file is not possible without access to the bfd for
@@ -126,6 +133,19 @@ find_separate_debug_file(bfd * ibfd,
                          std::string & debug_filename,
                          extra_images const & extra);
 
+/**
+ * Return a string identifying the separate debug files
+ * find_separate_debug_file() would consider for ibfd: their path, mtime
+ * and size, and the crc32 of the .gnu_debuglink section. Unlike
+ * find_separate_debug_file(), no debug file is read, so this is cheap.
+ * The string changes when a debug file is installed, updated or removed.
+ */
+std::string separate_debug_file_key(bfd * ibfd, std::string const & filepath,
+                                    extra_images const & extra);
+
+/// return the build-id of the given BFD as a hex string, empty if none
+std::string image_build_id(bfd * ibfd);
+
 /// open the given BFD
 bfd * open_bfd(std::string const & file);
 
@@ -0,0 +1,820 @@
+/**
+ * @file dwarf_line_table.cpp
+ * Index of the DWARF line number information of a binary
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include "config.h"
+
+#include <bfd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <map>
+
+#include "dwarf_line_table.h"
+#include "cverb.h"
+#include "op_bfd_wrappers.h"
+
+using namespace std;
+
+extern verbose vbfd;
+
+u32 const dwarf_line_table::end_of_sequence;
+u32 const dwarf_line_table::unknown_file;
+
+namespace {
+
+// the few DWARF constants we need, dwarf2.h is not always installed
+enum {
+	DW_LNS_copy = 1,
+	DW_LNS_advance_pc,
+	DW_LNS_advance_line,
+	DW_LNS_set_file,
+	DW_LNS_set_column,
+	DW_LNS_negate_stmt,
+	DW_LNS_set_basic_block,
+	DW_LNS_const_add_pc,
+	DW_LNS_fixed_advance_pc
+};
+
+enum {
+	DW_LNE_end_sequence = 1,
+	DW_LNE_set_address,
+	DW_LNE_define_file
+};
+
+enum {
+	DW_LNCT_path = 1,
+	DW_LNCT_directory_index
+};
+
+enum {
+	DW_AT_stmt_list = 0x10,
+	DW_AT_comp_dir = 0x1b
+};
+
+enum {
+	DW_FORM_addr = 0x01,
+	DW_FORM_block2 = 0x03,
+	DW_FORM_block4,
+	DW_FORM_data2,
+	DW_FORM_data4,
+	DW_FORM_data8,
+	DW_FORM_string,
+	DW_FORM_block,
+	DW_FORM_block1,
+	DW_FORM_data1,
+	DW_FORM_flag,
+	DW_FORM_sdata,
+	DW_FORM_strp,
+	DW_FORM_udata,
+	DW_FORM_ref_addr,
+	DW_FORM_ref1,
+	DW_FORM_ref2,
+	DW_FORM_ref4,
+	DW_FORM_ref8,
+	DW_FORM_ref_udata,
+	DW_FORM_indirect,
+	DW_FORM_sec_offset,
+	DW_FORM_exprloc,
+	DW_FORM_flag_present,
+	DW_FORM_data16 = 0x1e,
+	DW_FORM_line_strp = 0x1f,
+	DW_FORM_ref_sig8 = 0x20
+};
+
+
+/// sequential reader of DWARF data, any read past the end sets error
+class reader {
+public:
+	reader(string const & data, size_t offset, size_t size, bool big)
+		: pos(data.data()), end(data.data()), big_endian(big),
+		  error(offset > data.size() || size > data.size() - offset)
+	{
+		if (!error) {
+			pos += offset;
+			end = pos + size;
+		}
+	}
+
+	bool ok() const { return !error; }
+	bool at_end() const { return pos >= end; }
+	size_t left() const { return end - pos; }
+	char const * where() const { return pos; }
+
+	void skip(u64 size) {
+		if (size > left()) {
+			error = true;
+			pos = end;
+		} else {
+			pos += size;
+		}
+	}
+
+	u64 fixed(size_t size) {
+		if (size > left()) {
+			error = true;
+			pos = end;
+			return 0;
+		}
+		u64 value = 0;
+		for (size_t i = 0; i < size; ++i) {
+			unsigned char byte = pos[big_endian ? i : size - 1 - i];
+			value = (value << 8) | byte;
+		}
+		pos += size;
+		return value;
+	}
+
+	u64 uleb() {
+		u64 value = 0;
+		unsigned int shift = 0;
+		unsigned char byte;
+		do {
+			byte = fixed(1);
+			if (shift < 64)
+				value |= u64(byte & 0x7f) << shift;
+			shift += 7;
+		} while ((byte & 0x80) && !error);
+		return value;
+	}
+
+	long long sleb() {
+		u64 value = 0;
+		unsigned int shift = 0;
+		unsigned char byte;
+		do {
+			byte = fixed(1);
+			if (shift < 64)
+				value |= u64(byte & 0x7f) << shift;
+			shift += 7;
+		} while ((byte & 0x80) && !error);
+		if (shift < 64 && (byte & 0x40))
+			value |= ~u64(0) << shift;
+		return value;
+	}
+
+	/// read a nul terminated string
+	char const * str() {
+		char const * s = pos;
+		char const * nul = static_cast<char const *>(memchr(pos, 0, left()));
+		if (!nul) {
+			error = true;
+			pos = end;
+			return "";
+		}
+		pos = nul + 1;
+		return s;
+	}
+
+	/// read an initial length, setting dwarf64
+	u64 length(bool & dwarf64) {
+		u64 len = fixed(4);
+		dwarf64 = len == 0xffffffff;
+		if (dwarf64)
+			len = fixed(8);
+		return len;
+	}
+
+private:
+	char const * pos;
+	char const * end;
+	bool big_endian;
+	bool error;
+};
+
+
+/// return the nul terminated string at offset of a string section
+char const * string_at(string const & section, u64 offset)
+{
+	if (offset >= section.size())
+		return 0;
+	char const * s = section.data() + offset;
+	if (!memchr(s, 0, section.size() - offset))
+		return 0;
+	return s;
+}
+
+
+bool is_absolute(char const * path)
+{
+	return path[0] == '/';
+}
+
+
+/**
+ * The DW_AT_comp_dir of the compilation units using each line program,
+ * by line program offset. Only DWARF 2 to 4 units are looked at, the
+ * line programs of later units include the compilation directory.
+ */
+typedef map<u64, string> comp_dirs_t;
+
+/// skip an attribute value, return false if the form is unknown
+bool skip_form(reader & r, u64 form, unsigned int version,
+               unsigned int addr_size, bool dwarf64)
+{
+	size_t const offset_size = dwarf64 ? 8 : 4;
+
+	switch (form) {
+	case DW_FORM_addr: r.skip(addr_size); break;
+	case DW_FORM_block2: r.skip(r.fixed(2)); break;
+	case DW_FORM_block4: r.skip(r.fixed(4)); break;
+	case DW_FORM_data2: case DW_FORM_ref2: r.skip(2); break;
+	case DW_FORM_data4: case DW_FORM_ref4: r.skip(4); break;
+	case DW_FORM_data8: case DW_FORM_ref8: case DW_FORM_ref_sig8:
+		r.skip(8); break;
+	case DW_FORM_string: r.str(); break;
+	case DW_FORM_block: case DW_FORM_exprloc: r.skip(r.uleb()); break;
+	case DW_FORM_block1: r.skip(r.fixed(1)); break;
+	case DW_FORM_data1: case DW_FORM_ref1: case DW_FORM_flag:
+		r.skip(1); break;
+	case DW_FORM_sdata: r.sleb(); break;
+	case DW_FORM_udata: case DW_FORM_ref_udata: r.uleb(); break;
+	case DW_FORM_strp: case DW_FORM_sec_offset: r.skip(offset_size); break;
+	case DW_FORM_ref_addr:
+		r.skip(version == 2 ? addr_size : offset_size); break;
+	case DW_FORM_flag_present: break;
+	case DW_FORM_indirect:
+		return skip_form(r, r.uleb(), version, addr_size, dwarf64);
+	default:
+		return false;
+	}
+
+	return r.ok();
+}
+
+
+/**
+ * Read the attributes of the first DIE of a unit, the compilation unit
+ * DIE, to find its line program and compilation directory.
+ */
+void read_unit_die(dwarf_line_table::sections const & s, reader & r,
+                   unsigned int version, u64 abbrev_offset,
+                   unsigned int addr_size, bool dwarf64,
+                   comp_dirs_t & comp_dirs)
+{
+	u64 const code = r.uleb();
+	if (!r.ok() || !code)
+		return;
+
+	reader abbrev(s.debug_abbrev, abbrev_offset,
+	              s.debug_abbrev.size() - min<u64>(abbrev_offset,
+	                                               s.debug_abbrev.size()),
+	              s.big_endian);
+
+	// find the abbreviation of the DIE
+	for (;;) {
+		u64 const abbrev_code = abbrev.uleb();
+		if (!abbrev.ok() || !abbrev_code)
+			return;
+		abbrev.uleb();		// tag
+		abbrev.skip(1);		// children
+		if (abbrev_code == code)
+			break;
+		while (abbrev.ok() && (abbrev.uleb() | abbrev.uleb()))
+			;
+	}
+
+	bool has_stmt_list = false;
+	u64 stmt_list = 0;
+	bool has_comp_dir = false;
+	string comp_dir;
+
+	for (;;) {
+		u64 const name = abbrev.uleb();
+		u64 const form = abbrev.uleb();
+		if (!abbrev.ok() || (!name && !form))
+			break;
+
+		if (name == DW_AT_stmt_list &&
+		    (form == DW_FORM_data4 || form == DW_FORM_data8 ||
+		     form == DW_FORM_sec_offset)) {
+			size_t size = form == DW_FORM_data4 ? 4 : 8;
+			if (form == DW_FORM_sec_offset)
+				size = dwarf64 ? 8 : 4;
+			stmt_list = r.fixed(size);
+			has_stmt_list = true;
+		} else if (name == DW_AT_comp_dir && form == DW_FORM_string) {
+			comp_dir = r.str();
+			has_comp_dir = true;
+		} else if (name == DW_AT_comp_dir && form == DW_FORM_strp) {
+			char const * dir = string_at(s.debug_str,
+			                             r.fixed(dwarf64 ? 8 : 4));
+			if (!dir)
+				return;
+			comp_dir = dir;
+			has_comp_dir = true;
+		} else if (name == DW_AT_comp_dir) {
+			// e.g. a string in a supplementary file, give up
+			return;
+		} else if (!skip_form(r, form, version, addr_size, dwarf64)) {
+			return;
+		}
+
+		if (!r.ok())
+			return;
+	}
+
+	// a unit without DW_AT_comp_dir is recorded with an empty one
+	if (has_stmt_list && (has_comp_dir || comp_dirs.find(stmt_list) == comp_dirs.end()))
+		comp_dirs[stmt_list] = comp_dir;
+}
+
+
+void read_comp_dirs(dwarf_line_table::sections const & s,
+                    comp_dirs_t & comp_dirs)
+{
+	reader units(s.debug_info, 0, s.debug_info.size(), s.big_endian);
+
+	while (!units.at_end() && units.ok()) {
+		bool dwarf64;
+		u64 const length = units.length(dwarf64);
+		if (!units.ok() || length > units.left())
+			return;
+
+		size_t const unit_start = units.where() - s.debug_info.data();
+		reader r(s.debug_info, unit_start, length, s.big_endian);
+		units.skip(length);
+
+		unsigned int const version = r.fixed(2);
+		if (version < 2 || version > 4)
+			continue;
+		u64 const abbrev_offset = r.fixed(dwarf64 ? 8 : 4);
+		unsigned int const addr_size = r.fixed(1);
+		read_unit_die(s, r, version, abbrev_offset, addr_size,
+		              dwarf64, comp_dirs);
+	}
+}
+
+
+/// a file entry of a line program header
+struct file_entry {
+	file_entry() : name(0), dir(0) {}
+	char const * name;
+	u64 dir;
+};
+
+
+/// read a DWARF 5 directory or file name table
+bool read_entry_table(dwarf_line_table::sections const & s, reader & r,
+                      bool dwarf64, vector<file_entry> & entries)
+{
+	unsigned int const nr_formats = r.fixed(1);
+	vector<pair<u64, u64> > formats;
+	for (unsigned int i = 0; i < nr_formats; ++i) {
+		u64 const content = r.uleb();
+		formats.push_back(make_pair(content, r.uleb()));
+	}
+
+	u64 const count = r.uleb();
+	for (u64 i = 0; i < count && r.ok(); ++i) {
+		file_entry entry;
+		for (size_t j = 0; j < formats.size(); ++j) {
+			u64 const content = formats[j].first;
+			u64 const form = formats[j].second;
+			u64 value = 0;
+			char const * str = 0;
+
+			switch (form) {
+			case DW_FORM_string:
+				str = r.str();
+				break;
+			case DW_FORM_line_strp:
+				str = string_at(s.debug_line_str,
+				                r.fixed(dwarf64 ? 8 : 4));
+				break;
+			case DW_FORM_strp:
+				str = string_at(s.debug_str,
+				                r.fixed(dwarf64 ? 8 : 4));
+				break;
+			case DW_FORM_udata:
+				value = r.uleb();
+				break;
+			case DW_FORM_data1:
+				value = r.fixed(1);
+				break;
+			case DW_FORM_data2:
+				value = r.fixed(2);
+				break;
+			case DW_FORM_data4:
+				value = r.fixed(4);
+				break;
+			case DW_FORM_data8:
+				value = r.fixed(8);
+				break;
+			case DW_FORM_data16:
+				r.skip(16);
+				break;
+			case DW_FORM_block:
+				r.skip(r.uleb());
+				break;
+			default:
+				// e.g. DW_FORM_strx, which needs the unit
+				return false;
+			}
+
+			if (content == DW_LNCT_path) {
+				if (!str)
+					return false;
+				entry.name = str;
+			} else if (content == DW_LNCT_directory_index) {
+				entry.dir = value;
+			}
+		}
+		entries.push_back(entry);
+	}
+
+	return r.ok();
+}
+
+
+/**
+ * A line program header, with the file names built the way libbfd
+ * builds them; file_names[i] is the name of file register value i, NULL
+ * if it can't be built.
+ */
+struct line_header {
+	unsigned int version;
+	unsigned int min_inst_length;
+	bool default_is_stmt;
+	int line_base;
+	unsigned int line_range;
+	unsigned int opcode_base;
+	vector<unsigned int> opcode_lengths;
+	vector<char const *> dirs;
+	vector<file_entry> files;
+	bool has_comp_dir;
+	string comp_dir;
+};
+
+
+/// return the full name of a file, empty if it can't be built
+string file_name(line_header const & h, file_entry const & f)
+{
+	if (!f.name)
+		return string();
+	if (is_absolute(f.name))
+		return f.name;
+
+	// see concat_filename() in libbfd dwarf2.c
+	char const * subdir = 0;
+	if (h.version >= 5) {
+		if (f.dir < h.dirs.size())
+			subdir = h.dirs[f.dir];
+	} else if (f.dir && f.dir <= h.dirs.size()) {
+		subdir = h.dirs[f.dir - 1];
+	}
+
+	char const * dir = 0;
+	if (!subdir || !is_absolute(subdir)) {
+		if (!h.has_comp_dir)
+			return string();
+		if (!h.comp_dir.empty())
+			dir = h.comp_dir.c_str();
+	}
+	if (!dir) {
+		dir = subdir;
+		subdir = 0;
+	}
+	if (!dir)
+		return f.name;
+
+	string name = dir;
+	if (subdir)
+		name = name + '/' + subdir;
+	return name + '/' + f.name;
+}
+
+
+}  // anonymous namespace
+
+
+dwarf_line_table::dwarf_line_table(bfd * abfd)
+	: last_row(0)
+{
+	sections s;
+
+	// a relocatable file debug sections must be relocated first
+	if (!abfd || (bfd_get_file_flags(abfd) & HAS_RELOC))
+		return;
+
+	struct {
+		char const * name;
+		string * contents;
+	} const wanted[] = {
+		{ ".debug_line", &s.debug_line },
+		{ ".debug_line_str", &s.debug_line_str },
+		{ ".debug_info", &s.debug_info },
+		{ ".debug_abbrev", &s.debug_abbrev },
+		{ ".debug_str", &s.debug_str },
+	};
+
+	for (size_t i = 0; i < sizeof(wanted) / sizeof(wanted[0]); ++i) {
+		asection * sect = bfd_get_section_by_name(abfd, wanted[i].name);
+		bfd_byte * contents = 0;
+		if (!sect)
+			continue;
+		// this uncompresses compressed debug sections too
+		if (!bfd_malloc_and_get_section(abfd, sect, &contents)) {
+			cverb << vbfd << "can't read " << wanted[i].name
+			      << ", not indexing line numbers" << endl;
+			return;
+		}
+		wanted[i].contents->assign(reinterpret_cast<char *>(contents),
+		                           op_bfd_section_size(abfd, sect));
+		free(contents);
+	}
+
+	for (asection * sect = abfd->sections; sect; sect = sect->next) {
+		if (op_bfd_get_section_flags(abfd, sect) & SEC_CODE) {
+			s.code.push_back(make_pair(u64(sect->vma),
+				u64(op_bfd_section_size(abfd, sect))));
+		}
+	}
+
+	s.big_endian = bfd_big_endian(abfd);
+
+	build(s);
+
+	cverb << vbfd << "line table of " << bfd_get_filename(abfd) << ": "
+	      << dec << rows.size() << " rows, " << files.size()
+	      << " files" << hex << endl;
+}
+
+
+dwarf_line_table::dwarf_line_table(sections const & s)
+	: last_row(0)
+{
+	build(s);
+}
+
+
+void dwarf_line_table::add_row(vector<row> & sequence, u64 address,
+                               vector<u32> const & ids, u64 file,
+                               long long line, bool end)
+{
+	row r;
+	r.address = address;
+	r.file = end ? end_of_sequence
+		: file < ids.size() ? ids[file] : unknown_file;
+	r.line = end || line < 0 ? 0 : u32(line);
+
+	// the last row wins for rows at the same address, like libbfd does
+	if (!sequence.empty() && sequence.back().address == address &&
+	    sequence.back().file != end_of_sequence)
+		sequence.back() = r;
+	else
+		sequence.push_back(r);
+}
+
+
+void dwarf_line_table::build(sections const & s)
+{
+	comp_dirs_t comp_dirs;
+	read_comp_dirs(s, comp_dirs);
+
+	// each sequence, by start address
+	typedef multimap<u64, vector<row> > sequences_t;
+	sequences_t sequences;
+	map<string, u32> file_ids;
+
+	reader programs(s.debug_line, 0, s.debug_line.size(), s.big_endian);
+	while (!programs.at_end() && programs.ok()) {
+		size_t const offset = programs.where() - s.debug_line.data();
+		bool dwarf64;
+		u64 const length = programs.length(dwarf64);
+		if (!programs.ok() || length > programs.left())
+			break;
+
+		size_t const start = programs.where() - s.debug_line.data();
+		reader r(s.debug_line, start, length, s.big_endian);
+		programs.skip(length);
+
+		line_header h;
+		h.version = r.fixed(2);
+		if (h.version < 2 || h.version > 5)
+			continue;
+		unsigned int addr_size = 0;
+		if (h.version >= 5) {
+			addr_size = r.fixed(1);
+			r.skip(1);	// segment selector size
+		}
+		u64 const header_length = r.fixed(dwarf64 ? 8 : 4);
+		if (!r.ok() || header_length > r.left())
+			continue;
+		size_t const program_start =
+			r.where() - s.debug_line.data() + header_length;
+		h.min_inst_length = r.fixed(1);
+		if (h.version >= 4 && r.fixed(1) != 1) {
+			// VLIW, op_index is not handled
+			continue;
+		}
+		h.default_is_stmt = r.fixed(1);
+		h.line_base = static_cast<signed char>(r.fixed(1));
+		h.line_range = r.fixed(1);
+		h.opcode_base = r.fixed(1);
+		if (!r.ok() || !h.line_range || !h.opcode_base)
+			continue;
+		for (unsigned int i = 1; i < h.opcode_base; ++i)
+			h.opcode_lengths.push_back(r.fixed(1));
+
+		if (h.version >= 5) {
+			vector<file_entry> dirs;
+			if (!read_entry_table(s, r, dwarf64, dirs) ||
+			    !read_entry_table(s, r, dwarf64, h.files))
+				continue;
+			for (size_t i = 0; i < dirs.size(); ++i)
+				h.dirs.push_back(dirs[i].name);
+			// directory 0 is the compilation directory
+			h.has_comp_dir = !h.dirs.empty();
+			if (h.has_comp_dir)
+				h.comp_dir = h.dirs[0];
+		} else {
+			for (;;) {
+				char const * dir = r.str();
+				if (!r.ok() || !*dir)
+					break;
+				h.dirs.push_back(dir);
+			}
+			// file register values start at 1
+			h.files.push_back(file_entry());
+			for (;;) {
+				file_entry entry;
+				entry.name = r.str();
+				if (!r.ok() || !*entry.name)
+					break;
+				entry.dir = r.uleb();
+				r.uleb();	// mtime
+				r.uleb();	// length
+				h.files.push_back(entry);
+			}
+			comp_dirs_t::const_iterator it = comp_dirs.find(offset);
+			h.has_comp_dir = it != comp_dirs.end();
+			if (h.has_comp_dir)
+				h.comp_dir = it->second;
+		}
+		if (!r.ok())
+			continue;
+
+		vector<u32> ids;
+		for (size_t i = 0; i < h.files.size(); ++i) {
+			string const name = file_name(h, h.files[i]);
+			if (name.empty()) {
+				ids.push_back(unknown_file);
+				continue;
+			}
+			map<string, u32>::iterator it = file_ids.find(name);
+			if (it == file_ids.end()) {
+				it = file_ids.insert(make_pair(name, u32(files.size()))).first;
+				files.push_back(name);
+			}
+			ids.push_back(it->second);
+		}
+
+		reader program(s.debug_line, program_start,
+		               start + length - program_start, s.big_endian);
+
+		vector<row> sequence;
+		u64 address = 0;
+		u64 file = 1;
+		long long line = 1;
+
+		while (!program.at_end() && program.ok()) {
+			unsigned int const opcode = program.fixed(1);
+
+			if (opcode >= h.opcode_base) {
+				unsigned int const adjusted = opcode - h.opcode_base;
+				address += (adjusted / h.line_range) * h.min_inst_length;
+				line += h.line_base + int(adjusted % h.line_range);
+				add_row(sequence, address, ids, file, line, false);
+				continue;
+			}
+
+			switch (opcode) {
+			case 0: {
+				u64 const size = program.uleb();
+				if (!size || size > program.left()) {
+					program.skip(program.left() + 1);
+					break;
+				}
+				size_t const next = program.where() - s.debug_line.data() + size;
+				unsigned int const sub = program.fixed(1);
+				if (sub == DW_LNE_end_sequence) {
+					add_row(sequence, address, ids, file, line, true);
+					if (sequence.size() > 1) {
+						u64 const first = sequence[0].address;
+						sequences.insert(make_pair(first, vector<row>()))->second.swap(sequence);
+					}
+					sequence.clear();
+					address = 0;
+					file = 1;
+					line = 1;
+				} else if (sub == DW_LNE_set_address) {
+					// the header of DWARF 2 to 4 programs
+					// doesn't give the address size
+					u64 const operand_size = size - 1;
+					if (operand_size > 8 ||
+					    (addr_size && operand_size != addr_size)) {
+						program.skip(program.left() + 1);
+						break;
+					}
+					address = program.fixed(operand_size);
+				} else if (sub == DW_LNE_define_file) {
+					// rare, not worth handling
+					ids.push_back(unknown_file);
+				}
+				program.skip(next - (program.where() - s.debug_line.data()));
+				break;
+			}
+			case DW_LNS_copy:
+				add_row(sequence, address, ids, file, line, false);
+				break;
+			case DW_LNS_advance_pc:
+				address += program.uleb() * h.min_inst_length;
+				break;
+			case DW_LNS_advance_line:
+				line += program.sleb();
+				break;
+			case DW_LNS_set_file:
+				file = program.uleb();
+				break;
+			case DW_LNS_const_add_pc:
+				address += ((255 - h.opcode_base) / h.line_range)
+					* h.min_inst_length;
+				break;
+			case DW_LNS_fixed_advance_pc:
+				address += program.fixed(2);
+				break;
+			default:
+				// opcodes changing nothing we track, with their
+				// operands given by the header
+				for (unsigned int i = 0; i < h.opcode_lengths[opcode - 1]; ++i)
+					program.uleb();
+				break;
+			}
+		}
+	}
+
+	// keep the sequences starting in a code section: the ones of code
+	// discarded by the linker are left at address zero and overlap others
+	sequences_t::iterator it = sequences.begin();
+	for (; it != sequences.end(); ++it) {
+		u64 const first = it->first;
+		bool in_code = false;
+		for (size_t i = 0; i < s.code.size() && !in_code; ++i) {
+			in_code = first >= s.code[i].first &&
+				first - s.code[i].first < s.code[i].second;
+		}
+		if (!in_code)
+			continue;
+		vector<row> const & sequence = it->second;
+		// a sequence overlapping the previous one is an oddity we
+		// let libbfd deal with
+		if (!rows.empty() && rows.back().address > first)
+			continue;
+		rows.insert(rows.end(), sequence.begin(), sequence.end());
+	}
+}
+
+
+bool dwarf_line_table::find(u64 address, string & filename,
+                            unsigned int & line) const
+{
+	if (rows.empty() || address < rows[0].address)
+		return false;
+
+	// lookups are mostly done in address order: look a few rows after
+	// the last one found before searching the whole table
+	size_t i = last_row;
+	vector<row>::const_iterator first = rows.begin();
+	if (i < rows.size() && rows[i].address <= address) {
+		size_t const limit = min(i + 16, rows.size() - 1);
+		while (i < limit && rows[i + 1].address <= address)
+			++i;
+		if (i < limit || i == rows.size() - 1)
+			first = rows.end();
+		else
+			first += i;
+	}
+	if (first != rows.end()) {
+		// the last row at or before address, address + 1 would wrap
+		if (address == ~u64(0))
+			i = rows.size() - 1;
+		else
+			i = lower_bound(first, rows.end(), address + 1) - rows.begin() - 1;
+	}
+	last_row = i;
+
+	row const & r = rows[i];
+	if (r.file == end_of_sequence || r.file == unknown_file || !r.line)
+		return false;
+
+	filename = files[r.file];
+	line = r.line;
+	return true;
+}
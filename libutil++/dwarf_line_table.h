@@ -0,0 +1,100 @@
+/**
+ * @file dwarf_line_table.h
+ * Index of the DWARF line number information of a binary
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#ifndef DWARF_LINE_TABLE_H
+#define DWARF_LINE_TABLE_H
+
+#include <string>
+#include <vector>
+#include <utility>
+
+#include "op_types.h"
+
+struct bfd;
+
+/**
+ * The rows of all the .debug_line programs of a binary, decoded once and
+ * sorted by address, so that finding the source line of an address is a
+ * search in an array instead of a libbfd lookup.
+ *
+ * Lookups with increasing addresses, like those for the sorted samples of
+ * a profile, walk forward from the row found by the previous lookup.
+ *
+ * Relocatable files are not indexed at all, and addresses whose file name
+ * can't be built or whose line is zero are reported as not found, so the
+ * caller can ask libbfd.
+ */
+class dwarf_line_table {
+public:
+	/// the contents of the sections needed to build the table
+	struct sections {
+		sections() : big_endian(false) {}
+
+		std::string debug_line;
+		std::string debug_line_str;
+		std::string debug_info;
+		std::string debug_abbrev;
+		std::string debug_str;
+		/// vma and size of the code sections, rows outside are ignored
+		std::vector<std::pair<u64, u64> > code;
+		bool big_endian;
+	};
+
+	/// build the table from the debug sections of abfd
+	explicit dwarf_line_table(bfd * abfd);
+
+	/// build the table from raw section contents
+	explicit dwarf_line_table(sections const & s);
+
+	/// return true if nothing was indexed
+	bool empty() const { return rows.empty(); }
+
+	/**
+	 * @param address  the address to look up
+	 * @param filename  set to the source file name
+	 * @param line  set to the line number
+	 *
+	 * Return false if the address is not covered by the table or can't
+	 * be resolved by it.
+	 */
+	bool find(u64 address, std::string & filename,
+	          unsigned int & line) const;
+
+private:
+	struct row {
+		u64 address;
+		/// index in files, or one of the special values below
+		u32 file;
+		u32 line;
+
+		bool operator<(u64 addr) const { return address < addr; }
+	};
+
+	/// file of the row ending a sequence
+	static u32 const end_of_sequence = ~0U;
+	/// file of a row whose file name can't be built
+	static u32 const unknown_file = ~0U - 1;
+
+	void build(sections const & s);
+
+	/**
+	 * Append the row of the line program registers to sequence, ids
+	 * maps the file register values to indexes in files. end is true
+	 * for the row of a DW_LNE_end_sequence.
+	 */
+	static void add_row(std::vector<row> & sequence, u64 address,
+	                    std::vector<u32> const & ids, u64 file,
+	                    long long line, bool end);
+
+	std::vector<row> rows;
+	std::vector<std::string> files;
+	/// row found by the last lookup
+	mutable size_t last_row;
+};
+
+#endif /* !DWARF_LINE_TABLE_H */
@@ -15,13 +15,16 @@
 
 #include <fcntl.h>
 #include <cstring>
+#include <cerrno>
 
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
 #include <cstdlib>
 
 #include <algorithm>
+#include <map>
 #include <iostream>
 #include <iomanip>
 #include <sstream>
@@ -29,9 +32,11 @@
 #include <fstream>
 
 #include "op_bfd.h"
+#include "op_exception.h"
 #include "locate_images.h"
 #include "string_filter.h"
 #include "stream_util.h"
+#include "file_manip.h"
 #include "cverb.h"
 
 using namespace std;
@@ -39,6 +44,8 @@ using namespace std;
 
 verbose vbfd("bfd");
 
+bool op_bfd_symbol_cache;
+
 
 namespace {
 
@@ -55,15 +62,88 @@ struct remove_filter {
 };
 
 
+/**
+ * The symbol cache holds, for one image, the symbols selected by
+ * op_bfd::get_symbols() before any filtering by name, which include the
+ * symbols of the separate debug file. An entry is valid as long as the
+ * image path, mtime, size and build-id and the separate_debug_file_key()
+ * of the image are the same. There is one file per image path, so the
+ * entry of a rebuilt image replaces the old one. Layout is a
+ * symbol_cache_header, nr_syms symbol_cache_entry then a table of nul
+ * terminated strings, so it can be used in place from a mmap().
+ */
+char const symbol_cache_magic[8] = "OPSYMC";
+/// bump this when the layout or the symbol selection changes
+u32 const symbol_cache_version = 2;
+
+struct symbol_cache_header {
+	char magic[8];
+	u32 version;
+	u32 nr_syms;
+	u64 mtime;
+	u64 size;
+	u64 vma_adj;
+	/// image path, build-id and debug file key, offsets in the string table
+	u32 path;
+	u32 build_id;
+	u32 debug_key;
+	u32 strings_size;
+};
+
+struct symbol_cache_entry {
+	u64 value;
+	u64 section_filepos;
+	u64 section_vma;
+	u64 size;
+	/// offset of the name in the string table
+	u32 name;
+	u32 index;
+	u8 debug_file;
+	u8 hidden;
+	u8 weak;
+	u8 padding[5];
+};
+
+
+/// return the offset of str appended to the string table strings
+u32 add_string(string & strings, string const & str)
+{
+	u32 offset = strings.size();
+	strings.append(str.c_str(), str.size() + 1);
+	return offset;
+}
+
+
+/// return the symbol cache file for this image, empty if none can be used
+string symbol_cache_filename(string const & image_path)
+{
+	if (!op_bfd_symbol_cache || !*op_session_dir)
+		return string();
+
+	// FNV-1a, only needed to spread the files, the header is checked
+	u64 hash = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < image_path.size(); ++i) {
+		hash ^= (unsigned char)image_path[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	ostringstream os;
+	os << op_session_dir << "/symbols/" << hex << setfill('0')
+	   << setw(16) << hash;
+	return os.str();
+}
+
+
 } // namespace anon
 
 
-op_bfd_symbol::op_bfd_symbol(asymbol const * a)
+op_bfd_symbol::op_bfd_symbol(asymbol const * a, size_t index, bool debug_file)
 	: bfd_symbol(a), symb_value(a->value),
 	  section_filepos(a->section->filepos),
 	  section_vma(a->section->vma),
 	  symb_size(0), symb_hidden(false), symb_weak(false),
-	  symb_artificial(false)
+	  symb_artificial(false), symb_index(index),
+	  symb_debug_file(debug_file)
 {
 	// Some sections have unnamed symbols in them. If
 	// we just ignore them then we end up sticking
@@ -84,7 +164,21 @@ op_bfd_symbol::op_bfd_symbol(bfd_vma vma, size_t size, string const & name)
 	: bfd_symbol(0), symb_value(vma),
 	  section_filepos(0), section_vma(0),
 	  symb_size(size), symb_name(name),
-	  symb_hidden(false), symb_weak(false), symb_artificial(true)
+	  symb_hidden(false), symb_weak(false), symb_artificial(true),
+	  symb_index(0), symb_debug_file(false)
+{
+}
+
+
+op_bfd_symbol::op_bfd_symbol(unsigned long value,
+	unsigned long section_filepos_, bfd_vma section_vma_, size_t size,
+	string const & name, bool hidden, bool weak, size_t index,
+	bool debug_file)
+	: bfd_symbol(0), symb_value(value),
+	  section_filepos(section_filepos_), section_vma(section_vma_),
+	  symb_size(size), symb_name(name),
+	  symb_hidden(hidden), symb_weak(weak), symb_artificial(false),
+	  symb_index(index), symb_debug_file(debug_file)
 {
 }
 
@@ -107,6 +201,8 @@ op_bfd::op_bfd(string const & fname, string_filter const & symbol_filter,
 	archive_path(extra_images.get_archive_path()),
 	extra_found_images(extra_images),
 	file_size(-1),
+	file_mtime(0),
+	symbols_resolved(true),
 	anon_obj(false),
 	vma_adj(0)
 {
@@ -145,6 +241,7 @@ op_bfd::op_bfd(string const & fname, string_filter const & symbol_filter,
 	}
 
 	file_size = st.st_size;
+	file_mtime = st.st_mtime;
 
 	ibfd.abfd = fdopen_bfd(image_path, fd);
 	if (!ibfd.valid()) {
@@ -176,7 +273,19 @@ op_bfd::op_bfd(string const & fname, string_filter const & symbol_filter,
 		}
 	}
 
-	get_symbols(symbols);
+	try {
+		build_id = image_build_id(ibfd.abfd);
+		debug_key = separate_debug_file_key(ibfd.abfd, filename,
+		                                    extra_found_images);
+		symbol_cache_file = symbol_cache_filename(image_path);
+	} catch (op_fatal_error const &) {
+		// not worth failing for, we just don't cache this image
+	}
+
+	if (!load_symbol_cache(image_path, symbols)) {
+		get_symbols(symbols);
+		save_symbol_cache(image_path, symbols);
+	}
 
 out:
 	add_symbols(symbols, symbol_filter);
@@ -240,7 +349,7 @@ void op_bfd::get_symbols(op_bfd::symbols_found_t & symbols)
 		if (find(filtered_section.begin(), filtered_section.end(),
 			 ibfd.syms[i]->section) != filtered_section.end())
 			continue;
-		symbols.push_back(op_bfd_symbol(ibfd.syms[i]));
+		symbols.push_back(op_bfd_symbol(ibfd.syms[i], i, false));
 	}
 
 	for (i = 0; i < dbfd.nr_syms; ++i) {
@@ -254,7 +363,7 @@ void op_bfd::get_symbols(op_bfd::symbols_found_t & symbols)
 		u32 filepos = filepos_map[dbfd.syms[i]->section->name];
 		if (filepos != 0)
 			dbfd.syms[i]->section->filepos = filepos;
-		symbols.push_back(op_bfd_symbol(dbfd.syms[i]));
+		symbols.push_back(op_bfd_symbol(dbfd.syms[i], i, true));
 	}
 
 	symbols.sort();
@@ -291,6 +400,206 @@ void op_bfd::get_symbols(op_bfd::symbols_found_t & symbols)
 	}
 }
 
+
+bool op_bfd::load_symbol_cache(string const & image_path,
+                               symbols_found_t & symbols)
+{
+	if (symbol_cache_file.empty())
+		return false;
+
+	int cache_fd = open(symbol_cache_file.c_str(), O_RDONLY);
+	if (cache_fd == -1)
+		return false;
+
+	struct stat st;
+	void * map = MAP_FAILED;
+	if (!fstat(cache_fd, &st) && size_t(st.st_size) >= sizeof(symbol_cache_header))
+		map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, cache_fd, 0);
+	close(cache_fd);
+	if (map == MAP_FAILED)
+		return false;
+
+	char const * base = static_cast<char const *>(map);
+	symbol_cache_header const * header =
+		reinterpret_cast<symbol_cache_header const *>(base);
+	symbol_cache_entry const * entries =
+		reinterpret_cast<symbol_cache_entry const *>(header + 1);
+	char const * strings =
+		reinterpret_cast<char const *>(entries + header->nr_syms);
+
+	bool valid = !memcmp(header->magic, symbol_cache_magic,
+	                     sizeof(header->magic)) &&
+		header->version == symbol_cache_version &&
+		header->mtime == u64(file_mtime) &&
+		header->size == u64(file_size) &&
+		header->strings_size &&
+		size_t(st.st_size) == sizeof(*header) +
+			header->nr_syms * sizeof(*entries) + header->strings_size &&
+		!strings[header->strings_size - 1] &&
+		header->path < header->strings_size &&
+		header->build_id < header->strings_size &&
+		header->debug_key < header->strings_size &&
+		image_path == strings + header->path &&
+		build_id == strings + header->build_id &&
+		debug_key == strings + header->debug_key;
+
+	for (u32 i = 0; valid && i < header->nr_syms; ++i) {
+		symbol_cache_entry const & entry = entries[i];
+		if (entry.name >= header->strings_size) {
+			valid = false;
+			break;
+		}
+		symbols.push_back(op_bfd_symbol(entry.value,
+			entry.section_filepos, entry.section_vma, entry.size,
+			strings + entry.name, entry.hidden, entry.weak,
+			entry.index, entry.debug_file));
+	}
+
+	if (valid) {
+		vma_adj = header->vma_adj;
+		symbols_resolved = false;
+		cverb << vbfd << "loaded " << dec << header->nr_syms
+		      << " symbols from " << symbol_cache_file << hex << endl;
+	} else {
+		symbols.clear();
+	}
+
+	munmap(map, st.st_size);
+	return valid;
+}
+
+
+void op_bfd::save_symbol_cache(string const & image_path,
+                               symbols_found_t const & symbols) const
+{
+	if (symbol_cache_file.empty())
+		return;
+
+	string const dir = op_dirname(symbol_cache_file);
+	if (create_dir(dir.c_str())) {
+		cverb << vbfd << "can't create symbol cache " << dir << endl;
+		return;
+	}
+
+	symbol_cache_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, symbol_cache_magic, sizeof(header.magic));
+	header.version = symbol_cache_version;
+	header.nr_syms = symbols.size();
+	header.mtime = file_mtime;
+	header.size = file_size;
+	header.vma_adj = vma_adj;
+
+	string strings;
+	header.path = add_string(strings, image_path);
+	header.build_id = add_string(strings, build_id);
+	header.debug_key = add_string(strings, debug_key);
+
+	vector<symbol_cache_entry> entries(symbols.size());
+	symbols_found_t::const_iterator it = symbols.begin();
+	for (size_t i = 0; it != symbols.end(); ++it, ++i) {
+		symbol_cache_entry & entry = entries[i];
+		memset(&entry, 0, sizeof(entry));
+		entry.value = it->value();
+		entry.section_filepos = it->filepos() - it->value();
+		entry.section_vma = it->vma() - it->value();
+		entry.size = it->size();
+		entry.name = add_string(strings, it->name());
+		entry.index = it->symtab_index();
+		entry.debug_file = it->from_debug_file();
+		entry.hidden = it->hidden();
+		entry.weak = it->weak();
+	}
+	header.strings_size = strings.size();
+
+	// write a temporary file then rename it so a concurrent reader
+	// never sees a partial file
+	ostringstream tmp;
+	tmp << symbol_cache_file << "." << getpid();
+	ofstream out(tmp.str().c_str(), ios::out | ios::binary);
+	out.write(reinterpret_cast<char const *>(&header), sizeof(header));
+	if (!entries.empty())
+		out.write(reinterpret_cast<char const *>(&entries[0]),
+		          entries.size() * sizeof(entries[0]));
+	out.write(strings.data(), strings.size());
+	out.close();
+
+	if (!out || rename(tmp.str().c_str(), symbol_cache_file.c_str())) {
+		cverb << vbfd << "can't write symbol cache "
+		      << symbol_cache_file << endl;
+		unlink(tmp.str().c_str());
+	}
+}
+
+
+void op_bfd::resolve_symbols() const
+{
+	if (symbols_resolved)
+		return;
+	symbols_resolved = true;
+
+	bfd_info & image_bfd = const_cast<bfd_info &>(ibfd);
+	image_bfd.get_symbols();
+	has_debug_info();
+	dbfd.set_image_bfd_info(&image_bfd);
+	dbfd.get_symbols();
+
+	// same debug file symbols fix up as get_symbols()
+	for (size_t i = 0; i < dbfd.nr_syms; ++i) {
+		if (!interesting_symbol(dbfd.syms[i]))
+			continue;
+		filepos_map_t::const_iterator pos =
+			filepos_map.find(dbfd.syms[i]->section->name);
+		if (pos != filepos_map.end() && pos->second != 0)
+			dbfd.syms[i]->section->filepos = pos->second;
+	}
+
+	// syms is logically const, we only fill in what the cache can't hold
+	vector<op_bfd_symbol> & symbols = const_cast<vector<op_bfd_symbol> &>(syms);
+	size_t i;
+	for (i = 0; i < symbols.size(); ++i) {
+		op_bfd_symbol & sym = symbols[i];
+		if (sym.artificial())
+			continue;
+
+		bfd_info const & b = sym.from_debug_file() ? dbfd : ibfd;
+		asymbol const * a = sym.symtab_index() < b.nr_syms
+			? b.syms[sym.symtab_index()] : 0;
+		if (!a || bfd_vma(a->value) != sym.value() ||
+		    a->section->vma != sym.vma() - sym.value())
+			break;
+		sym.symbol(a);
+	}
+
+	if (i == symbols.size())
+		return;
+
+	// The image or its debug file changed without changing the cache key.
+	// Callers already hold indexes in syms, so rather than replacing it,
+	// look the symbols up by vma and name in a fresh get_symbols().
+	cverb << vbfd << "stale symbol cache " << symbol_cache_file << endl;
+	unlink(symbol_cache_file.c_str());
+
+	typedef map<pair<bfd_vma, string>, asymbol const *> found_map_t;
+	found_map_t found;
+	symbols_found_t fresh;
+	const_cast<op_bfd *>(this)->get_symbols(fresh);
+	symbols_found_t::const_iterator it;
+	for (it = fresh.begin(); it != fresh.end(); ++it)
+		found[make_pair(it->vma(), it->name())] = it->symbol();
+
+	// a symbol no longer in the image has no bfd symbol, as an
+	// artificial one, so it gets no line number nor contents
+	for (i = 0; i < symbols.size(); ++i) {
+		op_bfd_symbol & sym = symbols[i];
+		if (sym.artificial())
+			continue;
+		found_map_t::const_iterator pos =
+			found.find(make_pair(sym.vma(), sym.name()));
+		sym.symbol(pos != found.end() ? pos->second : 0);
+	}
+}
+
 #define KERN_ADDR_SPACE_START_SYMBOL  "_text"
 #define KERN_ADDR_SPACE_END_SYMBOL    "_etext"
 
@@ -374,6 +683,8 @@ op_bfd::op_bfd(string const & fname, extra_images const & extra_images)
 	archive_path(""),
 	extra_found_images(extra_images),
 	file_size(-1),
+	file_mtime(0),
+	symbols_resolved(true),
 	anon_obj(false),
 	vma_adj(0)
 
@@ -440,7 +751,7 @@ bfd_vma op_bfd::offset_to_pc(bfd_vma offset) const
 }
 
 bool op_bfd::
-symbol_has_contents(symbol_index_t sym_idx)
+symbol_has_contents(symbol_index_t sym_idx) const
 {
 	op_bfd_symbol const & bfd_sym = syms[sym_idx];
 	string const name = bfd_sym.name();
@@ -453,7 +764,11 @@ symbol_has_contents(symbol_index_t sym_idx)
 bool op_bfd::
 get_symbol_contents(symbol_index_t sym_index, unsigned char * contents) const
 {
+	resolve_symbols();
+
 	op_bfd_symbol const & bfd_sym = syms[sym_index];
+	if (!bfd_sym.symbol())
+		return false;
 	size_t size = bfd_sym.size();
 
 	if (!bfd_get_section_contents(ibfd.abfd, bfd_sym.symbol()->section, 
@@ -498,6 +813,8 @@ bool op_bfd::get_linenr(symbol_index_t sym_idx, bfd_vma offset,
 	if (!has_debug_info())
 		return false;
 
+	resolve_symbols();
+
 	bfd_info const & b = dbfd.valid() ? dbfd : ibfd;
 	op_bfd_symbol const & sym = syms[sym_idx];
 
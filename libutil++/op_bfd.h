@@ -41,12 +41,26 @@ typedef size_t symbol_index_t;
 class op_bfd_symbol {
 public:
 
-	/// ctor for real symbols
-	op_bfd_symbol(asymbol const * a);
+	/**
+	 * ctor for real symbols
+	 * @param a  the bfd symbol
+	 * @param index  index of a in the bfd_info::syms it comes from
+	 * @param debug_file  true if a comes from the separate debug file
+	 */
+	op_bfd_symbol(asymbol const * a, size_t index = 0,
+	              bool debug_file = false);
 
 	/// ctor for artificial symbols
 	op_bfd_symbol(bfd_vma vma, size_t size, std::string const & name);
 
+	/**
+	 * ctor for real symbols loaded from the symbol cache, the bfd symbol
+	 * is set later through symbol(asymbol const *) if it is needed
+	 */
+	op_bfd_symbol(unsigned long value, unsigned long section_filepos,
+	              bfd_vma section_vma, size_t size, std::string const & name,
+	              bool hidden, bool weak, size_t index, bool debug_file);
+
 	bfd_vma vma() const { return symb_value + section_vma; }
 	unsigned long value() const { return symb_value; }
 	unsigned long filepos() const { return symb_value + section_filepos; }
@@ -54,6 +68,9 @@ public:
 	asection const * section(void) const { return bfd_symbol->section; }
 	std::string const & name() const { return symb_name; }
 	asymbol const * symbol() const { return bfd_symbol; }
+	void symbol(asymbol const * a) { bfd_symbol = a; }
+	size_t symtab_index() const { return symb_index; }
+	bool from_debug_file() const { return symb_debug_file; }
 	size_t size() const { return symb_size; }
 	void size(size_t s) { symb_size = s; }
 	bool hidden() const { return symb_hidden; }
@@ -84,10 +101,21 @@ private:
 	bool symb_weak;
 	/// symbol is artificially created
 	bool symb_artificial;
+	/// index of the bfd symbol in its bfd_info::syms
+	size_t symb_index;
+	/// the bfd symbol comes from the separate debug file
+	bool symb_debug_file;
 	/// code bytes corresponding to symbol -- used for XML generation
 	std::string symb_bytes;
 };
 
+/**
+ * If true, op_bfd keeps the symbols it finds in an image under
+ * <session-dir>/symbols and reuses them for the same image. Set by the
+ * --symbol-cache option of the pp tools, false by default.
+ */
+extern bool op_bfd_symbol_cache;
+
 /**
  * Encapsulation of a bfd object. Simplifies open/close of bfd, enumerating
  * symbols and retrieving informations for symbols or vma.
@@ -200,7 +228,7 @@ public:
 	 *        get_symbol_contents to avoid unnecessarily allocating
 	 *        memory for the symbol contents.
 	 */
-	bool symbol_has_contents(symbol_index_t sym_idx);
+	bool symbol_has_contents(symbol_index_t sym_idx) const;
 
 	bool get_symbol_contents(symbol_index_t sym_index,
 		unsigned char * contents) const;
@@ -253,6 +281,25 @@ private:
 	/// create an artificial symbol for a symbolless binary
 	op_bfd_symbol const create_artificial_symbol();
 
+	/**
+	 * Load the symbols found by a previous get_symbols() on the same
+	 * image from the symbol cache. Return false if there is no cache
+	 * entry for this image or if it is stale.
+	 */
+	bool load_symbol_cache(std::string const & image_path,
+	                       symbols_found_t & symbols);
+
+	/// store the symbols found by get_symbols() in the symbol cache
+	void save_symbol_cache(std::string const & image_path,
+	                       symbols_found_t const & symbols) const;
+
+	/**
+	 * Symbols loaded from the symbol cache have no bfd symbol, read
+	 * the bfd symbol tables and set them. Done on first use by the
+	 * functions needing a bfd symbol.
+	 */
+	void resolve_symbols() const;
+
         /* Generate symbols using bfd functions for
 	 * the image file associated with the ibfd arg.
 	 */
@@ -270,6 +317,21 @@ private:
 	/// file size in bytes
 	off_t file_size;
 
+	/// last modification time of the image
+	time_t file_mtime;
+
+	/// build-id of the image, empty if none
+	std::string build_id;
+
+	/// separate_debug_file_key() of the image
+	std::string debug_key;
+
+	/// symbol cache file for this image, empty if not cached
+	std::string symbol_cache_file;
+
+	/// false if syms were loaded from the cache and are not resolved
+	mutable bool symbols_resolved;
+
 	/// corresponding debug file name
 	mutable std::string debug_filename;
 
@@ -12,22 +12,68 @@
 #ifndef SPARSE_ARRAY_H
 #define SPARSE_ARRAY_H
 
-template <typename I, typename T> class sparse_array {
+#include <map>
+#include <cstddef>
+
+/**
+ * The first N elements are stored in the object itself, the others in a
+ * std::map allocated when one of them is first created. Most arrays only
+ * use the first profile classes, so they never allocate.
+ */
+template <typename I, typename T, std::size_t N = 2> class sparse_array {
 public:
 	typedef std::map<I, T> container_type;
 	typedef typename container_type::size_type size_type;
 
+	sparse_array() : nr_dense(0), container(0) {
+		for (size_type i = 0; i < N; ++i)
+			dense[i] = T();
+	}
+
+	sparse_array(sparse_array const & rhs)
+		: nr_dense(rhs.nr_dense), container(0) {
+		for (size_type i = 0; i < N; ++i)
+			dense[i] = rhs.dense[i];
+		if (rhs.container)
+			container = new container_type(*rhs.container);
+	}
+
+	~sparse_array() {
+		delete container;
+	}
+
+	sparse_array & operator=(sparse_array const & rhs) {
+		if (this == &rhs)
+			return *this;
+		for (size_type i = 0; i < N; ++i)
+			dense[i] = rhs.dense[i];
+		nr_dense = rhs.nr_dense;
+		if (!rhs.container) {
+			delete container;
+			container = 0;
+		} else if (container) {
+			*container = *rhs.container;
+		} else {
+			container = new container_type(*rhs.container);
+		}
+		return *this;
+	}
+
 	/**
 	 * Index into the map for a value.
 	 * NOTE: since std::map does/can not have a const member function for
-	 * operator[], this const member function simply returns 0 for 
+	 * operator[], this const member function simply returns 0 for
 	 * profile classes that aren't represented in the map.
 	 * This member function will only be invoked for queries of the
 	 * sparse array.
 	 */
 	T operator[](size_type index) const {
-		typename container_type::const_iterator it = container.find(index);
-		if (it != container.end())
+		if (index < N)
+			return dense[index];
+		if (!container)
+			return 0;
+		typename container_type::const_iterator it = container->find(index);
+		if (it != container->end())
 			return it->second;
 		else
 			return 0;
@@ -39,7 +85,14 @@ public:
 	 * the current max index, a new array entry is created.
 	 */
 	T & operator[](size_type index) {
-		return container[index];
+		if (index < N) {
+			if (index >= nr_dense)
+				nr_dense = index + 1;
+			return dense[index];
+		}
+		if (!container)
+			container = new container_type;
+		return (*container)[index];
 	}
 
 
@@ -47,10 +100,18 @@ public:
 	 * vectorized += operator
 	 */
 	sparse_array & operator+=(sparse_array const & rhs) {
-		typename container_type::const_iterator it = rhs.container.begin();
-		typename container_type::const_iterator it_end = rhs.container.end();
+		for (size_type i = 0; i < rhs.nr_dense; ++i)
+			dense[i] += rhs.dense[i];
+		if (rhs.nr_dense > nr_dense)
+			nr_dense = rhs.nr_dense;
+
+		if (!rhs.container)
+			return *this;
+
+		typename container_type::const_iterator it = rhs.container->begin();
+		typename container_type::const_iterator it_end = rhs.container->end();
 		for ( ; it != it_end; it++)
-			container[it->first] += it->second;
+			(*this)[it->first] += it->second;
 
 		return *this;
 	}
@@ -61,10 +122,18 @@ public:
 	 * (iow: for each components lhs[i] >= rhs[i]
 	 */
 	sparse_array & operator-=(sparse_array const & rhs) {
-		typename container_type::const_iterator it = rhs.container.begin();
-		typename container_type::const_iterator it_end = rhs.container.end();
+		for (size_type i = 0; i < rhs.nr_dense; ++i)
+			dense[i] -= rhs.dense[i];
+		if (rhs.nr_dense > nr_dense)
+			nr_dense = rhs.nr_dense;
+
+		if (!rhs.container)
+			return *this;
+
+		typename container_type::const_iterator it = rhs.container->begin();
+		typename container_type::const_iterator it_end = rhs.container->end();
 		for ( ; it != it_end; it++)
-			container[it->first] -= it->second;
+			(*this)[it->first] -= it->second;
 
 		return *this;
 	}
@@ -75,9 +144,9 @@ public:
 	 * is empty.
 	 */
 	size_type size() const {
-		if (container.size() == 0)
-			return 0;
-		typename container_type::const_iterator last = container.end();
+		if (!container || container->size() == 0)
+			return nr_dense;
+		typename container_type::const_iterator last = container->end();
 		--last;
 		return last->first + 1;
 	}
@@ -85,8 +154,15 @@ public:
 
 	/// return true if all elements have the default constructed value
 	bool zero() const {
-		typename container_type::const_iterator it = container.begin();
-		typename container_type::const_iterator it_end = container.end();
+		for (size_type i = 0; i < nr_dense; ++i)
+			if (dense[i] != 0)
+				return false;
+
+		if (!container)
+			return true;
+
+		typename container_type::const_iterator it = container->begin();
+		typename container_type::const_iterator it_end = container->end();
 		for ( ; it != it_end; it++)
 			if (it->second != 0)
 				return false;
@@ -94,7 +170,11 @@ public:
 	}
 
 private:
-	container_type container;
+	/// the first N elements, the ones below nr_dense exist
+	T dense[N];
+	size_type nr_dense;
+	/// elements from index N, NULL until one is created
+	container_type * container;
 };
 
 #endif // SPARSE_ARRAY_H
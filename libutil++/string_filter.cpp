@@ -10,6 +10,7 @@
  */
 
 #include <algorithm>
+#include <typeinfo>
 
 #include "string_filter.h"
 #include "string_manip.h"
@@ -47,3 +48,17 @@ bool string_filter::match(string const & str) const
 
 	return false;
 }
+
+
+string const string_filter::key() const
+{
+	// derived classes match differently with the same patterns
+	string result = typeid(*this).name();
+
+	for (size_t i = 0; i < include.size(); ++i)
+		result += "\n+" + include[i];
+	for (size_t i = 0; i < exclude.size(); ++i)
+		result += "\n-" + exclude[i];
+
+	return result;
+}
@@ -45,6 +45,9 @@ public:
 	/// Returns true if the given string matches
 	virtual bool match(std::string const & str) const;
 
+	/// Returns a string equal for any two filters matching the same strings
+	std::string const key() const;
+
 protected:
 	/// include patterns
 	std::vector<std::string> include;
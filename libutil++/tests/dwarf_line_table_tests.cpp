@@ -0,0 +1,344 @@
+/**
+ * @file dwarf_line_table_tests.cpp
+ * tests dwarf_line_table.h on hand built .debug_line programs
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "dwarf_line_table.h"
+#include "cverb.h"
+
+using namespace std;
+
+// defined by op_bfd.cpp, which this test doesn't need
+verbose vbfd("bfd");
+
+namespace {
+
+/// little endian DWARF data, with the line program opcodes we need
+class dwarf_buffer {
+public:
+	dwarf_buffer & byte(unsigned int value) {
+		data += char(value);
+		return *this;
+	}
+
+	dwarf_buffer & fixed(u64 value, size_t size) {
+		for (size_t i = 0; i < size; ++i, value >>= 8)
+			byte(value & 0xff);
+		return *this;
+	}
+
+	dwarf_buffer & uleb(u64 value) {
+		do {
+			unsigned int b = value & 0x7f;
+			value >>= 7;
+			byte(value ? b | 0x80 : b);
+		} while (value);
+		return *this;
+	}
+
+	dwarf_buffer & sleb(long long value) {
+		bool more;
+		do {
+			unsigned int b = value & 0x7f;
+			value >>= 7;
+			more = !((value == 0 && !(b & 0x40)) ||
+			         (value == -1 && (b & 0x40)));
+			byte(more ? b | 0x80 : b);
+		} while (more);
+		return *this;
+	}
+
+	dwarf_buffer & str(char const * s) {
+		data.append(s, strlen(s) + 1);
+		return *this;
+	}
+
+	dwarf_buffer & append(string const & s) {
+		data += s;
+		return *this;
+	}
+
+	dwarf_buffer & set_address(u64 address) {
+		return byte(0).uleb(9).byte(2).fixed(address, 8);
+	}
+
+	dwarf_buffer & end_sequence() { return byte(0).uleb(1).byte(1); }
+	dwarf_buffer & copy() { return byte(1); }
+	dwarf_buffer & advance_pc(u64 n) { return byte(2).uleb(n); }
+	dwarf_buffer & advance_line(long long n) { return byte(3).sleb(n); }
+	dwarf_buffer & set_file(u64 n) { return byte(4).uleb(n); }
+
+	string data;
+};
+
+
+/**
+ * A line program of the given version. tables holds the directory and
+ * file tables in the format of that version.
+ */
+string line_program(unsigned int version, string const & tables,
+                    string const & program)
+{
+	unsigned char const opcode_lengths[] =
+		{ 0, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 1 };
+
+	dwarf_buffer header;
+	header.byte(1);			// minimum_instruction_length
+	if (version >= 4)
+		header.byte(1);		// maximum_operations_per_instruction
+	header.byte(1);			// default_is_stmt
+	header.byte(0xfb);		// line_base -5
+	header.byte(14);		// line_range
+	header.byte(sizeof(opcode_lengths) + 1);
+	for (size_t i = 0; i < sizeof(opcode_lengths); ++i)
+		header.byte(opcode_lengths[i]);
+	header.append(tables);
+
+	dwarf_buffer unit;
+	unit.fixed(version, 2);
+	if (version >= 5)
+		unit.byte(8).byte(0);	// address and segment selector size
+	unit.fixed(header.data.size(), 4).append(header.data);
+	unit.append(program);
+
+	dwarf_buffer out;
+	out.fixed(unit.data.size(), 4).append(unit.data);
+	return out.data;
+}
+
+
+/// DWARF 2 to 4 tables: one directory, the files are in dir_index
+string tables_v2(char const * dir, char const * file, unsigned int dir_index)
+{
+	dwarf_buffer t;
+	if (dir)
+		t.str(dir);
+	t.byte(0);
+	t.str(file).uleb(dir_index).uleb(0).uleb(0);
+	t.byte(0);
+	return t.data;
+}
+
+
+/// DWARF 5 tables: directory 0 is dir, both files are in it
+string tables_v5(char const * dir, char const * file0, char const * file1)
+{
+	dwarf_buffer t;
+	t.byte(1).uleb(1).uleb(0x08);		// DW_LNCT_path, DW_FORM_string
+	t.uleb(1).str(dir);
+	t.byte(2).uleb(1).uleb(0x08);		// DW_LNCT_path, DW_FORM_string
+	t.uleb(2).uleb(0x0f);			// DW_LNCT_directory_index, udata
+	t.uleb(2).str(file0).uleb(0).str(file1).uleb(0);
+	return t.data;
+}
+
+
+/// a DWARF 4 compilation unit pointing at the line program at stmt_list
+void add_unit(dwarf_line_table::sections & s, u64 stmt_list,
+              char const * comp_dir)
+{
+	dwarf_buffer abbrev;
+	abbrev.uleb(1).uleb(0x11).byte(0);	// DW_TAG_compile_unit
+	abbrev.uleb(0x10).uleb(0x17);		// DW_AT_stmt_list, sec_offset
+	abbrev.uleb(0x1b).uleb(0x08);		// DW_AT_comp_dir, string
+	abbrev.uleb(0).uleb(0).uleb(0);
+	s.debug_abbrev = abbrev.data;
+
+	dwarf_buffer unit;
+	unit.fixed(4, 2).fixed(0, 4).byte(8);
+	unit.uleb(1).fixed(stmt_list, 4).str(comp_dir);
+
+	dwarf_buffer info;
+	info.fixed(unit.data.size(), 4).append(unit.data);
+	s.debug_info = info.data;
+}
+
+
+/**
+ * The line programs of the tests:
+ *  - a sequence at 0 of code discarded by the linker, overlapping the
+ *    others, it must be ignored
+ *  - a DWARF 2 sequence [0x1000, 0x1020) of /src/a.c
+ *  - an adjacent DWARF 4 sequence [0x1020, 0x1030) of /build/b.c, its
+ *    directory being the DW_AT_comp_dir of its unit
+ *  - a DWARF 5 sequence [0x3000, 0x3100) of /v5/inc.h, the file register
+ *    starting at 1 as in the standard, where libbfd starts it at 0
+ */
+dwarf_line_table::sections test_sections()
+{
+	dwarf_line_table::sections s;
+
+	dwarf_buffer gc;
+	gc.set_address(0).advance_line(99).copy();
+	gc.advance_pc(0x1800).copy().advance_pc(0x800).end_sequence();
+
+	dwarf_buffer v2;
+	v2.set_address(0x1000).advance_line(8).copy();
+	// the last row at an address wins
+	v2.advance_line(1).copy();
+	v2.advance_pc(0x10).advance_line(2).copy();
+	v2.advance_pc(0x10).end_sequence();
+
+	dwarf_buffer v4;
+	v4.set_address(0x1020).advance_line(19).copy();
+	v4.advance_pc(8).advance_line(1).copy();
+	v4.advance_pc(8).end_sequence();
+
+	dwarf_buffer v5;
+	v5.set_address(0x3000).advance_line(4).copy();
+	// enough rows to go past the forward scan of find()
+	for (int i = 1; i < 30; ++i)
+		v5.advance_pc(8).advance_line(1).copy();
+	v5.set_file(0).advance_pc(8).copy();
+	v5.advance_pc(0x10).end_sequence();
+
+	s.debug_line = line_program(2, tables_v2("/src", "a.c", 1), gc.data);
+	s.debug_line += line_program(2, tables_v2("/src", "a.c", 1), v2.data);
+	add_unit(s, s.debug_line.size(), "/build");
+	s.debug_line += line_program(4, tables_v2(0, "b.c", 0), v4.data);
+	s.debug_line += line_program(5, tables_v5("/v5", "main.c", "inc.h"),
+	                             v5.data);
+
+	s.code.push_back(make_pair(u64(0x1000), u64(0x2100)));
+	return s;
+}
+
+
+struct lookup {
+	u64 address;
+	/// NULL if the address must not be found
+	char const * filename;
+	unsigned int line;
+};
+
+
+lookup const lookups[] = {
+	{ 0x0, 0, 0 },
+	{ 0xfff, 0, 0 },
+	{ 0x1000, "/src/a.c", 10 },
+	{ 0x100f, "/src/a.c", 10 },
+	{ 0x1010, "/src/a.c", 12 },
+	{ 0x101f, "/src/a.c", 12 },
+	// the next sequence starts where the previous one ends
+	{ 0x1020, "/build/b.c", 20 },
+	{ 0x1028, "/build/b.c", 21 },
+	{ 0x102f, "/build/b.c", 21 },
+	// after an end_sequence
+	{ 0x1030, 0, 0 },
+	{ 0x2000, 0, 0 },
+	{ 0x3000, "/v5/inc.h", 5 },
+	{ 0x3008, "/v5/inc.h", 6 },
+	{ 0x30ef, "/v5/inc.h", 34 },
+	{ 0x30f0, "/v5/main.c", 34 },
+	{ 0x30ff, "/v5/main.c", 34 },
+	{ 0x3100, 0, 0 },
+	{ 0x10000, 0, 0 },
+	{ ~u64(0), 0, 0 },
+};
+
+size_t const nr_lookups = sizeof(lookups) / sizeof(lookups[0]);
+
+
+void check_lookup(dwarf_line_table const & table, lookup const & l)
+{
+	string filename;
+	unsigned int line = 0;
+	bool const found = table.find(l.address, filename, line);
+
+	if (found != (l.filename != 0) ||
+	    (found && (filename != l.filename || line != l.line))) {
+		cerr << "find(0x" << hex << l.address << dec << "): expected ";
+		if (l.filename)
+			cerr << l.filename << ":" << l.line;
+		else
+			cerr << "not found";
+		cerr << ", got ";
+		if (found)
+			cerr << filename << ":" << line << endl;
+		else
+			cerr << "not found" << endl;
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+void check_lookups()
+{
+	dwarf_line_table const table(test_sections());
+
+	if (table.empty()) {
+		cerr << "no row indexed" << endl;
+		exit(EXIT_FAILURE);
+	}
+
+	// in address order, as for the samples of a profile
+	for (size_t i = 0; i < nr_lookups; ++i)
+		check_lookup(table, lookups[i]);
+
+	// backward, and jumping around, from a table with a last row set
+	for (size_t i = nr_lookups; i-- > 0; )
+		check_lookup(table, lookups[i]);
+	for (size_t i = 0; i < nr_lookups; ++i)
+		check_lookup(table, lookups[(i * 7) % nr_lookups]);
+
+	// a fresh table starting with a lookup past all sequences
+	dwarf_line_table const other(test_sections());
+	check_lookup(other, lookups[nr_lookups - 1]);
+	check_lookup(other, lookups[2]);
+}
+
+
+/// a truncated or unsupported program is skipped, not fatal
+void check_bad_programs()
+{
+	dwarf_line_table::sections s = test_sections();
+	string const good = s.debug_line;
+
+	// unknown version
+	dwarf_buffer v6;
+	v6.fixed(2, 4).fixed(6, 2);
+	s.debug_line = v6.data + good;
+	s.debug_info.clear();
+	if (dwarf_line_table(s).empty()) {
+		cerr << "version 6 program stopped the decoding" << endl;
+		exit(EXIT_FAILURE);
+	}
+
+	// a 4 bytes DW_LNE_set_address in a program of 8 bytes addresses
+	dwarf_buffer short_address;
+	short_address.byte(0).uleb(5).byte(2).fixed(0x3000, 4);
+	short_address.advance_line(4).copy().advance_pc(8).end_sequence();
+	s.debug_line = line_program(5, tables_v5("/v5", "main.c", "inc.h"),
+	                            short_address.data);
+	if (!dwarf_line_table(s).empty()) {
+		cerr << "short DW_LNE_set_address operand accepted" << endl;
+		exit(EXIT_FAILURE);
+	}
+
+	// every truncation of the programs
+	for (size_t size = 0; size < good.size(); ++size) {
+		s.debug_line = good.substr(0, size);
+		dwarf_line_table const table(s);
+		string filename;
+		unsigned int line;
+		table.find(0x1000, filename, line);
+	}
+}
+
+}  // anonymous namespace
+
+
+int main()
+{
+	check_lookups();
+	check_bad_programs();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,179 @@
+/**
+ * @file sparse_array_tests.cpp
+ * tests sparse_array.h against a std::map
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+
+#include "sparse_array.h"
+
+using namespace std;
+
+namespace {
+
+typedef sparse_array<unsigned int, unsigned int> array_t;
+
+/// the reference, what sparse_array was before it got inline storage
+typedef map<unsigned int, unsigned int> reference_t;
+
+/// indexes checked, past the two inline elements and the highest used
+unsigned int const max_index = 8;
+
+
+unsigned int size(reference_t const & ref)
+{
+	return ref.empty() ? 0 : (--ref.end())->first + 1;
+}
+
+
+bool zero(reference_t const & ref)
+{
+	reference_t::const_iterator it;
+	for (it = ref.begin(); it != ref.end(); ++it) {
+		if (it->second)
+			return false;
+	}
+	return true;
+}
+
+
+void check(char const * what, array_t const & array, reference_t const & ref)
+{
+	bool ok = array.size() == size(ref) && array.zero() == zero(ref);
+
+	for (unsigned int i = 0; ok && i < max_index; ++i) {
+		reference_t::const_iterator it = ref.find(i);
+		ok = array[i] == (it == ref.end() ? 0 : it->second);
+	}
+
+	if (!ok) {
+		cerr << what << ": sparse_array differs from its reference, "
+		     << "size " << array.size() << " != " << size(ref) << endl;
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+void add(array_t & array, reference_t & ref, unsigned int index,
+         unsigned int value)
+{
+	array[index] += value;
+	ref[index] += value;
+}
+
+
+/// grow an array from empty to spilled, checking each step
+void check_spill()
+{
+	array_t array;
+	reference_t ref;
+	check("empty", array, ref);
+
+	// an element created with a zero count changes size(), not zero()
+	add(array, ref, 1, 0);
+	check("inline zero element", array, ref);
+	add(array, ref, 1, 3);
+	check("inline element", array, ref);
+	add(array, ref, 0, 2);
+	check("inline elements", array, ref);
+	add(array, ref, 5, 0);
+	check("spilled zero element", array, ref);
+	add(array, ref, 5, 7);
+	check("spilled element", array, ref);
+	add(array, ref, 2, 1);
+	check("spilled element below the last one", array, ref);
+
+	// an array spilling before its inline elements are used
+	array_t sparse;
+	reference_t sparse_ref;
+	add(sparse, sparse_ref, 6, 4);
+	check("spilled first", sparse, sparse_ref);
+	add(sparse, sparse_ref, 1, 4);
+	check("spilled then inline", sparse, sparse_ref);
+}
+
+
+void check_copy()
+{
+	array_t inline_array, spilled;
+	reference_t inline_ref, spilled_ref;
+	add(inline_array, inline_ref, 1, 3);
+	add(spilled, spilled_ref, 0, 1);
+	add(spilled, spilled_ref, 4, 2);
+
+	array_t inline_copy(inline_array);
+	check("copy of an inline array", inline_copy, inline_ref);
+	array_t spilled_copy(spilled);
+	check("copy of a spilled array", spilled_copy, spilled_ref);
+
+	// the copies don't share anything with their source
+	add(spilled_copy, spilled_ref, 4, 1);
+	add(spilled_copy, spilled_ref, 7, 1);
+	check("modified copy of a spilled array", spilled_copy, spilled_ref);
+	spilled_ref[4] -= 1;
+	spilled_ref.erase(7);
+	check("source of a modified copy", spilled, spilled_ref);
+
+	array_t target;
+	target = spilled;
+	check("inline = spilled", target, spilled_ref);
+	target = spilled;
+	check("spilled = spilled", target, spilled_ref);
+	target = inline_array;
+	check("spilled = inline", target, inline_ref);
+	target = inline_array;
+	check("inline = inline", target, inline_ref);
+
+	array_t & self = spilled;
+	spilled = self;
+	check("self assignment", spilled, spilled_ref);
+}
+
+
+/// operator+= and operator-= across inline and spilled arrays
+void check_arithmetic()
+{
+	array_t array, other;
+	reference_t ref, other_ref;
+
+	for (unsigned int i = 0; i < 40; ++i) {
+		unsigned int const index = (i * 5) % (max_index - 2);
+		add(other, other_ref, index, i + 1);
+
+		array += other;
+		reference_t::const_iterator it;
+		for (it = other_ref.begin(); it != other_ref.end(); ++it)
+			ref[it->first] += it->second;
+		check("operator+=", array, ref);
+	}
+
+	array -= other;
+	reference_t::const_iterator it;
+	for (it = other_ref.begin(); it != other_ref.end(); ++it)
+		ref[it->first] -= it->second;
+	check("operator-=", array, ref);
+
+	array_t empty;
+	empty += array;
+	check("empty += spilled", empty, ref);
+	empty -= array;
+	for (reference_t::iterator pos = ref.begin(); pos != ref.end(); ++pos)
+		pos->second = 0;
+	check("spilled -= the same values", empty, ref);
+}
+
+}  // anonymous namespace
+
+
+int main()
+{
+	check_spill();
+	check_copy();
+	check_arithmetic();
+	return EXIT_SUCCESS;
+}
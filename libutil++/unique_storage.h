@@ -13,9 +13,23 @@
 #define UNIQUE_STORAGE_H
 
 #include <vector>
-#include <map>
+#include <deque>
+#include <algorithm>
+#include <string>
+#include <utility>
 #include <stdexcept>
 
+/// hash of the key of a value stored by unique_storage
+inline size_t unique_storage_hash(std::string const & key)
+{
+	// FNV-1a
+	size_t hash = 2166136261U;
+	for (std::string::const_iterator it = key.begin(); it != key.end(); ++it)
+		hash = (hash ^ (unsigned char)*it) * 16777619U;
+	return hash;
+}
+
+
 /**
  * Store values such that only one copy of the value
  * is ever stored.
@@ -28,19 +42,31 @@
  *
  * The value type "V" must be default-constructible,
  * and this is the value returned by a stored id_value
- * where .set() is false
+ * where .set() is false. Values are identified by a key:
+ * V::key_type is the key type, V must be constructible from
+ * a key and V::key() return the key of a value.
+ *
+ * Values are found through a hash table on their key, so
+ * create() doesn't build a value nor compare whole keys to
+ * find an existing one.
  */
 template <typename I, typename V> class unique_storage {
 
 public:
-	unique_storage() {
+	unique_storage() : nr_slots_used(0) {
 		// id 0
 		values.push_back(V());
 	}
 
 	virtual ~unique_storage() {}
 
-	typedef std::vector<V> stored_values;
+	/**
+	 * A deque so storing a value never copies the others, and the
+	 * references returned by get() remain valid.
+	 */
+	typedef std::deque<V> stored_values;
+
+	typedef typename V::key_type key_type;
 
 	/// the actual ID type
 	struct id_value {
@@ -64,6 +90,11 @@ public:
 			return !(id == rhs.id);
 		}
 
+		/// a value to hash on, equal IDs have equal hash values
+		size_t hash() const {
+			return id;
+		}
+
 	private:
 		friend class unique_storage<I, V>;
 
@@ -76,15 +107,22 @@ public:
 	};
 
 
-	/// ensure this value is available
-	id_value const create(V const & value) {
-		typename id_map::value_type val(value, id_value(values.size()));
-		std::pair<typename id_map::iterator, bool>
-			inserted = ids.insert(val);
-		if (inserted.second)
-			values.push_back(value);
+	/// ensure the value with this key is available
+	id_value const create(key_type const & key) {
+		// keep the load factor under one half
+		if (2 * (nr_slots_used + 1) > slots.size())
+			rehash();
+
+		size_t const hash = unique_storage_hash(key);
+		size_t const slot = find_slot(key, hash);
+		if (slots[slot].second)
+			return id_value(slots[slot].second);
 
-		return inserted.first->second;
+		slots[slot] = slot_type(hash, values.size());
+		++nr_slots_used;
+		values.push_back(V(key));
+
+		return id_value(values.size() - 1);
 	}
 
 
@@ -98,13 +136,46 @@ public:
 	}
 
 private:
-	typedef std::map<V, id_value> id_map;
+	/// hash of the key and ID of a value, ID 0 for an empty slot
+	typedef std::pair<size_t, size_t> slot_type;
+
+	/// return the slot of key, or the empty slot where it goes
+	size_t find_slot(key_type const & key, size_t hash) const {
+		size_t const mask = slots.size() - 1;
+		size_t slot = hash & mask;
+		for (; slots[slot].second; slot = (slot + 1) & mask) {
+			if (slots[slot].first == hash &&
+			    values[slots[slot].second].key() == key)
+				break;
+		}
+		return slot;
+	}
+
+	/// grow the hash table, the hashes stored are reused
+	void rehash() {
+		std::vector<slot_type> old_slots(
+			std::max(slots.size() * 2, size_t(64)), slot_type(0, 0));
+		slots.swap(old_slots);
+
+		size_t const mask = slots.size() - 1;
+		for (size_t i = 0; i < old_slots.size(); ++i) {
+			if (!old_slots[i].second)
+				continue;
+			size_t slot = old_slots[i].first & mask;
+			while (slots[slot].second)
+				slot = (slot + 1) & mask;
+			slots[slot] = old_slots[i];
+		}
+	}
 
 	/// the contained values
 	stored_values values;
 
-	/// map from ID to value
-	id_map ids;
+	/// open addressing hash table of the values
+	std::vector<slot_type> slots;
+
+	/// number of non empty slots
+	size_t nr_slots_used;
 };
 
 #endif /* !UNIQUE_STORAGE_H */
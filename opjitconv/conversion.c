@@ -12,81 +12,103 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "opjitconv.h"
 
-static void free_jit_records(void)
+static void free_jit_records(struct jitconv_ctx * ctx)
 {
 	struct jitentry * entry, * next;
 
-	for (entry = jitentry_list; entry; entry = next) {
+	for (entry = ctx->jitentry_list; entry; entry = next) {
 		if (entry->sym_name_malloced)
 			free(entry->symbol_name);
 		next = entry->next;
 		free(entry);
 	}
-	jitentry_list = NULL;
+	ctx->jitentry_list = NULL;
 }
 
-static void free_jit_debug_line(void)
+static void free_jit_debug_line(struct jitconv_ctx * ctx)
 {
 	struct jitentry_debug_line * entry, * next;
 
-	for (entry = jitentry_debug_line_list; entry; entry = next) {
+	for (entry = ctx->jitentry_debug_line_list; entry; entry = next) {
 		next = entry->next;
 		free(entry);
 	}
-	jitentry_debug_line_list = NULL;
+	ctx->jitentry_debug_line_list = NULL;
 }
 
-int op_jit_convert(struct op_jitdump_info * file_info, char const * elffile,
-                   unsigned long long start_time, unsigned long long end_time)
+static int convert(struct op_jitdump_info * file_info, char const * elffile,
+                   unsigned long long start_time, unsigned long long end_time,
+                   int use_libbfd)
 {
 	void const * jitdump = file_info->dmp_file;
+	struct jitconv_ctx ctx;
 	int rc= OP_JIT_CONV_OK;
 
-	entry_count = 0;
-	max_entry_count = 0;
-	syms = NULL;
-	cur_bfd = NULL;
-	jitentry_list = NULL;
-	jitentry_debug_line_list = NULL;
-	entries_symbols_ascending = entries_address_ascending = NULL;
+	memset(&ctx, 0, sizeof(ctx));
 
-	if ((rc = parse_all(jitdump, jitdump + file_info->dmp_file_stat.st_size,
+	if ((rc = parse_all(&ctx, jitdump,
+	                    jitdump + file_info->dmp_file_stat.st_size,
 	                    end_time)) == OP_JIT_CONV_FAIL)
 		goto out;
 
-	create_arrays();
-	if ((rc = resolve_overlaps(start_time)) == OP_JIT_CONV_FAIL)
+	create_arrays(&ctx);
+	if ((rc = resolve_overlaps(&ctx, start_time)) == OP_JIT_CONV_FAIL)
+		goto out;
+
+	disambiguate_symbol_names(&ctx);
+	if (!ctx.entry_count) {
+		rc = OP_JIT_CONV_NO_JIT_RECS_IN_DUMPFILE;
 		goto out;
+	}
 
-	disambiguate_symbol_names();
-	if (!entry_count)
-		return OP_JIT_CONV_NO_JIT_RECS_IN_DUMPFILE;
+	/* libbfd is only needed for the targets we can't write ourselves */
+	if (!use_libbfd && elf_target_supported(&ctx)) {
+		create_debug_line_info(&ctx);
+		rc = write_elf(&ctx, elffile);
+		goto out;
+	}
 
-	if ((cur_bfd = open_elf(elffile)) == NULL) {
+	if ((ctx.cur_bfd = open_elf(&ctx, elffile)) == NULL) {
 		rc = OP_JIT_CONV_FAIL;
 		goto out;
 	}
 
-	init_debug_line_info(cur_bfd);
+	init_debug_line_info(&ctx);
 
-	if ((rc = partition_sections()) == OP_JIT_CONV_FAIL)
+	if ((rc = partition_sections(&ctx)) == OP_JIT_CONV_FAIL)
 		goto out;
 
-	if ((rc = fill_sections()) == OP_JIT_CONV_FAIL)
+	if ((rc = fill_sections(&ctx)) == OP_JIT_CONV_FAIL)
 		goto out;
 
-	finalize_debug_line_info(cur_bfd);
-
-	if (cur_bfd)
-		bfd_close(cur_bfd);
-	free(syms);
-	out: free_jit_records();
-	free_jit_debug_line();
-	free(entries_symbols_ascending);
-	free(entries_address_ascending);
+	finalize_debug_line_info(&ctx);
+
+	bfd_close(ctx.cur_bfd);
+out:
+	free(ctx.syms);
+	free_jit_records(&ctx);
+	free_jit_debug_line(&ctx);
+	free_buffer(&ctx.b_line);
+	free_buffer(&ctx.b_debug_info);
+	free_buffer(&ctx.b_debug_abbrev);
+	free(ctx.entries_symbols_ascending);
+	free(ctx.entries_address_ascending);
 	return rc;
 }
 
+int op_jit_convert(struct op_jitdump_info * file_info, char const * elffile,
+                   unsigned long long start_time, unsigned long long end_time)
+{
+	return convert(file_info, elffile, start_time, end_time, 0);
+}
+
+int op_jit_convert_libbfd(struct op_jitdump_info * file_info,
+                          char const * elffile, unsigned long long start_time,
+                          unsigned long long end_time)
+{
+	return convert(file_info, elffile, start_time, end_time, 1);
+}
@@ -25,7 +25,7 @@
 
 /* Create the symbols and fill the syms array for all functions
  * from start_idx to end_idx pointing into entries_address_ascending array */
-static int fill_symtab(void)
+static int fill_symtab(struct jitconv_ctx * ctx)
 {
 	int rc = OP_JIT_CONV_OK;
 	u32 i;
@@ -35,22 +35,22 @@ static int fill_symtab(void)
 	asection * section = NULL;
 
 	/* Check for valid value of entry_count to avoid integer overflow. */
-	if (entry_count > UINT32_MAX - 1) {
+	if (ctx->entry_count > UINT32_MAX - 1) {
 		bfd_perror("invalid entry_count value");
 		rc = OP_JIT_CONV_FAIL;
 		goto out;
 	}
 	
-	syms = xmalloc(sizeof(asymbol *) * (entry_count+1));
-	syms[entry_count] = NULL;
-	assert(entries_address_ascending[0]->section);
+	ctx->syms = xmalloc(sizeof(asymbol *) * (ctx->entry_count+1));
+	ctx->syms[ctx->entry_count] = NULL;
+	assert(ctx->entries_address_ascending[0]->section);
 	// Do this to silence Coverity
-	section = entries_address_ascending[0]->section;
-	for (i = 0; i < entry_count; i++) {
-		e = entries_address_ascending[i];
+	section = ctx->entries_address_ascending[0]->section;
+	for (i = 0; i < ctx->entry_count; i++) {
+		e = ctx->entries_address_ascending[i];
 		if (e->section)
 			section = e->section;
-		s = bfd_make_empty_symbol(cur_bfd);
+		s = bfd_make_empty_symbol(ctx->cur_bfd);
 		if (!s) {
 			bfd_perror("bfd_make_empty_symbol");
 			rc = OP_JIT_CONV_FAIL;
@@ -62,9 +62,9 @@ static int fill_symtab(void)
 		s->value = e->vma - section->vma;
 		verbprintf(debug,"add sym: name=%s, value=%llx\n", s->name,
 			   (unsigned long long)s->value);
-		syms[i] = s;
+		ctx->syms[i] = s;
 	}
-	r = bfd_set_symtab(cur_bfd, syms, entry_count);
+	r = bfd_set_symtab(ctx->cur_bfd, ctx->syms, ctx->entry_count);
 	if (r == FALSE) {
 		bfd_perror("bfd_set_symtab");
 		rc = OP_JIT_CONV_FAIL;
@@ -103,7 +103,8 @@ error:
 
 
 /* create a .text section. end_idx: index last jitentry (inclusive!)  */
-static int create_text_section(int start_idx, int end_idx)
+static int create_text_section(struct jitconv_ctx * ctx, int start_idx,
+			       int end_idx)
 {
 	int rc = OP_JIT_CONV_OK;
 
@@ -111,19 +112,19 @@ static int create_text_section(int start_idx, int end_idx)
 	char const * section_name;
 	int idx = start_idx;
 	unsigned long long vma_start =
-		entries_address_ascending[start_idx]->vma;
-	struct jitentry * ee = entries_address_ascending[end_idx];
+		ctx->entries_address_ascending[start_idx]->vma;
+	struct jitentry * ee = ctx->entries_address_ascending[end_idx];
 	unsigned long long vma_end = ee->vma + ee->code_size;
 	int size = vma_end - vma_start;
 
-	section_name = bfd_get_unique_section_name(cur_bfd, ".text", &idx);
+	section_name = bfd_get_unique_section_name(ctx->cur_bfd, ".text", &idx);
 	verbprintf(debug, "section idx=%i, name=%s, vma_start=%llx, size=%i\n",
 		   idx, section_name, vma_start, size);
 
-	section = create_section(cur_bfd, section_name, size, vma_start,
+	section = create_section(ctx->cur_bfd, section_name, size, vma_start,
                SEC_ALLOC|SEC_LOAD|SEC_READONLY|SEC_CODE|SEC_HAS_CONTENTS);
 	if (section)
-		entries_address_ascending[start_idx]->section = section;
+		ctx->entries_address_ascending[start_idx]->section = section;
 	else
 		rc = OP_JIT_CONV_FAIL;
 
@@ -145,17 +146,18 @@ int fill_section_content(bfd * abfd, asection * section,
  * Copy all code of the functions that are within start_idx and end_idx to 
  * the section.
  */
-static int fill_text_section_content(asection * section, int start_idx,
+static int fill_text_section_content(struct jitconv_ctx * ctx,
+				     asection * section, int start_idx,
 				     int end_idx)
 {
 	int rc = OP_JIT_CONV_OK;
 	unsigned long long vma_start =
-		entries_address_ascending[start_idx]->vma;
+		ctx->entries_address_ascending[start_idx]->vma;
 	struct jitentry const * e;
 	int i;
 
 	for (i = start_idx; i <= end_idx; i++) {
-		e = entries_address_ascending[i];
+		e = ctx->entries_address_ascending[i];
 		verbprintf(debug, "section = %s, i = %i, code = %llx,"
 			   " vma = %llx, offset = %llx,"
 			   "size = %i, name = %s\n",
@@ -168,7 +170,7 @@ static int fill_text_section_content(asection * section, int start_idx,
 		 * for the code location.
 		 */
 		if (e->code) {
-			rc = fill_section_content(cur_bfd, section,
+			rc = fill_section_content(ctx->cur_bfd, section,
 				e->code, (file_ptr) (e->vma - vma_start),
 				(bfd_size_type)e->code_size);
 			if (rc != OP_JIT_CONV_OK)
@@ -182,7 +184,7 @@ static int fill_text_section_content(asection * section, int start_idx,
 /* Walk over the symbols sorted by address and create ELF sections. Whenever we
  * have a gap greater or equal to 4096 make a new section.
  */
-int partition_sections(void)
+int partition_sections(struct jitconv_ctx * ctx)
 {
 	int rc = OP_JIT_CONV_OK;
 	u32 i, j;
@@ -192,44 +194,44 @@ int partition_sections(void)
 
 	// i: start index of the section
 	i = 0;
-	for (j = 1; j < entry_count; j++) {
-		entry = entries_address_ascending[j];
-		pred = entries_address_ascending[j - 1];
+	for (j = 1; j < ctx->entry_count; j++) {
+		entry = ctx->entries_address_ascending[j];
+		pred = ctx->entries_address_ascending[j - 1];
 		end_addr = pred->vma + pred->code_size;
 		// calculate gap between code, if it is more than one page
 		// create an additional section
 		if ((entry->vma - end_addr) >= 4096) {
-			rc = create_text_section(i, j - 1);
+			rc = create_text_section(ctx, i, j - 1);
 			if (rc == OP_JIT_CONV_FAIL)
 				goto out;
 			i = j;
 		}
 	}
 	// this holds always if we have at least one jitentry
-	if (i < entry_count)
-		rc = create_text_section(i, entry_count - 1);
+	if (i < ctx->entry_count)
+		rc = create_text_section(ctx, i, ctx->entry_count - 1);
 out:
 	return rc;
 }
 
 
 /* Fill the code content into the sections created by partition_sections() */
-int fill_sections(void)
+int fill_sections(struct jitconv_ctx * ctx)
 {
 	int rc = OP_JIT_CONV_OK;
 	u32 i, j;
 	asection * section;
 
-	rc = fill_symtab();
+	rc = fill_symtab(ctx);
 	if (rc == OP_JIT_CONV_FAIL)
 		goto out;
 
 	verbprintf(debug, "opjitconv: fill_sections\n");
 	i = 0;
-	for (j = 1; j < entry_count; j++) {
-		if (entries_address_ascending[j]->section) {
-			section = entries_address_ascending[i]->section;
-			rc = fill_text_section_content(section, i,
+	for (j = 1; j < ctx->entry_count; j++) {
+		if (ctx->entries_address_ascending[j]->section) {
+			section = ctx->entries_address_ascending[i]->section;
+			rc = fill_text_section_content(ctx, section, i,
 						       j - 1);
 			if (rc == OP_JIT_CONV_FAIL)
 				goto out;
@@ -237,10 +239,10 @@ int fill_sections(void)
 		}
 	}
 	// this holds always if we have at least one jitentry
-	if (i < entry_count) {
-		section = entries_address_ascending[i]->section;
-		rc = fill_text_section_content(section,
-					       i, entry_count - 1);
+	if (i < ctx->entry_count) {
+		section = ctx->entries_address_ascending[i]->section;
+		rc = fill_text_section_content(ctx, section,
+					       i, ctx->entry_count - 1);
 	}
 out:
 	return rc;
@@ -248,11 +250,11 @@ out:
 
 
 /* create the elf file */
-bfd * open_elf(char const * filename)
+bfd * open_elf(struct jitconv_ctx * ctx, char const * filename)
 {
 	bfd * abfd;
 
-	abfd = bfd_openw(filename, dump_bfd_target_name);
+	abfd = bfd_openw(filename, ctx->dump_bfd_target_name);
 	if (!abfd) {
 		bfd_perror("bfd_openw");
 		goto error1;
@@ -261,7 +263,8 @@ bfd * open_elf(char const * filename)
 		bfd_perror("bfd_set_format");
 		goto error;
 	}
-	if (bfd_set_arch_mach(abfd, dump_bfd_arch, dump_bfd_mach) == FALSE) {
+	if (bfd_set_arch_mach(abfd, ctx->dump_bfd_arch,
+			      ctx->dump_bfd_mach) == FALSE) {
 		bfd_perror("bfd_set_arch_mach");
 		goto error;
 	}
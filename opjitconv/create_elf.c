@@ -0,0 +1,476 @@
+/**
+ * @file create_elf.c
+ * Write the ELF file of a jit dump directly, without libbfd
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ *
+ * The file is the relocatable object open_elf() and friends build through
+ * libbfd: one .text section per run of code with no gap of a page or more,
+ * one global function symbol per jitted method and the DWARF sections of
+ * debug_line.c. All sizes are known once the entries are sorted, so the
+ * file is written front to back through one buffered stream, taking the
+ * code straight from the mmapped dump.
+ */
+
+#include "opjitconv.h"
+#include "op_libiberty.h"
+
+#include <elf.h>
+#include <endian.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+#define HOST_ELFDATA ELFDATA2LSB
+#else
+#define HOST_ELFDATA ELFDATA2MSB
+#endif
+
+/* size of the stdio buffer of the ELF file */
+#define ELF_BUFFER_SIZE (1024 * 1024)
+
+/* Bfd target names, without their elf32-/elf64- prefix, written by opagent,
+ * with the EI_OSABI and e_flags libbfd writes for an object with no private
+ * flags set: the ARM backend marks an object of unknown EABI version as
+ * ELFOSABI_ARM, the others leave both at zero.
+ */
+static struct elf_target {
+	char const * name;
+	int machine32;
+	int machine64;
+	int data;
+	int osabi;
+	u32 flags;
+} const elf_targets[] = {
+	{ "x86-64", EM_X86_64, EM_X86_64, ELFDATA2LSB, ELFOSABI_NONE, 0 },
+	{ "i386", EM_386, EM_386, ELFDATA2LSB, ELFOSABI_NONE, 0 },
+	{ "powerpc", EM_PPC, EM_PPC64, ELFDATA2MSB, ELFOSABI_NONE, 0 },
+	{ "powerpcle", EM_PPC, EM_PPC64, ELFDATA2LSB, ELFOSABI_NONE, 0 },
+	{ "littleaarch64", EM_AARCH64, EM_AARCH64, ELFDATA2LSB, ELFOSABI_NONE, 0 },
+	{ "bigaarch64", EM_AARCH64, EM_AARCH64, ELFDATA2MSB, ELFOSABI_NONE, 0 },
+	{ "littlearm", EM_ARM, EM_ARM, ELFDATA2LSB, ELFOSABI_ARM, 0 },
+	{ "bigarm", EM_ARM, EM_ARM, ELFDATA2MSB, ELFOSABI_ARM, 0 },
+	{ "s390", EM_S390, EM_S390, ELFDATA2MSB, ELFOSABI_NONE, 0 },
+	{ NULL, 0, 0, 0, 0, 0 }
+};
+
+/* a .text section, covering entries_address_ascending[first .. last] */
+struct text_section {
+	u32 first;
+	u32 last;
+	unsigned long long vma;
+	unsigned long long size;
+	unsigned long long offset;
+	u32 name;
+};
+
+struct elf_writer {
+	FILE * out;
+	unsigned long long pos;
+	int elf64;
+	/* errno of the first failed write, 0 if none */
+	int error;
+};
+
+/* section indexes after the .text sections */
+enum {
+	SEC_DEBUG_LINE,
+	SEC_DEBUG_INFO,
+	SEC_DEBUG_ABBREV,
+	SEC_SYMTAB,
+	SEC_STRTAB,
+	SEC_SHSTRTAB,
+	NR_OTHER_SECTIONS
+};
+
+
+/* return the dump target, or NULL if we don't know it */
+static struct elf_target const *
+elf_target(struct jitconv_ctx const * ctx, int * elf64)
+{
+	char const * name = ctx->dump_bfd_target_name;
+	struct elf_target const * target;
+
+	if (!name)
+		return NULL;
+	if (!strncmp(name, "elf64-", 6))
+		*elf64 = 1;
+	else if (!strncmp(name, "elf32-", 6))
+		*elf64 = 0;
+	else
+		return NULL;
+
+	for (target = elf_targets; target->name; ++target) {
+		/* the dump is in the byte order of the host */
+		if (!strcmp(name + 6, target->name) &&
+		    target->data == HOST_ELFDATA)
+			return target;
+	}
+	return NULL;
+}
+
+
+/* Split the entries into .text sections the way partition_sections() does:
+ * a gap of a page or more starts a new section. Return the number of
+ * sections, filling sections if it's not NULL.
+ */
+static u32 partition_text(struct jitconv_ctx const * ctx,
+			  struct text_section * sections)
+{
+	u32 nr = 0;
+	u32 i, j;
+
+	for (i = 0, j = 1; j <= ctx->entry_count; j++) {
+		struct jitentry const * pred =
+			ctx->entries_address_ascending[j - 1];
+		unsigned long long end_addr = pred->vma + pred->code_size;
+		if (j < ctx->entry_count &&
+		    ctx->entries_address_ascending[j]->vma - end_addr < 4096)
+			continue;
+		if (sections) {
+			struct text_section * section = &sections[nr];
+			section->first = i;
+			section->last = j - 1;
+			section->vma = ctx->entries_address_ascending[i]->vma;
+			section->size = end_addr - section->vma;
+		}
+		nr++;
+		i = j;
+	}
+	return nr;
+}
+
+
+int elf_target_supported(struct jitconv_ctx const * ctx)
+{
+	int elf64;
+
+	if (!elf_target(ctx, &elf64))
+		return 0;
+	/* we don't use the extended section numbering */
+	return partition_text(ctx, NULL) + 1 + NR_OTHER_SECTIONS <
+		SHN_LORESERVE;
+}
+
+
+static void write_data(struct elf_writer * w, void const * data, size_t len)
+{
+	/* a short write doesn't always set errno */
+	errno = 0;
+	if (fwrite(data, 1, len, w->out) != len && !w->error)
+		w->error = errno ? errno : EIO;
+	w->pos += len;
+}
+
+
+/* zero fill up to the given file offset */
+static void write_padding(struct elf_writer * w, unsigned long long offset)
+{
+	static char const zeros[4096];
+
+	while (w->pos < offset) {
+		size_t len = sizeof(zeros);
+		if (offset - w->pos < len)
+			len = offset - w->pos;
+		write_data(w, zeros, len);
+	}
+}
+
+
+static unsigned long long align(unsigned long long offset, unsigned int size)
+{
+	return (offset + size - 1) & ~((unsigned long long)size - 1);
+}
+
+
+static void write_ehdr(struct elf_writer * w,
+		       struct elf_target const * target,
+		       unsigned long long shoff, u32 shnum)
+{
+	unsigned char ident[EI_NIDENT];
+
+	memset(ident, 0, sizeof(ident));
+	memcpy(ident, ELFMAG, SELFMAG);
+	ident[EI_CLASS] = w->elf64 ? ELFCLASS64 : ELFCLASS32;
+	ident[EI_DATA] = HOST_ELFDATA;
+	ident[EI_VERSION] = EV_CURRENT;
+	ident[EI_OSABI] = target->osabi;
+
+	if (w->elf64) {
+		Elf64_Ehdr ehdr;
+		memset(&ehdr, 0, sizeof(ehdr));
+		memcpy(ehdr.e_ident, ident, sizeof(ident));
+		ehdr.e_type = ET_REL;
+		ehdr.e_machine = target->machine64;
+		ehdr.e_version = EV_CURRENT;
+		ehdr.e_shoff = shoff;
+		ehdr.e_flags = target->flags;
+		ehdr.e_ehsize = sizeof(ehdr);
+		ehdr.e_shentsize = sizeof(Elf64_Shdr);
+		ehdr.e_shnum = shnum;
+		ehdr.e_shstrndx = shnum - 1;
+		write_data(w, &ehdr, sizeof(ehdr));
+	} else {
+		Elf32_Ehdr ehdr;
+		memset(&ehdr, 0, sizeof(ehdr));
+		memcpy(ehdr.e_ident, ident, sizeof(ident));
+		ehdr.e_type = ET_REL;
+		ehdr.e_machine = target->machine32;
+		ehdr.e_version = EV_CURRENT;
+		ehdr.e_shoff = shoff;
+		ehdr.e_flags = target->flags;
+		ehdr.e_ehsize = sizeof(ehdr);
+		ehdr.e_shentsize = sizeof(Elf32_Shdr);
+		ehdr.e_shnum = shnum;
+		ehdr.e_shstrndx = shnum - 1;
+		write_data(w, &ehdr, sizeof(ehdr));
+	}
+}
+
+
+static void write_shdr(struct elf_writer * w, u32 name, u32 type, u32 flags,
+		       unsigned long long addr, unsigned long long offset,
+		       unsigned long long size, u32 link, u32 info,
+		       u32 addralign, u32 entsize)
+{
+	if (w->elf64) {
+		Elf64_Shdr shdr;
+		shdr.sh_name = name;
+		shdr.sh_type = type;
+		shdr.sh_flags = flags;
+		shdr.sh_addr = addr;
+		shdr.sh_offset = offset;
+		shdr.sh_size = size;
+		shdr.sh_link = link;
+		shdr.sh_info = info;
+		shdr.sh_addralign = addralign;
+		shdr.sh_entsize = entsize;
+		write_data(w, &shdr, sizeof(shdr));
+	} else {
+		Elf32_Shdr shdr;
+		shdr.sh_name = name;
+		shdr.sh_type = type;
+		shdr.sh_flags = flags;
+		shdr.sh_addr = addr;
+		shdr.sh_offset = offset;
+		shdr.sh_size = size;
+		shdr.sh_link = link;
+		shdr.sh_info = info;
+		shdr.sh_addralign = addralign;
+		shdr.sh_entsize = entsize;
+		write_data(w, &shdr, sizeof(shdr));
+	}
+}
+
+
+static void write_sym(struct elf_writer * w, u32 name, unsigned char info,
+		      u32 shndx, unsigned long long value)
+{
+	if (w->elf64) {
+		Elf64_Sym sym;
+		memset(&sym, 0, sizeof(sym));
+		sym.st_name = name;
+		sym.st_info = info;
+		sym.st_shndx = shndx;
+		sym.st_value = value;
+		write_data(w, &sym, sizeof(sym));
+	} else {
+		Elf32_Sym sym;
+		memset(&sym, 0, sizeof(sym));
+		sym.st_name = name;
+		sym.st_info = info;
+		sym.st_shndx = shndx;
+		sym.st_value = value;
+		write_data(w, &sym, sizeof(sym));
+	}
+}
+
+
+/* Copy the code of the functions of the section, the parts without code are
+ * zero filled like bfd does.
+ */
+static void write_text(struct elf_writer * w, struct jitconv_ctx const * ctx,
+		       struct text_section const * section)
+{
+	u32 i;
+
+	for (i = section->first; i <= section->last; i++) {
+		struct jitentry const * e = ctx->entries_address_ascending[i];
+		unsigned long long offset = section->offset +
+			(e->vma - section->vma);
+		unsigned long long end = section->offset + section->size;
+		unsigned long long skip = 0;
+		unsigned long long len = e->code_size;
+
+		if (!e->code)
+			continue;
+		/* resolve_overlaps() leaves none, but don't go backward */
+		if (offset < w->pos)
+			skip = w->pos - offset;
+		if (offset + len > end)
+			len = end - offset;
+		if (skip >= len)
+			continue;
+		write_padding(w, offset + skip);
+		write_data(w, (char const *)e->code + skip, len - skip);
+	}
+	write_padding(w, section->offset + section->size);
+}
+
+
+/* Write the ELF file, create_debug_line_info() must have been called.
+ * elf_target_supported() must be true for the context.
+ */
+int write_elf(struct jitconv_ctx * ctx, char const * filename)
+{
+	struct elf_writer w;
+	struct text_section * sections;
+	struct growable_buffer shstrtab;
+	struct growable_buffer const * dwarf[3];
+	unsigned long long dwarf_offset[3];
+	unsigned long long symtab_offset, strtab_offset, shstrtab_offset;
+	unsigned long long strtab_size, shoff;
+	u32 dwarf_name[3], symtab_name, strtab_name, shstrtab_name;
+	char const * const dwarf_names[3] = {
+		".debug_line", ".debug_info", ".debug_abbrev"
+	};
+	u32 nr_text, shnum, sym_size, word_size, name, i, j;
+	struct elf_target const * target;
+	int rc = OP_JIT_CONV_OK;
+	char * buffer;
+
+	target = elf_target(ctx, &w.elf64);
+	w.pos = 0;
+	word_size = w.elf64 ? 8 : 4;
+	sym_size = w.elf64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+
+	nr_text = partition_text(ctx, NULL);
+	sections = xmalloc(nr_text * sizeof(struct text_section));
+	partition_text(ctx, sections);
+	shnum = 1 + nr_text + NR_OTHER_SECTIONS;
+
+	/* section names */
+	init_buffer(&shstrtab);
+	add_data(&shstrtab, "", 1);
+	for (i = 0; i < nr_text; i++) {
+		char section_name[32];
+		snprintf(section_name, sizeof(section_name), ".text.%u",
+			 sections[i].first);
+		sections[i].name = shstrtab.size;
+		add_data(&shstrtab, section_name, strlen(section_name) + 1);
+	}
+	for (i = 0; i < 3; i++) {
+		dwarf_name[i] = shstrtab.size;
+		add_data(&shstrtab, dwarf_names[i], strlen(dwarf_names[i]) + 1);
+	}
+	symtab_name = shstrtab.size;
+	add_data(&shstrtab, ".symtab", sizeof(".symtab"));
+	strtab_name = shstrtab.size;
+	add_data(&shstrtab, ".strtab", sizeof(".strtab"));
+	shstrtab_name = shstrtab.size;
+	add_data(&shstrtab, ".shstrtab", sizeof(".shstrtab"));
+
+	/* file layout */
+	w.pos = w.elf64 ? sizeof(Elf64_Ehdr) : sizeof(Elf32_Ehdr);
+	for (i = 0; i < nr_text; i++) {
+		sections[i].offset = w.pos;
+		w.pos += sections[i].size;
+		verbprintf(debug, "section .text.%u, vma_start=%llx, "
+			   "size=%llu\n", sections[i].first, sections[i].vma,
+			   sections[i].size);
+	}
+	dwarf[0] = &ctx->b_line;
+	dwarf[1] = &ctx->b_debug_info;
+	dwarf[2] = &ctx->b_debug_abbrev;
+	for (i = 0; i < 3; i++) {
+		dwarf_offset[i] = w.pos;
+		w.pos += dwarf[i]->size;
+	}
+	symtab_offset = align(w.pos, word_size);
+	strtab_offset = symtab_offset + (ctx->entry_count + 1) * sym_size;
+	strtab_size = 1;
+	for (i = 0; i < ctx->entry_count; i++) {
+		struct jitentry const * e = ctx->entries_address_ascending[i];
+		strtab_size += strlen(e->symbol_name) + 1;
+	}
+	shstrtab_offset = strtab_offset + strtab_size;
+	shoff = align(shstrtab_offset + shstrtab.size, word_size);
+
+	w.out = fopen(filename, "w");
+	if (!w.out) {
+		perror("opjitconv: cannot create ELF file");
+		free_buffer(&shstrtab);
+		free(sections);
+		return OP_JIT_CONV_FAIL;
+	}
+	buffer = xmalloc(ELF_BUFFER_SIZE);
+	setvbuf(w.out, buffer, _IOFBF, ELF_BUFFER_SIZE);
+	w.pos = 0;
+	w.error = 0;
+
+	write_ehdr(&w, target, shoff, shnum);
+
+	for (i = 0; i < nr_text; i++)
+		write_text(&w, ctx, &sections[i]);
+
+	for (i = 0; i < 3; i++)
+		write_data(&w, dwarf[i]->p, dwarf[i]->size);
+
+	/* the symbols, in address order, each in the section of its code */
+	write_padding(&w, symtab_offset);
+	write_sym(&w, 0, 0, SHN_UNDEF, 0);
+	name = 1;
+	for (i = 0, j = 0; i < ctx->entry_count; i++) {
+		struct jitentry const * e = ctx->entries_address_ascending[i];
+		if (i > sections[j].last)
+			j++;
+		write_sym(&w, name, ELF32_ST_INFO(STB_GLOBAL, STT_FUNC),
+			  1 + j, e->vma - sections[j].vma);
+		name += strlen(e->symbol_name) + 1;
+	}
+	write_data(&w, "", 1);
+	for (i = 0; i < ctx->entry_count; i++) {
+		char const * symbol_name =
+			ctx->entries_address_ascending[i]->symbol_name;
+		write_data(&w, symbol_name, strlen(symbol_name) + 1);
+	}
+	write_data(&w, shstrtab.p, shstrtab.size);
+
+	write_padding(&w, shoff);
+	write_shdr(&w, 0, SHT_NULL, 0, 0, 0, 0, 0, 0, 0, 0);
+	for (i = 0; i < nr_text; i++)
+		write_shdr(&w, sections[i].name, SHT_PROGBITS,
+			   SHF_ALLOC | SHF_EXECINSTR, sections[i].vma,
+			   sections[i].offset, sections[i].size, 0, 0, 1, 0);
+	for (i = 0; i < 3; i++)
+		write_shdr(&w, dwarf_name[i], SHT_PROGBITS, 0, 0,
+			   dwarf_offset[i], dwarf[i]->size, 0, 0, 1, 0);
+	/* only the null symbol is local */
+	write_shdr(&w, symtab_name, SHT_SYMTAB, 0, 0, symtab_offset,
+		   (ctx->entry_count + 1) * sym_size,
+		   1 + nr_text + SEC_STRTAB, 1, word_size, sym_size);
+	write_shdr(&w, strtab_name, SHT_STRTAB, 0, 0, strtab_offset,
+		   strtab_size, 0, 0, 1, 0);
+	write_shdr(&w, shstrtab_name, SHT_STRTAB, 0, 0, shstrtab_offset,
+		   shstrtab.size, 0, 0, 1, 0);
+
+	errno = 0;
+	if (fclose(w.out) && !w.error)
+		w.error = errno ? errno : EIO;
+	if (w.error) {
+		fprintf(stderr, "opjitconv: cannot write ELF file %s (%s).\n",
+			filename, strerror(w.error));
+		unlink(filename);
+		rc = OP_JIT_CONV_FAIL;
+	}
+
+	free(buffer);
+	free_buffer(&shstrtab);
+	free(sections);
+	return rc;
+}
@@ -434,20 +434,15 @@ static void create_debug_abbrev(struct growable_buffer * b)
 	emit_unsigned_LEB128(b, 0);
 }
 
-static struct growable_buffer b_line;
-static struct growable_buffer b_debug_info;
-static struct growable_buffer b_debug_abbrev;
-
-int init_debug_line_info(bfd * abfd)
+void create_debug_line_info(struct jitconv_ctx * ctx)
 {
-	asection * line_section, * debug_info, * debug_abbrev;
 	struct jitentry_debug_line * debug_line;
 
-	init_buffer(&b_line);
-	init_buffer(&b_debug_info);
-	init_buffer(&b_debug_abbrev);
+	init_buffer(&ctx->b_line);
+	init_buffer(&ctx->b_debug_info);
+	init_buffer(&ctx->b_debug_abbrev);
 
-	for (debug_line = jitentry_debug_line_list;
+	for (debug_line = ctx->jitentry_debug_line_list;
 	     debug_line;
 	     debug_line = debug_line->next) {
 		struct jr_code_debug_info const * rec = debug_line->data;
@@ -466,27 +461,38 @@ int init_debug_line_info(bfd * abfd)
 				data += strlen(data) + 1;
 			}
 
-			add_compilation_unit(&b_debug_info, b_line.size);
-			add_debug_line(&b_line, dbg_line,
+			add_compilation_unit(&ctx->b_debug_info,
+					     ctx->b_line.size);
+			add_debug_line(&ctx->b_line, dbg_line,
 				       rec->nr_entry, rec->code_addr);
-			create_debug_abbrev(&b_debug_abbrev);
+			create_debug_abbrev(&ctx->b_debug_abbrev);
 
 			free(dbg_line);
 		}
 	}
-	
-	line_section = create_section(abfd, ".debug_line", b_line.size, 0,
+}
+
+
+int init_debug_line_info(struct jitconv_ctx * ctx)
+{
+	bfd * abfd = ctx->cur_bfd;
+	asection * line_section, * debug_info, * debug_abbrev;
+
+	create_debug_line_info(ctx);
+
+	line_section = create_section(abfd, ".debug_line", ctx->b_line.size, 0,
 		SEC_HAS_CONTENTS|SEC_READONLY|SEC_DEBUGGING);
 	if (!line_section)
 		return -1;
 
-	debug_info = create_section(abfd, ".debug_info", b_debug_info.size, 0,
+	debug_info = create_section(abfd, ".debug_info",
+		ctx->b_debug_info.size, 0,
 		SEC_HAS_CONTENTS|SEC_READONLY|SEC_DEBUGGING);
  	if (!debug_info)
 		return -1;
 
 	debug_abbrev = create_section(abfd, ".debug_abbrev",
-		b_debug_abbrev.size, 0,
+		ctx->b_debug_abbrev.size, 0,
 		SEC_HAS_CONTENTS|SEC_READONLY|SEC_DEBUGGING);
 	if (!debug_abbrev)
 		return -1;
@@ -495,8 +501,9 @@ int init_debug_line_info(bfd * abfd)
 }
 
 
-int finalize_debug_line_info(bfd * abfd)
+int finalize_debug_line_info(struct jitconv_ctx * ctx)
 {
+	bfd * abfd = ctx->cur_bfd;
 	asection * line_section, * debug_info, * debug_abbrev;
 
 	line_section = bfd_get_section_by_name(abfd, ".debug_line");
@@ -512,16 +519,12 @@ int finalize_debug_line_info(bfd * abfd)
 	if (!debug_abbrev)
 		return -1;
 
-	fill_section_content(abfd, line_section, b_line.p, 0, b_line.size);
-	fill_section_content(abfd, debug_info, b_debug_info.p,
-			     0, b_debug_info.size);
-	fill_section_content(abfd, debug_abbrev, b_debug_abbrev.p, 0,
-			     b_debug_abbrev.size);
-
-
-	free_buffer(&b_line);
-	free_buffer(&b_debug_info);
-	free_buffer(&b_debug_abbrev);
+	fill_section_content(abfd, line_section, ctx->b_line.p, 0,
+			     ctx->b_line.size);
+	fill_section_content(abfd, debug_info, ctx->b_debug_info.p,
+			     0, ctx->b_debug_info.size);
+	fill_section_content(abfd, debug_abbrev, ctx->b_debug_abbrev.p, 0,
+			     ctx->b_debug_abbrev.size);
 
 	return 0;
 }
@@ -30,21 +30,22 @@ typedef int (*compare_symbol)(void const *, void const *);
 
 
 /* count the entries in the jitentry_list */
-static u32 count_entries(void)
+static u32 count_entries(struct jitconv_ctx * ctx)
 {
 	struct jitentry const * entry;
 	u32 cnt = 0;
-	for (entry = jitentry_list; entry; entry = entry->next)
+	for (entry = ctx->jitentry_list; entry; entry = entry->next)
 		cnt++;
 	return cnt;
 }
 
 
-static void fill_entry_array(struct jitentry * entries[])
+static void fill_entry_array(struct jitconv_ctx * ctx,
+			     struct jitentry * entries[])
 {
 	int i = 0;
 	struct jitentry * entry;
-	for (entry = jitentry_list; entry; entry = entry->next)
+	for (entry = ctx->jitentry_list; entry; entry = entry->next)
 		entries[i++] = entry;
 }
 
@@ -52,12 +53,13 @@ static void fill_entry_array(struct jitentry * entries[])
 /* create an array pointing to the jitentry structures which is sorted
  * according to the comparator rule given by parameter compar
  */
-static struct jitentry ** create_sorted_array(compare_symbol compare)
+static struct jitentry ** create_sorted_array(struct jitconv_ctx * ctx,
+					      compare_symbol compare)
 {
 	struct jitentry ** array =
-		xmalloc(sizeof(struct jitentry *) * entry_count);
-	fill_entry_array(array);
-	qsort(array, entry_count, sizeof(struct jitentry *), compare);
+		xmalloc(sizeof(struct jitentry *) * ctx->entry_count);
+	fill_entry_array(ctx, array);
+	qsort(array, ctx->entry_count, sizeof(struct jitentry *), compare);
 	return array;
 }
 
@@ -85,67 +87,71 @@ static int cmp_address(void const * a, void const * b)
 
 
 /* resort address_ascending array */
-static void resort_address(void)
+static void resort_address(struct jitconv_ctx * ctx)
 {
 	u32 i;
 
-	qsort(entries_address_ascending, entry_count,
+	qsort(ctx->entries_address_ascending, ctx->entry_count,
 	      sizeof(struct jitentry *), cmp_address);
 
 	// lower entry_count if entries are invalidated
-	for (i = 0; i < entry_count; ++i) {
-		if (entries_address_ascending[i]->vma)
+	for (i = 0; i < ctx->entry_count; ++i) {
+		if (ctx->entries_address_ascending[i]->vma)
 			break;
 	}
 
 	if (i) {
-		entry_count -= i;
-		memmove(&entries_address_ascending[0],
-			&entries_address_ascending[i],
-			sizeof(struct jitentry *) * entry_count);
+		ctx->entry_count -= i;
+		memmove(&ctx->entries_address_ascending[0],
+			&ctx->entries_address_ascending[i],
+			sizeof(struct jitentry *) * ctx->entry_count);
 	}
 }
 
 
 /* Copy address_ascending array to entries_symbols_ascending and resort it.  */
-static void resort_symbol(void)
+static void resort_symbol(struct jitconv_ctx * ctx)
 {
-	memcpy(entries_symbols_ascending, entries_address_ascending,
-	       sizeof(struct jitentry *) * entry_count);
-	qsort(entries_symbols_ascending, entry_count,
+	memcpy(ctx->entries_symbols_ascending, ctx->entries_address_ascending,
+	       sizeof(struct jitentry *) * ctx->entry_count);
+	qsort(ctx->entries_symbols_ascending, ctx->entry_count,
 	      sizeof(struct jitentry *), cmp_symbolname);
 }
 
 /* allocate, populate and sort the jitentry arrays */
-void create_arrays(void)
+void create_arrays(struct jitconv_ctx * ctx)
 {
-	max_entry_count = entry_count = count_entries();
-	entries_symbols_ascending = create_sorted_array(cmp_symbolname);
-	entries_address_ascending = create_sorted_array(cmp_address);
+	ctx->max_entry_count = ctx->entry_count = count_entries(ctx);
+	ctx->entries_symbols_ascending =
+		create_sorted_array(ctx, cmp_symbolname);
+	ctx->entries_address_ascending =
+		create_sorted_array(ctx, cmp_address);
 }
 
 
 /* add a new create jitentry to the array. mallocs new arrays if space is
  * needed */
-static void insert_entry(struct jitentry * entry)
+static void insert_entry(struct jitconv_ctx * ctx, struct jitentry * entry)
 {
-	if (entry_count == max_entry_count) {
-		if (max_entry_count < UINT32_MAX - 18)
-			max_entry_count += 18;
-		else if (max_entry_count < UINT32_MAX)
-			max_entry_count += 1;
+	if (ctx->entry_count == ctx->max_entry_count) {
+		if (ctx->max_entry_count < UINT32_MAX - 18)
+			ctx->max_entry_count += 18;
+		else if (ctx->max_entry_count < UINT32_MAX)
+			ctx->max_entry_count += 1;
 		else {
 			fprintf(stderr, "Amount of JIT dump file entries is too large.\n");
 			exit(EXIT_FAILURE);
 		}
-		entries_symbols_ascending = (struct jitentry **)
-			xrealloc(entries_symbols_ascending,
-				 sizeof(struct jitentry *) * max_entry_count);
-		entries_address_ascending = (struct jitentry **)
-			xrealloc(entries_address_ascending,
-				 sizeof(struct jitentry *) * max_entry_count);
+		ctx->entries_symbols_ascending = (struct jitentry **)
+			xrealloc(ctx->entries_symbols_ascending,
+				 sizeof(struct jitentry *) *
+				 ctx->max_entry_count);
+		ctx->entries_address_ascending = (struct jitentry **)
+			xrealloc(ctx->entries_address_ascending,
+				 sizeof(struct jitentry *) *
+				 ctx->max_entry_count);
 	}
-	entries_address_ascending[entry_count++] = entry;
+	ctx->entries_address_ascending[ctx->entry_count++] = entry;
 }
 
 
@@ -181,49 +187,50 @@ static void invalidate_entry(struct jitentry * e)
 /*
  * Invalidate all symbols that are not alive at sampling start time.
  */
-static void invalidate_earlybirds(unsigned long long start_time)
+static void invalidate_earlybirds(struct jitconv_ctx * ctx,
+				  unsigned long long start_time)
 {
 	u32 i;
 	int flag;
 	struct jitentry * a;
 
 	flag = 0;
-	for (i = 0; i < entry_count; i++) {
-		a = entries_address_ascending[i];
+	for (i = 0; i < ctx->entry_count; i++) {
+		a = ctx->entries_address_ascending[i];
 		if (a->life_end < start_time) {
 			invalidate_entry(a);
 			flag = 1;
 		}
 	}
 	if (flag) {
-		resort_address();
-		resort_symbol();
+		resort_address(ctx);
+		resort_symbol(ctx);
 	}
 }
 
-static void invalidate_zero_size_entries(void)
+static void invalidate_zero_size_entries(struct jitconv_ctx * ctx)
 {
 	u32 i;
 	int flag;
 	struct jitentry * a;
 
 	flag = 0;
-	for (i = 0; i < entry_count; i++) {
-		a = entries_address_ascending[i];
+	for (i = 0; i < ctx->entry_count; i++) {
+		a = ctx->entries_address_ascending[i];
 		if (a->code_size == 0) {
 			invalidate_entry(a);
 			flag = 1;
 		}
 	}
 	if (flag) {
-		resort_address();
-		resort_symbol();
+		resort_address(ctx);
+		resort_symbol(ctx);
 	}
 }
 
 
 /* select the symbol with the longest life time in the index range */
-static int select_one(int start_idx, int end_idx)
+static int select_one(struct jitconv_ctx * ctx, int start_idx, int end_idx)
 {
 	int i;
 	int candidate = OP_JIT_CONV_FAIL;
@@ -232,7 +239,7 @@ static int select_one(int start_idx, int end_idx)
 	struct jitentry const * e;
 
 	for (i = start_idx; i <= end_idx; i++) {
-		e = entries_address_ascending[i];
+		e = ctx->entries_address_ascending[i];
 		x = e->life_end - e->life_start;
 		if (candidate == -1 || x > lifetime) {
 			candidate = i;
@@ -259,7 +266,8 @@ static int select_one(int start_idx, int end_idx)
  *
  * However, both parts may or may not exist.
  */
-static void split_entry(struct jitentry * split, struct jitentry const * keep)
+static void split_entry(struct jitconv_ctx * ctx, struct jitentry * split,
+			struct jitentry const * keep)
 {
 	unsigned long long start_addr_keep = keep->vma;
 	unsigned long long end_addr_keep = keep->vma + keep->code_size;
@@ -295,7 +303,7 @@ static void split_entry(struct jitentry * split, struct jitentry const * keep)
 			   " end=%llx\n", new_entry->symbol_name,
 			   new_entry->vma,
 			   new_entry->vma + new_entry->code_size);
-		insert_entry(new_entry);
+		insert_entry(ctx, new_entry);
 	}
 	// do we need a left part?
 	if (start_addr_split < start_addr_keep) {
@@ -331,11 +339,12 @@ static void split_entry(struct jitentry * split, struct jitentry const * keep)
  * found to overlap.
  * Returns ULONG_MAX on error.
  */
-static unsigned long long eliminate_overlaps(int start_idx, int end_idx,
-					 int keep_idx)
+static unsigned long long eliminate_overlaps(struct jitconv_ctx * ctx,
+					     int start_idx, int end_idx,
+					     int keep_idx)
 {
 	unsigned long long retval;
-	struct jitentry const * keep = entries_address_ascending[keep_idx];
+	struct jitentry const * keep = ctx->entries_address_ascending[keep_idx];
 	struct jitentry * e;
 	unsigned long long start_addr_keep = keep->vma;
 	unsigned long long end_addr_keep = keep->vma + keep->code_size;
@@ -347,7 +356,7 @@ static unsigned long long eliminate_overlaps(int start_idx, int end_idx,
 	for (i = start_idx; i <= end_idx; i++) {
 		if (i == keep_idx)
 			continue;
-		e = entries_address_ascending[i];
+		e = ctx->entries_address_ascending[i];
 		start_addr_entry = e->vma;
 		end_addr_entry = e->vma + e->code_size;
 		if (debug) {
@@ -372,7 +381,7 @@ static unsigned long long eliminate_overlaps(int start_idx, int end_idx,
 				min_start = e->life_start;
 			if (e->life_end > max_end)
 				max_end = e->life_end;
-			split_entry(e, keep);
+			split_entry(ctx, e, keep);
 		}
 	}
 	retval = max_end - min_start;
@@ -386,7 +395,8 @@ out:
  * symbol with the maximal lifetime and split/truncate all symbols that overlap
  * with it (i.e. that there won't be any overlaps anymore).
  */
-static int handle_overlap_region(int start_idx, int end_idx)
+static int handle_overlap_region(struct jitconv_ctx * ctx, int start_idx,
+				 int end_idx)
 {
 	int rc = OP_JIT_CONV_OK;
 	int idx;
@@ -398,7 +408,7 @@ static int handle_overlap_region(int start_idx, int end_idx)
 
 	if (debug) {
 		for (i = start_idx; i <= end_idx; i++) {
-			e = entries_address_ascending[i];
+			e = ctx->entries_address_ascending[i];
 			verbprintf(debug, "overlap idx=%i, name=%s, "
 				   "start=%llx, end=%llx, life_start=%lli, "
 				   "life_end=%lli, lifetime=%lli\n",
@@ -407,18 +417,18 @@ static int handle_overlap_region(int start_idx, int end_idx)
 				   e->life_end, e->life_end - e->life_start);
 		}
 	}
-	idx = select_one(start_idx, end_idx);
+	idx = select_one(ctx, start_idx, end_idx);
 	// This can't happen, but we check anyway, just to silence Coverity
 	if (idx == OP_JIT_CONV_FAIL) {
 		rc = OP_JIT_CONV_FAIL;
 		goto out;
 	}
-	totaltime = eliminate_overlaps(start_idx, end_idx, idx);
+	totaltime = eliminate_overlaps(ctx, start_idx, end_idx, idx);
 	if (totaltime == ULONG_MAX) {
 		rc = OP_JIT_CONV_FAIL;
 		goto out;
 	}
-	e = entries_address_ascending[idx];
+	e = ctx->entries_address_ascending[idx];
 	pct = (totaltime == 0) ? 100 : (e->life_end - e->life_start) * 100 / totaltime;
 
 	cnt = 1;
@@ -448,7 +458,7 @@ out:
  * The index range of symbols found to overlap are passed to
  * handle_overlap_region.
  */
-static int scan_overlaps(void)
+static int scan_overlaps(struct jitconv_ctx * ctx)
 {
 	int i, j;
 	unsigned long long end_addr, end_addr2;
@@ -456,9 +466,9 @@ static int scan_overlaps(void)
 	int flag = 0;
 	// entry_count can be incremented by split_entry() during the loop,
 	// save the inital value as loop count
-	int loop_count = entry_count;
+	int loop_count = ctx->entry_count;
 
-	verbprintf(debug,"count=%i, scan overlaps...\n", entry_count);
+	verbprintf(debug,"count=%i, scan overlaps...\n", ctx->entry_count);
 	i = 0;
 	end_addr = 0;
 	for (j = 1; j < loop_count; j++) {
@@ -489,14 +499,14 @@ static int scan_overlaps(void)
 		 * sym3 would not overlap with sym1. Therefore handle_overlap_regio() would
 		 * only be called for sym1 up to sym2.
 		 */
-		a = entries_address_ascending[j - 1];
+		a = ctx->entries_address_ascending[j - 1];
 		end_addr2 = a->vma + a->code_size;
 		if (end_addr2 > end_addr)
 			end_addr = end_addr2;
-		a = entries_address_ascending[j];
+		a = ctx->entries_address_ascending[j];
 		if (end_addr <= a->vma) {
 			if (i != j - 1) {
-				if (handle_overlap_region(i, j - 1) ==
+				if (handle_overlap_region(ctx, i, j - 1) ==
 				    OP_JIT_CONV_FAIL) {
 					flag = OP_JIT_CONV_FAIL;
 					goto out;
@@ -507,7 +517,7 @@ static int scan_overlaps(void)
 		}
 	}
 	if (i != j - 1) {
-		if (handle_overlap_region(i, j - 1) == OP_JIT_CONV_FAIL)
+		if (handle_overlap_region(ctx, i, j - 1) == OP_JIT_CONV_FAIL)
 			flag = OP_JIT_CONV_FAIL;
 		else
 			flag = 1;
@@ -519,15 +529,15 @@ out:
 
 /* search for symbols that have overlapping address ranges and decide for
  * one */
-int resolve_overlaps(unsigned long long start_time)
+int resolve_overlaps(struct jitconv_ctx * ctx, unsigned long long start_time)
 {
 	int rc = OP_JIT_CONV_OK;
 	int cnt = 0;
 
-	invalidate_earlybirds(start_time);
-	invalidate_zero_size_entries();
-	while ((rc = scan_overlaps()) && rc != OP_JIT_CONV_FAIL) {
-		resort_address();
+	invalidate_earlybirds(ctx, start_time);
+	invalidate_zero_size_entries(ctx);
+	while ((rc = scan_overlaps(ctx)) && rc != OP_JIT_CONV_FAIL) {
+		resort_address(ctx);
 		if (cnt == 0) {
 			verbprintf(debug, "WARNING: overlaps detected. "
 				   "Removing overlapping JIT methods\n");
@@ -535,7 +545,7 @@ int resolve_overlaps(unsigned long long start_time)
 		cnt++;
 	}
 	if (cnt > 0 && rc != OP_JIT_CONV_FAIL)
-		resort_symbol();
+		resort_symbol(ctx);
 	return rc;
 }
 
@@ -544,7 +554,7 @@ int resolve_overlaps(unsigned long long start_time)
  * scan through the sorted array and replace identical symbol names by unique
  * ones by adding a counter value.
  */
-void disambiguate_symbol_names(void)
+void disambiguate_symbol_names(struct jitconv_ctx * ctx)
 {
 	u32 j;
 	int cnt, rep_cnt;
@@ -552,11 +562,11 @@ void disambiguate_symbol_names(void)
 	struct jitentry * b;
 
 	rep_cnt = 0;
-	for (j = 1; j < entry_count; j++) {
-		a = entries_symbols_ascending[j - 1];
+	for (j = 1; j < ctx->entry_count; j++) {
+		a = ctx->entries_symbols_ascending[j - 1];
 		cnt = 1;
 		do {
-			b = entries_symbols_ascending[j];
+			b = ctx->entries_symbols_ascending[j];
 			if (strcmp(a->symbol_name, b->symbol_name) == 0) {
 				if (b->sym_name_malloced)
 					free(b->symbol_name);
@@ -569,12 +579,12 @@ void disambiguate_symbol_names(void)
 			} else {
 				break;
 			}
-		} while (j < entry_count);
+		} while (j < ctx->entry_count);
 	}
 	/* recurse to avoid that the added suffix also creates a collision */
 	if (rep_cnt) {
-		qsort(entries_symbols_ascending, entry_count,
+		qsort(ctx->entries_symbols_ascending, ctx->entry_count,
 		      sizeof(struct jitentry *), cmp_symbolname);
-		disambiguate_symbol_names();
+		disambiguate_symbol_names(ctx);
 	}
 }
@@ -36,40 +36,11 @@
 #include <wait.h>
 #include <sys/file.h>
 
-/*
- * list head.  The linked list is used during parsing (parse_all) to
- * hold all jitentry elements. After parsing, the program works on the
- * array structures (entries_symbols_ascending, entries_address_ascending)
- * and the linked list is not used any more.
- */
-struct jitentry * jitentry_list = NULL;
-struct jitentry_debug_line * jitentry_debug_line_list = NULL;
-
-/* Global variable for asymbols so we can free the storage later. */
-asymbol ** syms;
-
-/* jit dump header information */
-enum bfd_architecture dump_bfd_arch;
-int dump_bfd_mach;
-char const * dump_bfd_target_name;
-
 /* user information for special user 'oprofile' */
 struct passwd * pw_oprofile;
 
 char sys_cmd_buffer[PATH_MAX + 1];
 
-/* the bfd handle of the ELF file we write */
-bfd * cur_bfd;
-
-/* count of jitentries in the list */
-u32 entry_count;
-/* maximul space in the entry arrays, needed to add entries */
-u32 max_entry_count;
-/* array pointing to all jit entries, sorted by symbol names */
-struct jitentry ** entries_symbols_ascending;
-/* array pointing to all jit entries sorted by address */
-struct jitentry ** entries_address_ascending;
-
 /* debug flag, print some information */
 int debug;
 /* indicates opjitconv invoked by non-root user via operf */
@@ -78,16 +49,19 @@ int non_root;
 int delete_jitdumps;
 /* Session directory where sample data is stored */
 char * session_dir;
+/* maximum number of dump files converted at once */
+long nr_jobs;
 
 static struct option long_options [] = {
                                         { "session-dir", required_argument, NULL, 's'},
                                         { "debug", no_argument, NULL, 'd'},
                                         { "delete-jitdumps", no_argument, NULL, 'j'},
                                         { "non-root", no_argument, NULL, 'n'},
+                                        { "jobs", required_argument, NULL, 'J'},
                                         { "help", no_argument, NULL, 'h'},
                                         { NULL, 9, NULL, 0}
 };
-const char * short_options = "s:djnh";
+const char * short_options = "s:djnJ:h";
 
 LIST_HEAD(jitdump_deletion_candidates);
 
@@ -96,7 +70,7 @@ LIST_HEAD(jitdump_deletion_candidates);
  *    From main(), the general flow is as follows:
  *      1. Find all anonymous samples directories
  *      2. Find all JIT dump files
- *      3. For each JIT dump file:
+ *      3. For each JIT dump file, in up to nr_jobs child processes at once:
  *        3.1 Find matching anon samples dir (from list retrieved in step 1)
  *        3.2 mmap the JIT dump file
  *        3.3 Call op_jit_convert to create ELF file if necessary
@@ -582,6 +556,117 @@ static void _add_jitdumps_to_deletion_list(void * all_jitdumps, char const * jit
 	}
 }
 
+/* Wait for one of the workers started by process_jit_dumpfiles_parallel()
+ * and store its result. Return the index of the dump file it converted.
+ */
+static int wait_for_worker(pid_t const * workers, int * results, int nr_files)
+{
+	int status, i;
+	pid_t pid;
+
+	do {
+		pid = waitpid(-1, &status, 0);
+	} while (pid < 0 && errno == EINTR);
+
+	for (i = 0; i < nr_files; i++) {
+		if (workers[i] == pid && pid > 0)
+			break;
+	}
+	if (i == nr_files) {
+		perror("opjitconv: waitpid for conversion worker failed");
+		return -1;
+	}
+
+	if (WIFEXITED(status))
+		results[i] = WEXITSTATUS(status) + OP_JIT_CONV_FAIL;
+	else
+		results[i] = OP_JIT_CONV_FAIL;
+	return i;
+}
+
+
+/* Convert the dump files with up to nr_jobs child processes at once, one
+ * dump file per child. A conversion changes the effective user and goes
+ * through libbfd, which is not thread safe, so the workers are processes.
+ * Each dump file is converted to its own ELF file, as in a serial run.
+ * Like the serial loop, stop at the first failure, else return the result
+ * of the last dump file.
+ */
+static int process_jit_dumpfiles_parallel(struct list_head * jd_fnames,
+					  char const * jitdump_dir,
+					  struct list_head * anon_dnames,
+					  unsigned long long start_time,
+					  unsigned long long end_time,
+					  char * tmp_conv_dir)
+{
+	char jitdumpfile[PATH_MAX + 1];
+	struct list_head * pos;
+	pid_t * workers;
+	int * results;
+	int nr_files = 0, nr_started = 0, nr_running = 0, failed = 0;
+	int rc, i;
+
+	list_for_each(pos, jd_fnames)
+		nr_files++;
+	workers = xcalloc(nr_files, sizeof(pid_t));
+	results = xcalloc(nr_files, sizeof(int));
+
+	list_for_each(pos, jd_fnames) {
+		struct pathname * dmpfile =
+			list_entry(pos, struct pathname, neighbor);
+		pid_t pid;
+
+		if (nr_running == nr_jobs) {
+			i = wait_for_worker(workers, results, nr_files);
+			nr_running--;
+			if (i < 0 || results[i] == OP_JIT_CONV_FAIL)
+				failed = 1;
+		}
+		if (failed)
+			break;
+
+		snprintf(jitdumpfile, PATH_MAX, "%s%s",
+			 jitdump_dir, dmpfile->name);
+		jitdumpfile[PATH_MAX] = '\0';
+		/* don't let the child flush our buffered output again */
+		fflush(stdout);
+		pid = fork();
+		if (pid == 0) {
+			rc = process_jit_dumpfile(jitdumpfile, anon_dnames,
+						  start_time, end_time,
+						  tmp_conv_dir);
+			fflush(stdout);
+			_exit(rc - OP_JIT_CONV_FAIL);
+		}
+		if (pid < 0) {
+			/* no more workers, convert it ourselves */
+			results[nr_started] = process_jit_dumpfile(jitdumpfile,
+				anon_dnames, start_time, end_time, tmp_conv_dir);
+			if (results[nr_started] == OP_JIT_CONV_FAIL)
+				failed = 1;
+		} else {
+			workers[nr_started] = pid;
+			nr_running++;
+		}
+		nr_started++;
+	}
+
+	while (nr_running) {
+		i = wait_for_worker(workers, results, nr_files);
+		nr_running--;
+		if (i < 0 || results[i] == OP_JIT_CONV_FAIL)
+			failed = 1;
+	}
+
+	rc = failed ? OP_JIT_CONV_FAIL : results[nr_files - 1];
+	if (failed)
+		verbprintf(debug, "JIT convert error %d\n", rc);
+	free(workers);
+	free(results);
+	return rc;
+}
+
+
 static int op_process_jit_dumpfiles(char const * session_dir,
 	unsigned long long start_time, unsigned long long end_time)
 {
@@ -704,6 +789,17 @@ static int op_process_jit_dumpfiles(char const * session_dir,
 	 * NO_RECURSION is passed, so below, we add back the JIT
 	 * dump directory path to the name.
 	 */
+	if (nr_jobs > 1) {
+		rc = process_jit_dumpfiles_parallel(&jd_fnames, jitdump_dir,
+						    &anon_dnames, start_time,
+						    end_time, tmp_conv_dir);
+		if (rc != OP_JIT_CONV_FAIL) {
+			delete_path_names_list(&jd_fnames);
+			delete_path_names_list(&anon_dnames);
+		}
+		goto rm_tmp;
+	}
+
 	list_for_each_safe(pos1, pos2, &jd_fnames) {
 		struct pathname * dmpfile =
 			list_entry(pos1, struct pathname, neighbor);
@@ -818,7 +914,7 @@ static void _cleanup_jitdumps(void)
 
 static void __print_usage(void)
 {
-	fprintf(stderr, "usage: opjitconv [--debug | --non-root | --delete-jitdumps ] --session-dir=<dir> <starttime> <endtime>\n");
+	fprintf(stderr, "usage: opjitconv [--debug | --non-root | --delete-jitdumps | --jobs=<n> ] --session-dir=<dir> <starttime> <endtime>\n");
 }
 
 static int _process_args(int argc, char * const argv[])
@@ -854,6 +950,15 @@ static int _process_args(int argc, char * const argv[])
 		case 'j':
 			delete_jitdumps = 1;
 			break;
+		case 'J':
+			nr_jobs = atol(optarg);
+			if (nr_jobs < 1) {
+				printf("opjitconv: invalid --jobs value %s\n",
+				       optarg);
+				keep_trying = 0;
+				idx_of_non_options = -1;
+			}
+			break;
 		case 'h':
 			break;
 		default:
@@ -878,6 +983,9 @@ int main(int argc, char * const argv[])
 	non_root = 0;
 	delete_jitdumps = 0;
 	session_dir = NULL;
+	nr_jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nr_jobs < 1)
+		nr_jobs = 1;
 	non_options_idx = _process_args(argc, argv);
 	// We need the session_dir and two non-option values passed -- starttime and endtime.
 	if (!session_dir || (non_options_idx != argc - 2)) {
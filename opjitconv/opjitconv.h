@@ -33,6 +33,7 @@
 
 #include "op_list.h"
 #include "op_types.h"
+#include "op_growable_buffer.h"
 
 #define verbprintf(x, args...) \
         do { \
@@ -97,57 +98,75 @@ struct jitdump_deletion_candidate
 	struct list_head neighbor;
 };
 
+/* The state of the conversion of one jit dump file. Conversions of
+ * different dump files share nothing, so they can run concurrently. */
+struct jitconv_ctx {
+	/* jit dump header information */
+	enum bfd_architecture dump_bfd_arch;
+	int dump_bfd_mach;
+	char const * dump_bfd_target_name;
+	/*
+	 * list head.  The linked list is used during parsing (parse_all) to
+	 * hold all jitentry elements. After parsing, the program works on the
+	 * array structures (entries_symbols_ascending,
+	 * entries_address_ascending) and the linked list is not used any more.
+	 */
+	struct jitentry * jitentry_list;
+	/* count of jitentries in the list */
+	u32 entry_count;
+	/* list head for debug line information */
+	struct jitentry_debug_line * jitentry_debug_line_list;
+	/* maximum space in the entry arrays, needed to add entries */
+	u32 max_entry_count;
+	/* array pointing to all jit entries, sorted by symbol names */
+	struct jitentry ** entries_symbols_ascending;
+	/* array pointing to all jit entries sorted by address */
+	struct jitentry ** entries_address_ascending;
+	/* asymbols of the ELF file so we can free the storage later. */
+	asymbol ** syms;
+	/* the bfd handle of the ELF file we write */
+	bfd * cur_bfd;
+	/* DWARF sections built from the debug line information */
+	struct growable_buffer b_line;
+	struct growable_buffer b_debug_info;
+	struct growable_buffer b_debug_abbrev;
+};
+
 /* jitsymbol.c */
-void create_arrays(void);
-int resolve_overlaps(unsigned long long start_time);
-void disambiguate_symbol_names(void);
+void create_arrays(struct jitconv_ctx * ctx);
+int resolve_overlaps(struct jitconv_ctx * ctx, unsigned long long start_time);
+void disambiguate_symbol_names(struct jitconv_ctx * ctx);
 
 /* parse_dump.c */
-int parse_all(void const * start, void const * end,
+int parse_all(struct jitconv_ctx * ctx, void const * start, void const * end,
 	      unsigned long long end_time);
 
 /* conversion.c */
 int op_jit_convert(struct op_jitdump_info *file_info, char const * elffile,
                    unsigned long long start_time, unsigned long long end_time);
+/* as op_jit_convert() but always through libbfd, to test write_elf() */
+int op_jit_convert_libbfd(struct op_jitdump_info * file_info,
+                          char const * elffile, unsigned long long start_time,
+                          unsigned long long end_time);
 
 /* create_bfd.c */
-bfd * open_elf(char const * filename);
-int partition_sections(void);
-int fill_sections(void);
+bfd * open_elf(struct jitconv_ctx * ctx, char const * filename);
+int partition_sections(struct jitconv_ctx * ctx);
+int fill_sections(struct jitconv_ctx * ctx);
 asection * create_section(bfd * abfd, char const * section_name,
 			  size_t size, bfd_vma vma, flagword flags);
 int fill_section_content(bfd * abfd, asection * section,
 			 void const * b, file_ptr offset, size_t sz);
 
+/* create_elf.c */
+int elf_target_supported(struct jitconv_ctx const * ctx);
+int write_elf(struct jitconv_ctx * ctx, char const * filename);
+
 /* debug_line.c */
-int init_debug_line_info(bfd * abfd);
-int finalize_debug_line_info(bfd * abfd);
-
-/* jit dump header information */
-extern enum bfd_architecture dump_bfd_arch;
-extern int dump_bfd_mach;
-extern char const * dump_bfd_target_name;
-/*
- * list head.  The linked list is used during parsing (parse_all) to
- * hold all jitentry elements. After parsing, the program works on the
- * array structures (entries_symbols_ascending, entries_address_ascending)
- * and the linked list is not used any more.
- */
-extern struct jitentry * jitentry_list;
-/* count of jitentries in the list */
-extern u32 entry_count;
-/* list head for debug line information */
-extern struct jitentry_debug_line * jitentry_debug_line_list;
-/* maximum space in the entry arrays, needed to add entries */
-extern u32 max_entry_count;
-/* array pointing to all jit entries, sorted by symbol names */
-extern struct jitentry ** entries_symbols_ascending;
-/* array pointing to all jit entries sorted by address */
-extern struct jitentry ** entries_address_ascending;
-/* Global variable for asymbols so we can free the storage later. */
-extern asymbol ** syms;
-/* the bfd handle of the ELF file we write */
-extern bfd * cur_bfd;
+void create_debug_line_info(struct jitconv_ctx * ctx);
+int init_debug_line_info(struct jitconv_ctx * ctx);
+int finalize_debug_line_info(struct jitconv_ctx * ctx);
+
 /* debug flag, print some information */
 extern int debug;
 
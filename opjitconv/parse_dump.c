@@ -22,8 +22,8 @@
 #include <stdio.h>
 
 /* parse a code load record and add the entry to the jitentry list */
-static int parse_code_load(void const * ptr_arg, int size,
-			   unsigned long long end_time)
+static int parse_code_load(struct jitconv_ctx * ctx, void const * ptr_arg,
+			   int size, unsigned long long end_time)
 {
 	struct jitentry * entry;
 	int rc = OP_JIT_CONV_OK;
@@ -53,8 +53,8 @@ static int parse_code_load(void const * ptr_arg, int size,
 	entry->life_end = end_time;
 
 	// build list
-	entry->next = jitentry_list;
-	jitentry_list = entry;
+	entry->next = ctx->jitentry_list;
+	ctx->jitentry_list = entry;
 
 	/* padding bytes are calculated over the complete record
 	 * (i.e. header + symbol name + code)
@@ -82,7 +82,8 @@ static int parse_code_load(void const * ptr_arg, int size,
  * address and fill life_end field with the timestamp. linear search not very
  * efficient. FIXME: inefficient
  */
-static void parse_code_unload(void const * ptr, unsigned long long end_time)
+static void parse_code_unload(struct jitconv_ctx * ctx, void const * ptr,
+			      unsigned long long end_time)
 {
 	struct jr_code_unload const * rec = ptr;
 	struct jitentry * entry;
@@ -96,7 +97,7 @@ static void parse_code_unload(void const * ptr, unsigned long long end_time)
 	 * it could be zero or not. Therefore it is only a sanity check at the moment.
 	 */
 	if (rec->timestamp > 0 && rec->vma != 0) {
-		for (entry = jitentry_list; entry; entry = entry->next) {
+		for (entry = ctx->jitentry_list; entry; entry = entry->next) {
 			if (entry->vma == rec->vma &&
 			    entry->life_end == end_time) {
 				entry->life_end = rec->timestamp;
@@ -112,8 +113,8 @@ static void parse_code_unload(void const * ptr, unsigned long long end_time)
  * There is no real parsing here, we just record a pointer to the data,
  * we will interpret on the fly the record when building the bfd file.
  */
-static void parse_code_debug_info(void const * ptr, void const * end,
-				  unsigned long long end_time)
+static void parse_code_debug_info(struct jitconv_ctx * ctx, void const * ptr,
+				  void const * end, unsigned long long end_time)
 {
 	struct jr_code_debug_info const * rec = ptr;
 	struct jitentry_debug_line * debug_line =
@@ -124,8 +125,8 @@ static void parse_code_debug_info(void const * ptr, void const * end,
 	debug_line->life_start = rec->timestamp;
 	debug_line->life_end = end_time;
 
-	debug_line->next = jitentry_debug_line_list;
-	jitentry_debug_line_list = debug_line;
+	debug_line->next = ctx->jitentry_debug_line_list;
+	ctx->jitentry_debug_line_list = debug_line;
 }
 
 
@@ -133,8 +134,8 @@ static void parse_code_debug_info(void const * ptr, void const * end,
  * the code needs to check always whether there is enough
  * to read remaining. this is because the file may be written to
  * concurrently. */
-static int parse_entries(void const * ptr, void const * end,
-			 unsigned long long end_time)
+static int parse_entries(struct jitconv_ctx * ctx, void const * ptr,
+			 void const * end, unsigned long long end_time)
 {
 	int rc = OP_JIT_CONV_OK;
 	struct jr_prefix const * rec = ptr;
@@ -148,14 +149,15 @@ static int parse_entries(void const * ptr, void const * end,
 
 		switch (rec->id) {
 		case JIT_CODE_LOAD:
-			if (parse_code_load(rec, rec->total_size, end_time)) {
+			if (parse_code_load(ctx, rec, rec->total_size,
+					    end_time)) {
 				rc = OP_JIT_CONV_FAIL;
 				break;
 			}
 			break;
 
 		case JIT_CODE_UNLOAD:
-			parse_code_unload(rec, end_time);
+			parse_code_unload(ctx, rec, end_time);
 			break;
 
 		// end of VM live time, no action
@@ -171,7 +173,7 @@ static int parse_entries(void const * ptr, void const * end,
 				break;
 			}
 
-			parse_code_debug_info(rec, end, end_time);
+			parse_code_debug_info(ctx, rec, end, end_time);
 			break;
 
 		default:
@@ -192,7 +194,8 @@ static int parse_entries(void const * ptr, void const * end,
  * The ptr arg is the address of the pointer to the mmapped
  * file, which we modify below.
  */
-static int parse_header(char const ** ptr, char const * end)
+static int parse_header(struct jitconv_ctx * ctx, char const ** ptr,
+			char const * end)
 {
 	int rc = OP_JIT_CONV_OK;
 	struct jitheader const * header;
@@ -220,12 +223,12 @@ static int parse_header(char const ** ptr, char const * end)
 		rc = OP_JIT_CONV_FAIL;
 		goto out;
 	}
-	dump_bfd_arch = header->bfd_arch;
-	dump_bfd_mach = header->bfd_mach;
-	dump_bfd_target_name = header->bfd_target;
+	ctx->dump_bfd_arch = header->bfd_arch;
+	ctx->dump_bfd_mach = header->bfd_mach;
+	ctx->dump_bfd_target_name = header->bfd_target;
 	verbprintf(debug, "header: bfd-arch=%i, bfd-mach=%i,"
-		   " bfd_target_name=%s\n", dump_bfd_arch, dump_bfd_mach,
-		   dump_bfd_target_name);
+		   " bfd_target_name=%s\n", ctx->dump_bfd_arch,
+		   ctx->dump_bfd_mach, ctx->dump_bfd_target_name);
 	*ptr = *ptr + header->totalsize;
 out:
 	return rc;
@@ -233,14 +236,14 @@ out:
 
 
 /* Read in the memory mapped jitdump file.
- * Build up jitentry structure and set global variables.
+ * Build up jitentry structure and fill the conversion context.
 */
-int parse_all(void const * start, void const * end,
+int parse_all(struct jitconv_ctx * ctx, void const * start, void const * end,
 	      unsigned long long end_time)
 {
 	char const * ptr = start;
-	if (!parse_header(&ptr, end))
-		return parse_entries(ptr, end, end_time);
+	if (!parse_header(ctx, &ptr, end))
+		return parse_entries(ctx, ptr, end, end_time);
 	else
 		return OP_JIT_CONV_FAIL;
 }
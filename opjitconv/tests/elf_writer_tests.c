@@ -0,0 +1,391 @@
+/**
+ * @file elf_writer_tests.c
+ * Check that write_elf() writes the ELF file libbfd does
+ *
+ * A small synthetic dump is converted by op_jit_convert(), through the
+ * direct writer, and by op_jit_convert_libbfd(). Both files must have the
+ * same ELF header class, data, OS ABI, machine and flags, the same PROGBITS
+ * sections (name, flags, address, size and contents) and the same function
+ * symbols (name, binding, section and value) in the same order.
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <elf.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "opjitconv.h"
+#include "op_libiberty.h"
+#include "jitdump_builder.h"
+
+#define DIRECT_FILENAME "elf-writer-direct.jo"
+#define LIBBFD_FILENAME "elf-writer-libbfd.jo"
+
+/* the test dump is for the host, write_elf() must know its target */
+#if defined(__x86_64__)
+#define TARGET "elf64-x86-64", bfd_arch_i386, bfd_mach_x86_64
+#elif defined(__i386__)
+#define TARGET "elf32-i386", bfd_arch_i386, bfd_mach_i386_i386
+#elif defined(__aarch64__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define TARGET "elf64-littleaarch64", bfd_arch_aarch64, bfd_mach_aarch64
+#elif defined(__powerpc64__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define TARGET "elf64-powerpcle", bfd_arch_powerpc, bfd_mach_ppc64
+#endif
+
+/* automake's exit status of a skipped test */
+#define EXIT_SKIP 77
+
+int debug;
+
+/* an ELF file read in memory */
+struct elf_file {
+	char const * filename;
+	unsigned char * data;
+	size_t size;
+	int elf64;
+	unsigned int shnum;
+};
+
+/* the fields of a section header or symbol we compare, of either class */
+struct section {
+	char const * name;
+	u32 type;
+	unsigned long long flags;
+	unsigned long long addr;
+	unsigned long long offset;
+	unsigned long long size;
+	u32 link;
+	unsigned long long entsize;
+};
+
+struct symbol {
+	char const * name;
+	unsigned char info;
+	char const * section;
+	unsigned long long value;
+};
+
+
+static void fail(struct elf_file const * file, char const * what)
+{
+	fprintf(stderr, "%s: %s\n", file->filename, what);
+	unlink(DIRECT_FILENAME);
+	unlink(LIBBFD_FILENAME);
+	exit(EXIT_FAILURE);
+}
+
+
+static void check_range(struct elf_file const * file,
+                        unsigned long long offset, unsigned long long size)
+{
+	if (offset > file->size || size > file->size - offset)
+		fail(file, "offset out of the file");
+}
+
+
+static void read_elf(struct elf_file * file, char const * filename)
+{
+	FILE * in = fopen(filename, "r");
+	long size;
+	Elf64_Ehdr const * ehdr;
+
+	file->filename = filename;
+	if (!in || fseek(in, 0, SEEK_END) || (size = ftell(in)) < 0)
+		fail(file, "cannot read the file");
+	file->size = size;
+	file->data = xmalloc(file->size + 1);
+	rewind(in);
+	if (fread(file->data, 1, file->size, in) != file->size)
+		fail(file, "cannot read the file");
+	fclose(in);
+
+	/* e_ident and e_type are at the same offsets in both classes */
+	ehdr = (Elf64_Ehdr const *)file->data;
+	if (file->size < sizeof(Elf32_Ehdr) ||
+	    memcmp(ehdr->e_ident, ELFMAG, SELFMAG))
+		fail(file, "not an ELF file");
+	file->elf64 = ehdr->e_ident[EI_CLASS] == ELFCLASS64;
+	if (ehdr->e_type != ET_REL)
+		fail(file, "not a relocatable file");
+	if (file->elf64) {
+		check_range(file, 0, sizeof(Elf64_Ehdr));
+		file->shnum = ehdr->e_shnum;
+		check_range(file, ehdr->e_shoff,
+		            file->shnum * sizeof(Elf64_Shdr));
+	} else {
+		Elf32_Ehdr const * ehdr32 = (Elf32_Ehdr const *)file->data;
+		file->shnum = ehdr32->e_shnum;
+		check_range(file, ehdr32->e_shoff,
+		            file->shnum * sizeof(Elf32_Shdr));
+	}
+}
+
+
+static u32 shstrndx(struct elf_file const * file)
+{
+	if (file->elf64)
+		return ((Elf64_Ehdr const *)file->data)->e_shstrndx;
+	return ((Elf32_Ehdr const *)file->data)->e_shstrndx;
+}
+
+
+/* section header i, without its name, whose offset is returned in *name */
+static void get_section_header(struct elf_file const * file, u32 i,
+                               struct section * section, u32 * name)
+{
+	if (i >= file->shnum)
+		fail(file, "section index out of range");
+	if (file->elf64) {
+		Elf64_Ehdr const * ehdr = (Elf64_Ehdr const *)file->data;
+		Elf64_Shdr const * shdr =
+			(Elf64_Shdr const *)(file->data + ehdr->e_shoff) + i;
+		*name = shdr->sh_name;
+		section->type = shdr->sh_type;
+		section->flags = shdr->sh_flags;
+		section->addr = shdr->sh_addr;
+		section->offset = shdr->sh_offset;
+		section->size = shdr->sh_size;
+		section->link = shdr->sh_link;
+		section->entsize = shdr->sh_entsize;
+	} else {
+		Elf32_Ehdr const * ehdr = (Elf32_Ehdr const *)file->data;
+		Elf32_Shdr const * shdr =
+			(Elf32_Shdr const *)(file->data + ehdr->e_shoff) + i;
+		*name = shdr->sh_name;
+		section->type = shdr->sh_type;
+		section->flags = shdr->sh_flags;
+		section->addr = shdr->sh_addr;
+		section->offset = shdr->sh_offset;
+		section->size = shdr->sh_size;
+		section->link = shdr->sh_link;
+		section->entsize = shdr->sh_entsize;
+	}
+	if (section->type != SHT_NOBITS)
+		check_range(file, section->offset, section->size);
+}
+
+
+/* the nul terminated string at offset in the string table section strtab */
+static char const * string_at(struct elf_file const * file, u32 strtab,
+                              u32 offset)
+{
+	struct section section;
+	char const * s;
+	u32 name;
+
+	get_section_header(file, strtab, &section, &name);
+	if (section.type != SHT_STRTAB || offset >= section.size)
+		fail(file, "bad string table");
+	s = (char const *)file->data + section.offset;
+	if (!memchr(s + offset, 0, section.size - offset))
+		fail(file, "unterminated string");
+	return s + offset;
+}
+
+
+static void get_section(struct elf_file const * file, u32 i,
+                        struct section * section)
+{
+	u32 name;
+
+	get_section_header(file, i, section, &name);
+	section->name = i ? string_at(file, shstrndx(file), name) : "";
+}
+
+
+static int find_section(struct elf_file const * file, char const * name,
+                        struct section * section)
+{
+	u32 i;
+
+	for (i = 1; i < file->shnum; i++) {
+		get_section(file, i, section);
+		if (!strcmp(section->name, name))
+			return 1;
+	}
+	return 0;
+}
+
+
+/* Return the STT_FUNC symbols of the file in *symbols. libbfd can add
+ * section symbols, which write_elf() doesn't have, so we skip the others.
+ */
+static u32 get_functions(struct elf_file const * file,
+                         struct symbol ** symbols)
+{
+	struct section symtab, section;
+	u32 sym_size = file->elf64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+	u32 i, nr;
+
+	if (!find_section(file, ".symtab", &symtab) ||
+	    symtab.type != SHT_SYMTAB || symtab.entsize != sym_size)
+		fail(file, "no symbol table");
+
+	*symbols = xmalloc((symtab.size / sym_size) * sizeof(struct symbol));
+	for (i = 1, nr = 0; i < symtab.size / sym_size; i++) {
+		unsigned char const * p =
+			file->data + symtab.offset + i * sym_size;
+		struct symbol * sym = &(*symbols)[nr];
+		u32 name, shndx;
+
+		if (file->elf64) {
+			Elf64_Sym const * s = (Elf64_Sym const *)p;
+			name = s->st_name;
+			sym->info = s->st_info;
+			shndx = s->st_shndx;
+			sym->value = s->st_value;
+		} else {
+			Elf32_Sym const * s = (Elf32_Sym const *)p;
+			name = s->st_name;
+			sym->info = s->st_info;
+			shndx = s->st_shndx;
+			sym->value = s->st_value;
+		}
+		if (ELF32_ST_TYPE(sym->info) != STT_FUNC)
+			continue;
+		sym->name = string_at(file, symtab.link, name);
+		get_section(file, shndx, &section);
+		sym->section = section.name;
+		nr++;
+	}
+	return nr;
+}
+
+
+static u32 elf_flags(struct elf_file const * file)
+{
+	if (file->elf64)
+		return ((Elf64_Ehdr const *)file->data)->e_flags;
+	return ((Elf32_Ehdr const *)file->data)->e_flags;
+}
+
+
+static void compare_headers(struct elf_file const * direct,
+                            struct elf_file const * libbfd)
+{
+	/* e_ident and e_machine are at the same offset in both classes */
+	Elf64_Ehdr const * a = (Elf64_Ehdr const *)direct->data;
+	Elf64_Ehdr const * b = (Elf64_Ehdr const *)libbfd->data;
+
+	if (a->e_ident[EI_CLASS] != b->e_ident[EI_CLASS] ||
+	    a->e_ident[EI_DATA] != b->e_ident[EI_DATA] ||
+	    a->e_ident[EI_OSABI] != b->e_ident[EI_OSABI] ||
+	    a->e_machine != b->e_machine ||
+	    elf_flags(direct) != elf_flags(libbfd))
+		fail(direct, "ELF header differs from libbfd's");
+}
+
+
+static void compare_sections(struct elf_file const * direct,
+                             struct elf_file const * libbfd)
+{
+	struct section a, b;
+	u32 i, nr = 0, nr_libbfd = 0;
+
+	for (i = 1; i < direct->shnum; i++) {
+		get_section(direct, i, &a);
+		if (a.type != SHT_PROGBITS)
+			continue;
+		nr++;
+		if (!find_section(libbfd, a.name, &b)) {
+			fprintf(stderr, "section %s not written by libbfd\n",
+			        a.name);
+			fail(direct, "sections differ from libbfd's");
+		}
+		if (a.type != b.type || a.flags != b.flags ||
+		    a.addr != b.addr || a.size != b.size ||
+		    memcmp(direct->data + a.offset, libbfd->data + b.offset,
+		           a.size)) {
+			fprintf(stderr, "section %s differs\n", a.name);
+			fail(direct, "sections differ from libbfd's");
+		}
+	}
+
+	for (i = 1; i < libbfd->shnum; i++) {
+		get_section(libbfd, i, &b);
+		if (b.type == SHT_PROGBITS)
+			nr_libbfd++;
+	}
+	if (nr != nr_libbfd)
+		fail(direct, "number of sections differs from libbfd's");
+	/* the gaps of the dump give 5 .text sections, then the DWARF ones */
+	if (nr != 5 + 3)
+		fail(direct, "unexpected number of sections");
+}
+
+
+static void compare_symbols(struct elf_file const * direct,
+                            struct elf_file const * libbfd)
+{
+	struct symbol * a, * b;
+	u32 nr = get_functions(direct, &a);
+	u32 i;
+
+	if (nr != get_functions(libbfd, &b))
+		fail(direct, "number of symbols differs from libbfd's");
+	for (i = 0; i < nr; i++) {
+		if (strcmp(a[i].name, b[i].name) ||
+		    ELF32_ST_BIND(a[i].info) != ELF32_ST_BIND(b[i].info) ||
+		    strcmp(a[i].section, b[i].section) ||
+		    a[i].value != b[i].value) {
+			fprintf(stderr, "symbol %s differs\n", a[i].name);
+			fail(direct, "symbols differ from libbfd's");
+		}
+	}
+	free(a);
+	free(b);
+}
+
+
+int main(void)
+{
+#ifdef TARGET
+	unsigned long vma = 0x7f0000000000UL;
+	struct growable_buffer dump;
+	struct op_jitdump_info file_info;
+	struct elf_file direct, libbfd;
+	unsigned long i;
+
+	init_buffer(&dump);
+	add_jitdump_header(&dump, TARGET);
+	/* gaps of two pages every 50 methods, debug info for one in four */
+	for (i = 0; i < 200; ++i) {
+		u32 code_size = 16 + (i * 37) % 385;
+		add_jitdump_method(&dump, i, vma, code_size);
+		vma += code_size + (i % 50 ? i % 16 : 8192);
+	}
+
+	memset(&file_info, 0, sizeof(file_info));
+	file_info.dmp_file = dump.p;
+	file_info.dmp_file_stat.st_size = dump.size;
+
+	direct.filename = DIRECT_FILENAME;
+	if (op_jit_convert(&file_info, DIRECT_FILENAME, 0, ~0ULL) !=
+	    OP_JIT_CONV_OK)
+		fail(&direct, "op_jit_convert() failed");
+	libbfd.filename = LIBBFD_FILENAME;
+	if (op_jit_convert_libbfd(&file_info, LIBBFD_FILENAME, 0, ~0ULL) !=
+	    OP_JIT_CONV_OK)
+		fail(&libbfd, "op_jit_convert_libbfd() failed");
+
+	read_elf(&direct, DIRECT_FILENAME);
+	read_elf(&libbfd, LIBBFD_FILENAME);
+	compare_headers(&direct, &libbfd);
+	compare_sections(&direct, &libbfd);
+	compare_symbols(&direct, &libbfd);
+
+	unlink(DIRECT_FILENAME);
+	unlink(LIBBFD_FILENAME);
+	free(direct.data);
+	free(libbfd.data);
+	free_buffer(&dump);
+	return EXIT_SUCCESS;
+#else
+	fprintf(stderr, "write_elf() doesn't know the host target, skipped\n");
+	return EXIT_SKIP;
+#endif
+}
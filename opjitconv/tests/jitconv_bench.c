@@ -0,0 +1,88 @@
+/**
+ * @file jitconv_bench.c
+ * Time the conversion of a synthetic jit dump to an ELF file
+ *
+ * usage: jitconv_bench [nr_methods [bfd_target]]
+ *
+ * The dump, built in memory, holds nr_methods (default 1000000) code load
+ * records of 16 to 400 bytes, a debug info record for one method in four
+ * and a gap of two pages after one method in fifty, so the ELF file gets
+ * many .text sections.  bfd_target defaults to elf64-x86-64, an unknown
+ * target measures the libbfd path.
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "opjitconv.h"
+#include "jitdump_builder.h"
+
+#define ELF_FILENAME "jitconv-bench.jo"
+
+int debug;
+
+static double used_time(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1E6;
+}
+
+
+int main(int argc, char * argv[])
+{
+	unsigned long nr_methods = argc > 1 ? strtoul(argv[1], NULL, 0) : 1000000;
+	char const * target = argc > 2 ? argv[2] : "elf64-x86-64";
+	unsigned long vma = 0x7f0000000000UL;
+	struct growable_buffer dump;
+	struct op_jitdump_info file_info;
+	struct rusage usage;
+	struct stat st;
+	double begin, elapsed;
+	unsigned long i;
+	int rc;
+
+	init_buffer(&dump);
+	add_jitdump_header(&dump, target, 0, 0);
+	for (i = 0; i < nr_methods; ++i) {
+		u32 code_size = 16 + (i * 37) % 385;
+		add_jitdump_method(&dump, i, vma, code_size);
+		vma += code_size + (i % 50 ? i % 16 : 8192);
+	}
+
+	memset(&file_info, 0, sizeof(file_info));
+	file_info.dmp_file = dump.p;
+	file_info.dmp_file_stat.st_size = dump.size;
+
+	begin = used_time();
+	rc = op_jit_convert(&file_info, ELF_FILENAME, 0, ~0ULL);
+	elapsed = used_time() - begin;
+	if (rc != OP_JIT_CONV_OK) {
+		fprintf(stderr, "op_jit_convert() failed: %d\n", rc);
+		unlink(ELF_FILENAME);
+		free_buffer(&dump);
+		return EXIT_FAILURE;
+	}
+
+	stat(ELF_FILENAME, &st);
+	getrusage(RUSAGE_SELF, &usage);
+	printf("%lu methods, %lu bytes of dump converted in %f s, "
+	       "%.0f methods/s\n", nr_methods, (unsigned long)dump.size,
+	       elapsed, nr_methods / elapsed);
+	printf("ELF file %llu bytes, max rss %ld kB\n",
+	       (unsigned long long)st.st_size, usage.ru_maxrss);
+
+	unlink(ELF_FILENAME);
+	free_buffer(&dump);
+	return EXIT_SUCCESS;
+}
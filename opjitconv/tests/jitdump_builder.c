@@ -0,0 +1,92 @@
+/**
+ * @file jitdump_builder.c
+ * Build synthetic jit dumps in memory for the opjitconv tests
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "jitdump.h"
+#include "jitdump_builder.h"
+
+#define FILENAME "Bench.java"
+
+static void add_padding(struct growable_buffer * dump, size_t size)
+{
+	static char const zero[8];
+
+	add_data(dump, zero, PADDING_8ALIGNED(size));
+}
+
+
+void add_jitdump_header(struct growable_buffer * dump, char const * target,
+                        u32 bfd_arch, u32 bfd_mach)
+{
+	struct jitheader header;
+
+	memset(&header, 0, sizeof(header));
+	header.magic = JITHEADER_MAGIC;
+	header.version = JITHEADER_VERSION;
+	header.totalsize = sizeof(header) + strlen(target) + 1;
+	header.totalsize += PADDING_8ALIGNED(header.totalsize);
+	header.bfd_arch = bfd_arch;
+	header.bfd_mach = bfd_mach;
+	header.timestamp = 1;
+	add_data(dump, &header, sizeof(header));
+	add_data(dump, target, strlen(target) + 1);
+	add_padding(dump, sizeof(header) + strlen(target) + 1);
+}
+
+
+void add_jitdump_method(struct growable_buffer * dump, unsigned long i,
+                        unsigned long vma, u32 code_size)
+{
+	static unsigned char code[400];
+	struct jr_code_load rec;
+	struct jr_code_debug_info debug_info;
+	char name[64];
+	size_t size;
+	u32 j;
+
+	for (j = 0; j < code_size; ++j)
+		code[j] = i + j;
+	snprintf(name, sizeof(name), "Lcom/bench/C%lu;m%lu", i / 8, i % 8);
+
+	size = sizeof(rec) + strlen(name) + 1 + code_size;
+	memset(&rec, 0, sizeof(rec));
+	rec.id = JIT_CODE_LOAD;
+	rec.total_size = size + PADDING_8ALIGNED(size);
+	rec.timestamp = 2;
+	rec.vma = vma;
+	rec.code_addr = vma;
+	rec.code_size = code_size;
+	add_data(dump, &rec, sizeof(rec));
+	add_data(dump, name, strlen(name) + 1);
+	add_data(dump, code, code_size);
+	add_padding(dump, size);
+
+	if (i % 4)
+		return;
+
+	/* one line per 16 bytes of code, at most four */
+	memset(&debug_info, 0, sizeof(debug_info));
+	debug_info.nr_entry = code_size / 16 < 4 ? code_size / 16 : 4;
+	size = sizeof(debug_info) + debug_info.nr_entry *
+		(sizeof(unsigned long) + sizeof(unsigned int) + sizeof(FILENAME));
+	debug_info.id = JIT_CODE_DEBUG_INFO;
+	debug_info.total_size = size + PADDING_8ALIGNED(size);
+	debug_info.timestamp = 2;
+	debug_info.code_addr = vma;
+	add_data(dump, &debug_info, sizeof(debug_info));
+	for (j = 0; j < debug_info.nr_entry; ++j) {
+		unsigned long addr = vma + j * 16;
+		unsigned int lineno = 10 + j;
+		add_data(dump, &addr, sizeof(addr));
+		add_data(dump, &lineno, sizeof(lineno));
+		add_data(dump, FILENAME, sizeof(FILENAME));
+	}
+	add_padding(dump, size);
+}
@@ -0,0 +1,25 @@
+/**
+ * @file jitdump_builder.h
+ * Build synthetic jit dumps in memory for the opjitconv tests
+ *
+ * @remark Copyright 2026 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#ifndef JITDUMP_BUILDER_H
+#define JITDUMP_BUILDER_H
+
+#include "op_types.h"
+#include "op_growable_buffer.h"
+
+/* start a dump of the given bfd target, arch and mach */
+void add_jitdump_header(struct growable_buffer * dump, char const * target,
+                        u32 bfd_arch, u32 bfd_mach);
+
+/* Add the code load record of method i, code_size bytes at vma, followed by
+ * a debug info record for one method in four.
+ */
+void add_jitdump_method(struct growable_buffer * dump, unsigned long i,
+                        unsigned long vma, u32 code_size);
+
+#endif /* JITDUMP_BUILDER_H */
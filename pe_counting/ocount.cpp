@@ -14,8 +14,10 @@
 #include "config.h"
 
 #include <iostream>
+#include <iomanip>
 #include <stdexcept>
 #include <fstream>
+#include <algorithm>
 #include <vector>
 #include <set>
 
@@ -29,6 +31,7 @@
 #include <sys/time.h>
 #include <math.h>
 #include <time.h>
+#include <pthread.h>
 
 #include "op_pe_utils.h"
 #include "ocount_counter.h"
@@ -45,11 +48,11 @@ std::vector<operf_event_t> events;
 op_cpu cpu_type;
 
 #define OCOUNT_MSECS_PER_SEC 1000
-// Current implementation supports a display interval of 100 ms
-#define OCOUNT_DSP_INTVL_MSECS 100
-#define OCOUNT_DSP_INTVLS_PER_SEC (OCOUNT_MSECS_PER_SEC/OCOUNT_DSP_INTVL_MSECS)
 #define OCOUNT_NSECS_PER_MSEC 1000000
-#define OCOUNT_NSECS_PER_DSP_INTVL (OCOUNT_NSECS_PER_MSEC * OCOUNT_DSP_INTVL_MSECS)
+#define OCOUNT_NSECS_PER_SEC 1000000000LL
+// Bounds on the ring of counter readings waiting to be output
+#define OCOUNT_RING_BYTES (16 * 1024 * 1024)
+#define OCOUNT_RING_MAX_SAMPLES 1024
 
 static char * app_name_SAVE = NULL;
 static char ** app_args = NULL;
@@ -62,6 +65,20 @@ static double cpu_speed;
 static ocount_record * orecord;
 static pid_t app_PID = -1;
 
+/* Readings of the counters taken at the end of each time interval, waiting
+ * for the output thread.  The samples are allocated before counting starts.
+ * When the output can't keep up and the ring is full, a reading is skipped;
+ * its counts are then output as part of the next interval.
+ */
+static std::vector<ocount_sample_t> samples;
+static size_t samples_head;     // next sample to output
+static size_t samples_tail;     // next sample to read into
+static size_t samples_dropped;  // readings skipped as the ring was full
+static size_t intervals_missed; // deadlines passed while reading the counters
+static bool samples_done;
+static pthread_mutex_t samples_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t samples_cond = PTHREAD_COND_INITIALIZER;
+
 using namespace std;
 using namespace op_pe_utils;
 
@@ -85,6 +102,8 @@ bool separate_cpu;
 bool separate_thread;
 set<string> evts;
 bool csv_output;
+bool binary_output;
+bool group_events;
 long display_interval;
 long num_intervals;
 }
@@ -109,13 +128,15 @@ struct option long_options [] =
  {"separate-thread", no_argument, NULL, 't'},
  {"brief-format", no_argument, NULL, 'b'},
  {"time-interval", required_argument, NULL, 'i'},
+ {"binary-format", no_argument, NULL, 'B'},
+ {"group-events", no_argument, NULL, 'g'},
  {"help", no_argument, NULL, 'h'},
  {"usage", no_argument, NULL, 'u'},
  {"version", no_argument, NULL, 'v'},
  {NULL, 9, NULL, 0}
 };
 
-const char * short_options = "VsC:p:r:e:f:ctbi:huv";
+const char * short_options = "VsC:p:r:e:f:ctbi:Bghuv";
 
 static void cleanup(void)
 {
@@ -261,7 +282,8 @@ bool start_counting(void)
 		proc_list = ocount_options::processes;
 	}
 
-	orecord = new ocount_record(runmode, events, ocount_options::display_interval ? true : false);
+	orecord = new ocount_record(runmode, events, ocount_options::display_interval ? true : false,
+	                            ocount_options::group_events);
 	bool ret;
 	switch (runmode) {
 	case OP_START_APP:
@@ -306,11 +328,22 @@ bool start_counting(void)
 	return ret;
 }
 
-static void do_results(ostream & out)
+/* Output the counts of the given sample, or the current counts if there is none */
+static void do_results(ostream & out, ocount_sample_t const * sample = NULL)
 {
 	try {
-		orecord->output_results(out, ocount_options::separate_cpu | ocount_options::separate_thread,
-		                        ocount_options::csv_output);
+		if (ocount_options::binary_output) {
+			ocount_sample_t now;
+			if (!sample) {
+				orecord->output_binary_header(out, 0ULL);
+				orecord->read_sample(now);
+				sample = &now;
+			}
+			orecord->output_binary_sample(out, *sample);
+		} else {
+			orecord->output_results(out, ocount_options::separate_cpu | ocount_options::separate_thread,
+			                        ocount_options::csv_output, sample);
+		}
 	} catch (const runtime_error & e) {
 		cerr << "Caught runtime error from ocount_record::output_results" << endl;
 		cerr << e.what() << endl;
@@ -348,99 +381,203 @@ end_code_t _get_waitpid_status(int waitpid_status, int wait_rc)
 	return rc;
 }
 
+static void _add_nsecs(struct timespec & ts, long long nsecs)
+{
+	long long total = ts.tv_nsec + nsecs;
+	ts.tv_sec += total / OCOUNT_NSECS_PER_SEC;
+	ts.tv_nsec = total % OCOUNT_NSECS_PER_SEC;
+}
+
+static bool _before(struct timespec const & a, struct timespec const & b)
+{
+	return a.tv_sec < b.tv_sec || (a.tv_sec == b.tv_sec && a.tv_nsec < b.tv_nsec);
+}
+
+static void _output_timestamp(ostream & out, struct timespec const & time)
+{
+	if (!ocount_options::csv_output)
+		out << endl << "Current time (seconds since epoch): ";
+	else
+		out << endl << "timestamp,";
+	out << dec << time.tv_sec;
+
+	// The timestamp is as precise as the time interval
+	long msecs = time.tv_nsec / OCOUNT_NSECS_PER_MSEC;
+	if (ocount_options::display_interval % OCOUNT_MSECS_PER_SEC == 0)
+		return;
+	if (ocount_options::display_interval % 100 == 0)
+		out << "." << msecs / 100;
+	else
+		out << "." << setfill('0') << setw(3) << msecs << setfill(' ');
+}
+
+static void * _output_samples(void * arg)
+{
+	ostream & out = *(ostream *)arg;
+
+	pthread_mutex_lock(&samples_lock);
+	while (1) {
+		while (samples_head == samples_tail && !samples_done)
+			pthread_cond_wait(&samples_cond, &samples_lock);
+		if (samples_head == samples_tail)
+			break;
+		ocount_sample_t const & sample = samples[samples_head % samples.size()];
+		pthread_mutex_unlock(&samples_lock);
+
+		if (!ocount_options::binary_output)
+			_output_timestamp(out, sample.time);
+		do_results(out, &sample);
+
+		pthread_mutex_lock(&samples_lock);
+		samples_head++;
+	}
+	pthread_mutex_unlock(&samples_lock);
+
+	out.flush();
+	return NULL;
+}
+
+static void _take_sample(void)
+{
+	pthread_mutex_lock(&samples_lock);
+	bool full = samples_tail - samples_head == samples.size();
+	pthread_mutex_unlock(&samples_lock);
+	if (full) {
+		samples_dropped++;
+		return;
+	}
+
+	try {
+		orecord->read_sample(samples[samples_tail % samples.size()]);
+	} catch (const runtime_error & e) {
+		cerr << "Caught runtime error while reading counters" << endl;
+		cerr << e.what() << endl;
+		cleanup();
+		exit(EXIT_FAILURE);
+	}
+
+	pthread_mutex_lock(&samples_lock);
+	samples_tail++;
+	pthread_cond_signal(&samples_cond);
+	pthread_mutex_unlock(&samples_lock);
+}
+
+static bool _app_has_ended(end_code_t & rc)
+{
+	int waitpid_status = 0;
+	int wait_rc = waitpid(app_PID, &waitpid_status, WNOHANG);
+	if (!wait_rc)
+		return false;
+	rc = _get_waitpid_status(waitpid_status, wait_rc);
+	return true;
+}
+
+/* Read the counters at the end of each time interval until counting stops.
+ * The ends of the intervals are absolute CLOCK_MONOTONIC deadlines, so the
+ * time spent reading the counters doesn't add up to a drift.  The readings
+ * go through the samples ring to a separate output thread, so formatting the
+ * results doesn't delay the next reading.
+ */
+static end_code_t _count_intervals(ostream & out)
+{
+	end_code_t rc = ALL_OK;
+	long number_intervals = ocount_options::num_intervals;
+	long long interval_nsecs = ocount_options::display_interval * (long long)OCOUNT_NSECS_PER_MSEC;
+	bool app_ended = false;
+
+	size_t nr_counters = orecord->get_nr_counters();
+	size_t sample_size = sizeof(ocount_sample_t) + nr_counters * sizeof(ocount_accum_t);
+	samples.resize(min((size_t)OCOUNT_RING_MAX_SAMPLES,
+	                   max((size_t)2, OCOUNT_RING_BYTES / sample_size)));
+	for (size_t i = 0; i < samples.size(); i++)
+		samples[i].counts.resize(nr_counters);
+	cverb << vdebug << "Time interval is " << ocount_options::display_interval
+	      << " ms, up to " << samples.size() << " readings wait for output" << endl;
+
+	if (ocount_options::binary_output)
+		orecord->output_binary_header(out, interval_nsecs);
+
+	// SIGINT is for the counting thread
+	pthread_t output_thread;
+	sigset_t ss, old_ss;
+	sigfillset(&ss);
+	pthread_sigmask(SIG_BLOCK, &ss, &old_ss);
+	int err = pthread_create(&output_thread, NULL, _output_samples, &out);
+	pthread_sigmask(SIG_SETMASK, &old_ss, NULL);
+	if (err) {
+		cerr << "ocount: could not create output thread: " << strerror(err) << endl;
+		cleanup();
+		exit(EXIT_FAILURE);
+	}
+
+	struct timespec deadline, now;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	now = deadline;
+	while (!stop) {
+		_add_nsecs(deadline, interval_nsecs);
+		if (!_before(now, deadline)) {
+			// Reading the counters took longer than an interval;
+			// the next reading covers the intervals we missed.
+			while (!_before(now, deadline)) {
+				_add_nsecs(deadline, interval_nsecs);
+				intervals_missed++;
+			}
+		}
+
+		while (!stop && _before(now, deadline)) {
+			/* Even with a long time interval, we check at least once a
+			 * second whether the app being counted is still alive.
+			 */
+			struct timespec wakeup = now;
+			_add_nsecs(wakeup, OCOUNT_NSECS_PER_SEC);
+			if (_before(deadline, wakeup))
+				wakeup = deadline;
+			(void)clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, NULL);
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			if (startApp && (app_ended = _app_has_ended(rc)))
+				break;
+		}
+		if (stop || app_ended)
+			break;
+
+		_take_sample();
+		if (--number_intervals == 0)
+			break;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+	}
+
+	if (startApp && !app_ended) {
+		int waitpid_status = 0;
+		kill(app_PID, SIGKILL);
+		int wait_rc = waitpid(app_PID, &waitpid_status, 0);
+		rc = _get_waitpid_status(waitpid_status, wait_rc);
+	}
+
+	pthread_mutex_lock(&samples_lock);
+	samples_done = true;
+	pthread_cond_signal(&samples_cond);
+	pthread_mutex_unlock(&samples_lock);
+	pthread_join(output_thread, NULL);
+
+	if (intervals_missed)
+		cerr << "ocount: " << intervals_missed << " time intervals were merged into the "
+		     << "following one because reading the counters took too long" << endl;
+	if (samples_dropped)
+		cerr << "ocount: " << samples_dropped << " time intervals were merged into the "
+		     << "following one because the output could not keep up" << endl;
+
+	return rc;
+}
+
 end_code_t _wait_for_app(ostream & out)
 {
 	int wait_rc;
 	end_code_t rc = ALL_OK;
 	int waitpid_status = 0;
 
-	bool done = false;
 	cverb << vdebug << "going into waitpid on monitored app " << app_PID << endl;
 	if (ocount_options::display_interval) {
-		long number_intervals = ocount_options::num_intervals;
-		do {
-			struct timeval mytime;
-			unsigned int countdown, dsp_intvl_in_100ms_units = 0;
-			struct timespec ts_req;
-
-			/* The display_interval is in milliseconds; but at this time, we only allow
-			 * 100ms granularity. */
-			dsp_intvl_in_100ms_units = (int)round(((double)ocount_options::display_interval/
-					OCOUNT_DSP_INTVL_MSECS));
-			if (dsp_intvl_in_100ms_units == 0)
-				dsp_intvl_in_100ms_units = 1; // special case of rounding up; prevent 0 time interval
-			countdown = dsp_intvl_in_100ms_units;
-			cverb << vdebug << "Actual display interval used: " << dsp_intvl_in_100ms_units
-					<< "x100ms" << endl;
-			ts_req.tv_nsec = countdown * OCOUNT_NSECS_PER_DSP_INTVL;
-			ts_req.tv_sec = 0;
-			while (countdown) {
-				/* We want to avoid the scenario where, say, the user requests a
-				 * 10 second time interval and the app being counted ends
-				 * immediately after we call sleep().  If we called sleep() with
-				 * the full time interval, we'd be sleeping unnecessarily for
-				 * 10 seconds.  So, for any time interval of one second or longer,
-				 * we do a one second sleep(), wake up and check if the app is
-				 * still alive.
-				 */
-				if (countdown >= OCOUNT_DSP_INTVLS_PER_SEC) {
-					countdown -= OCOUNT_DSP_INTVLS_PER_SEC;
-					sleep(1);
-					if (countdown && (countdown < OCOUNT_DSP_INTVLS_PER_SEC)) {
-						/* The next time through the loop, we'll be taking the
-						 * 'else' leg of this if-statement -- i.e., we will have
-						 * finished the specified time interval, modulo
-						 * OCOUNT_DSP_INTVLS_PER_SEC. So we set sleep time
-						 * accordingly and force dsp_intvl_in_100ms_units to be
-						 * equal to the current countdown value so the "-=" op
-						 * below makes the countdown finally zero.
-						 */
-						ts_req.tv_nsec = countdown * OCOUNT_NSECS_PER_DSP_INTVL;
-						dsp_intvl_in_100ms_units  = countdown;
-					}
-
-				} else {
-					/* We don't bother keeping track of remaining time, since signals delivered
-					 * to this process will be rare (see nanosleep man page). The real time (in
-					 * the supported granularity of 100 ms) is printed out for each time interval,
-					 * so we leave it to the user to note any time gaps.
-					 */
-					(void)nanosleep(&ts_req, NULL);
-					countdown -= dsp_intvl_in_100ms_units;
-				}
-				if (countdown == 0) {
-					if (gettimeofday(&mytime, NULL) < 0) {
-						cleanup();
-						perror("gettimeofday");
-						exit(EXIT_FAILURE);
-					}
-					if (!ocount_options::csv_output)
-						out << endl << "Current time (seconds since epoch): ";
-					else
-						out << endl << "timestamp,";
-					if (dsp_intvl_in_100ms_units % OCOUNT_DSP_INTVLS_PER_SEC) {
-						int tenths_secs = (int)round(((double)mytime.tv_usec/100000));
-						if (tenths_secs == 10)
-							out << dec << mytime.tv_sec + 1 << "." << "0";
-						else
-							out << dec << mytime.tv_sec << "." << tenths_secs;
-					} else {
-						out << dec << mytime.tv_sec;
-					}
-					do_results(out);
-				}
-				wait_rc = waitpid(app_PID, &waitpid_status, WNOHANG);
-				if (wait_rc) {
-					rc = _get_waitpid_status(waitpid_status, wait_rc);
-					done = true;
-					countdown = 0;
-				}
-			}
-			if (--number_intervals == 0) {
-				done = true;
-				kill(app_PID, SIGKILL);
-			}
-		} while (!done);
+		rc = _count_intervals(out);
 	} else {
 		wait_rc = waitpid(app_PID, &waitpid_status, 0);
 		rc = _get_waitpid_status(waitpid_status, wait_rc);
@@ -476,44 +613,7 @@ static end_code_t _run(ostream & out)
 	} else {
 		cout << "ocount: Press Ctl-c or 'kill -SIGINT " << getpid() << "' to stop counting" << endl;
 		if (ocount_options::display_interval) {
-			long number_intervals = ocount_options::num_intervals;
-			struct timeval mytime;
-			/* The display_interval is in milliseconds; but at this time, we only allow
-			 * 100ms granularity. */
-			struct timespec ts_req;
-			unsigned int dsp_intvl_in_100ms_units = (int)round(((double)ocount_options::display_interval/
-					OCOUNT_DSP_INTVL_MSECS));
-			if (dsp_intvl_in_100ms_units == 0)
-				dsp_intvl_in_100ms_units = 1; // special case of rounding up; prevent 0 time interval
-			cverb << vdebug << "Actual display interval used: " << dsp_intvl_in_100ms_units
-					<< "x100ms" << endl;
-			// 10 dsp_intvl_in_100ms_units is one second, so we set ts_req accordingly
-			ts_req.tv_sec = dsp_intvl_in_100ms_units/10;
-			ts_req.tv_nsec = (dsp_intvl_in_100ms_units % 10) * OCOUNT_NSECS_PER_DSP_INTVL;
-			while (!stop) {
-				(void)nanosleep(&ts_req, NULL);
-				if (gettimeofday(&mytime, NULL) < 0) {
-					cleanup();
-					perror("gettimeofday");
-					exit(EXIT_FAILURE);
-				}
-				if (!ocount_options::csv_output)
-					out << endl << "Current time (seconds since epoch): ";
-				else
-					out << endl << "t:";
-				if (dsp_intvl_in_100ms_units % OCOUNT_DSP_INTVLS_PER_SEC) {
-					int tenths_secs = (int)round(((double)mytime.tv_usec/100000));
-					if (tenths_secs == 10)
-						out << dec << mytime.tv_sec + 1 << "." << "0";
-					else
-						out << dec << mytime.tv_sec << "." << tenths_secs;
-				} else {
-					out << dec << mytime.tv_sec;
-				}
-				do_results(out);
-				if (--number_intervals == 0)
-					stop = true;
-			}
+			_count_intervals(out);
 		} else {
 			while (!stop)
 				sleep(1);
@@ -653,6 +753,12 @@ static int _process_ocount_and_app_args(int argc, char * const argv[])
 		case 'i':
 			_parse_time_interval();
 			break;
+		case 'B':
+			ocount_options::binary_output = true;
+			break;
+		case 'g':
+			ocount_options::group_events = true;
+			break;
 		case 'h':
 			__print_usage_and_exit(NULL);
 			break;
@@ -745,6 +851,11 @@ static void _validate_args(void)
 
 	}
 
+	if (ocount_options::binary_output && ocount_options::outfile.empty()) {
+		cerr << "The --binary-format option requires the --output-file option." << endl;
+		__print_usage_and_exit(NULL);
+	}
+
 	if (ocount_options::separate_cpu && !(ocount_options::system_wide || !ocount_options::cpus.empty())) {
 		cerr << "The --separate-cpu option is only valid with --system-wide or --cpu-list." << endl;
 		__print_usage_and_exit(NULL);
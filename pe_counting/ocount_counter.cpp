@@ -26,11 +26,18 @@
 #include "ocount_counter.h"
 #include "op_pe_utils.h"
 #include "operf_event.h"
+#include "op_cpu_type.h"
 #include "cverb.h"
 
 extern verbose vdebug;
 extern bool use_cpu_minus_one;
 extern char * app_name;
+extern op_cpu cpu_type;
+
+/* Older kernels reject PERF_FORMAT_GROUP on inherited events;
+ * we fall back to reading each counter separately on such kernels.
+ */
+static bool group_read_supported = true;
 
 using namespace std;
 
@@ -94,10 +101,26 @@ ocount_counter::ocount_counter(operf_event_t & evt,  bool enable_on_exec,
 ocount_counter::~ocount_counter() {
 }
 
-#include <stdio.h>
-int ocount_counter::perf_event_open(pid_t _pid, int _cpu)
+/* A counter opened with group_fd == -1 leads its own group and reads the
+ * counts of all of its members at once.  Members are enabled and disabled
+ * along with their leader.
+ */
+int ocount_counter::perf_event_open(pid_t _pid, int _cpu, int group_fd)
 {
-	fd = op_perf_event_open(&attr, _pid, _cpu, -1, 0);
+	if (group_fd != -1) {
+		attr.disabled = 0;
+		attr.enable_on_exec = 0;
+	} else if (group_read_supported) {
+		attr.read_format |= PERF_FORMAT_GROUP;
+	}
+	fd = op_perf_event_open(&attr, _pid, _cpu, group_fd, 0);
+	if (fd < 0 && errno == EINVAL && is_group_leader()) {
+		cverb << vdebug << "perf_event_open failed with PERF_FORMAT_GROUP, "
+		      << "reading counters separately" << endl;
+		group_read_supported = false;
+		attr.read_format &= ~PERF_FORMAT_GROUP;
+		fd = op_perf_event_open(&attr, _pid, _cpu, group_fd, 0);
+	}
 	if (fd < 0) {
 		int ret = -1;
 		cverb << vdebug << "perf_event_open failed: " << strerror(errno) << endl;
@@ -122,29 +145,46 @@ int ocount_counter::perf_event_open(pid_t _pid, int _cpu)
 	return fd;
 }
 
-int ocount_counter::read_count_data(ocount_accum_t * count_data)
+/* Read the counts of this counter and, if it leads a group, of the members
+ * of its group into count_data[0 .. max_counts).  Returns the number of
+ * counts read, or -1 on error.
+ */
+int ocount_counter::read_count_data(ocount_accum_t * count_data, size_t max_counts)
 {
-	size_t len = 3 * sizeof(u64);
-	char * buf = (char *)count_data;
-
-	while (len) {
-		int ret = read(fd, buf, len);
-
-		if (ret <= 0)
-			return ret;
+	if (!is_group_leader()) {
+		// value, time enabled, time running
+		if (read(fd, count_data, sizeof(*count_data)) != sizeof(*count_data))
+			return -1;
+		return 1;
+	}
 
-		len -= ret;
-		buf += ret;
+	// nr, time enabled, time running, then one value per counter
+	vector<u64> buf(3 + max_counts);
+	ssize_t len = read(fd, &buf[0], buf.size() * sizeof(u64));
+	if (len < (ssize_t)(3 * sizeof(u64)))
+		return -1;
+
+	u64 nr = buf[0];
+	if (nr < 1 || nr > max_counts ||
+	    (size_t)len != (3 + nr) * sizeof(u64))
+		return -1;
+
+	for (u64 i = 0; i < nr; i++) {
+		count_data[i].count = buf[3 + i];
+		count_data[i].enabled_time = buf[1];
+		count_data[i].running_time = buf[2];
 	}
 
-	return 0;
+	return nr;
 }
 
 ocount_record::ocount_record(enum op_runmode _runmode, std::vector<operf_event_t> & _evts,
-                             bool _with_time_interval)
+                             bool _with_time_interval, bool _group_events)
 {
 	runmode = _runmode;
 	with_time_interval = _with_time_interval;
+	group_events = _group_events;
+	warned_group_not_running = false;
 	evts = _evts;
 	valid = false;
 	system_wide = false;
@@ -248,18 +288,9 @@ int ocount_record::do_counting_per_task(void)
 		pid_t the_pid = *it;
 		bool inherit = are_tasks_processes();
 		cverb << vdebug << "calling perf_event_open for task " << the_pid << endl;
-		for (unsigned event = 0; event < evts.size(); event++) {
-			ocount_accum_t count_data = {0ULL, 0ULL, 0ULL};
-			accum_counts.push_back(count_data);
-			prev_accum_counts.push_back(0ULL);
-			ocount_counter op_ctr(ocount_counter(evts[event], false, inherit));
-			if ((rc = op_ctr.perf_event_open(the_pid, -1)) < 0) {
-				err_msg = "Internal Error.  Perf event setup failed.";
-				goto out;
-			} else {
-				rc = 0;
-			}
-			perfCounters.push_back(op_ctr);
+		if ((rc = open_counters(the_pid, -1, false, inherit)) < 0) {
+			err_msg = "Internal Error.  Perf event setup failed.";
+			goto out;
 		}
 	}
 out:
@@ -298,18 +329,9 @@ int ocount_record::do_counting_per_cpu(void)
 	for (set<pid_t>::iterator it = cpus_to_count.begin(); it != cpus_to_count.end(); it++) {
 		int the_cpu = *it;
 		cverb << vdebug << "calling perf_event_open for cpu " << the_cpu << endl;
-		for (unsigned event = 0; event < evts.size(); event++) {
-			ocount_accum_t count_data = {0ULL, 0ULL, 0ULL};
-			accum_counts.push_back(count_data);
-			prev_accum_counts.push_back(0ULL);
-			ocount_counter op_ctr(ocount_counter(evts[event], false, true));
-			if ((rc = op_ctr.perf_event_open(-1, the_cpu)) < 0) {
-				err_msg = "Internal Error.  Perf event setup failed.";
-				goto out;
-			} else {
-				rc = 0;
-			}
-			perfCounters.push_back(op_ctr);
+		if ((rc = open_counters(-1, the_cpu, false, true)) < 0) {
+			err_msg = "Internal Error.  Perf event setup failed.";
+			goto out;
 		}
 	}
 out:
@@ -318,6 +340,108 @@ out:
 	return rc;
 }
 
+/* Open one counter per event for the given task or cpu.  With --group-events,
+ * when the PMU has enough counters to count all of the events at once, the
+ * counters are opened as one group so that a single read() returns all of
+ * their counts, taken at the same time.  Otherwise each counter is its own
+ * group and the kernel multiplexes the events if needed.  Grouping is not the
+ * default because a group whose counters are not all free (e.g., one is held
+ * by the NMI watchdog) is never scheduled and counts nothing.
+ */
+int ocount_record::open_counters(pid_t pid, int cpu, bool enable_on_exec, bool inherit)
+{
+	bool use_group = group_events && evts.size() > 1 &&
+		evts.size() <= (size_t)op_get_nr_counters(cpu_type);
+	int group_fd = -1;
+
+	for (unsigned event = 0; event < evts.size(); event++) {
+		ocount_accum_t count_data = {0ULL, 0ULL, 0ULL};
+		accum_counts.push_back(count_data);
+		prev_accum_counts.push_back(0ULL);
+		counter_data.push_back(count_data);
+		ocount_counter op_ctr(ocount_counter(evts[event], enable_on_exec, inherit));
+		int rc = op_ctr.perf_event_open(pid, cpu, group_fd);
+		if (rc < 0)
+			return rc;
+		if (use_group && op_ctr.is_group_leader())
+			group_fd = op_ctr.get_fd();
+		perfCounters.push_back(op_ctr);
+	}
+
+	return 0;
+}
+
+/* Read all of the counters into data, one read() per group. */
+void ocount_record::read_counters(vector<ocount_accum_t> & data)
+{
+	data.resize(perfCounters.size());
+	for (size_t i = 0; i < perfCounters.size(); ) {
+		errno = 0;
+		cverb << vdebug << "Reading counter data for event " << perfCounters[i].get_event_name() << endl;
+		int nr = perfCounters[i].read_count_data(&data[i], perfCounters.size() - i);
+		if (nr < 0) {
+			string err_msg = "Internal error: read of perfCounter fd failed with ";
+			err_msg += errno ? strerror(errno) : "unknown error";
+			throw runtime_error(err_msg);
+		}
+		if (nr > 1 && data[i].enabled_time && !data[i].running_time &&
+		    !warned_group_not_running) {
+			cerr << "WARNING: the group of events could not be scheduled on the PMU, "
+			     << "so its counts are zero." << endl
+			     << "Some counters may be in use, e.g. by the NMI watchdog. "
+			     << "Run ocount without --group-events." << endl;
+			warned_group_not_running = true;
+		}
+		i += nr;
+	}
+}
+
+void ocount_record::read_sample(ocount_sample_t & sample)
+{
+	read_counters(sample.counts);
+	clock_gettime(CLOCK_REALTIME, &sample.time);
+}
+
+void ocount_record::output_binary_header(ostream & out, u64 interval_ns)
+{
+	ocount_binary_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, OCOUNT_BINARY_MAGIC, sizeof(header.magic));
+	header.version = OCOUNT_BINARY_VERSION;
+	header.nr_events = evts.size();
+	header.nr_counters = perfCounters.size();
+	header.interval_ns = interval_ns;
+	out.write((char const *)&header, sizeof(header));
+
+	for (size_t num = 0; num < evts.size(); num++) {
+		string name = perfCounters[num].get_event_name() +
+			print_mask_modes(perfCounters[num].get_mode_specified(),
+			                 perfCounters[num].get_um_specified(),
+			                 perfCounters[num].get_no_kernel(),
+			                 perfCounters[num].get_no_user(),
+			                 perfCounters[num].get_um_numeric_val_as_str(),
+			                 perfCounters[num].get_umask_value());
+		out.write(name.c_str(), name.size() + 1);
+	}
+
+	for (size_t num = 0; num < perfCounters.size(); num++) {
+		ocount_binary_counter_t counter;
+		memset(&counter, 0, sizeof(counter));
+		counter.cpu = perfCounters[num].get_cpu();
+		counter.pid = perfCounters[num].get_pid();
+		counter.event = num % evts.size();
+		out.write((char const *)&counter, sizeof(counter));
+	}
+}
+
+void ocount_record::output_binary_sample(ostream & out, ocount_sample_t const & sample)
+{
+	u64 time = sample.time.tv_sec * 1000000000ULL + sample.time.tv_nsec;
+	out.write((char const *)&time, sizeof(time));
+	out.write((char const *)&sample.counts[0],
+	          sample.counts.size() * sizeof(sample.counts[0]));
+}
+
 void ocount_record::setup()
 {
 	int rc = 0;
@@ -348,18 +472,9 @@ void ocount_record::setup()
 		rc = do_counting_per_task();
 	} else {
 		cverb << vdebug << "calling perf_event_open for pid " << app_pid << endl;
-		for (unsigned event = 0; event < evts.size(); event++) {
-			ocount_accum_t count_data = {0ULL, 0ULL, 0ULL};
-			accum_counts.push_back(count_data);
-			prev_accum_counts.push_back(0ULL);
-			ocount_counter op_ctr(ocount_counter(evts[event], true, true));
-			if ((rc = op_ctr.perf_event_open(app_pid, -1)) < 0) {
-				err_msg = "Internal Error.  Perf event setup failed.";
-				goto error;
-			} else {
-				rc = 0;
-			}
-			perfCounters.push_back(op_ctr);
+		if ((rc = open_counters(app_pid, -1, true, true)) < 0) {
+			err_msg = "Internal Error.  Perf event setup failed.";
+			goto error;
 		}
 	}
 	if (!rc) {
@@ -407,13 +522,7 @@ void ocount_record::output_short_results(ostream & out, bool use_separation, boo
 			out << qual_string;
 			out  << ",";
 
-			errno = 0;
-			cverb << vdebug << "Reading counter data for event " << perfCounters[num].get_event_name() << endl;
-			if (perfCounters[num].read_count_data(&tmp_accum) < 0) {
-				string err_msg = "Internal error: read of perfCounter fd failed with ";
-				err_msg += errno ? strerror(errno) : "unknown error";
-				throw runtime_error(err_msg);
-			}
+			tmp_accum = counter_data[num];
 			fraction_time_running = scaled ? (double)tmp_accum.running_time/tmp_accum.enabled_time : 1;
 			if (with_time_interval) {
 				u64 save_prev = prev_accum_counts[num];
@@ -594,13 +703,7 @@ void ocount_record::output_long_results(ostream & out, bool use_separation,
 			temp[num_pads] = '\0';
 			out << temp;
 
-			errno = 0;
-			cverb << vdebug << "Reading counter data for event " << perfCounters[num].get_event_name() << endl;
-			if (perfCounters[num].read_count_data(&tmp_accum) < 0) {
-				string err_msg = "Internal error: read of perfCounter fd failed with ";
-				err_msg += errno ? strerror(errno) : "unknown error";
-				throw runtime_error(err_msg);
-			}
+			tmp_accum = counter_data[num];
 			fraction_time_running = scaled ? (double)tmp_accum.running_time/tmp_accum.enabled_time : 1;
 
 			if (with_time_interval) {
@@ -647,7 +750,9 @@ void ocount_record::output_long_results(ostream & out, bool use_separation,
 	}
 }
 
-void ocount_record::output_results(ostream & out, bool use_separation, bool short_format)
+/* Output the counts of the given sample, or the current counts if there is none */
+void ocount_record::output_results(ostream & out, bool use_separation, bool short_format,
+                                   ocount_sample_t const * sample)
 {
 #define MODE_FIELD_SIZE  3    /* space for :KU in the output */
 
@@ -691,16 +796,13 @@ void ocount_record::output_results(ostream & out, bool use_separation, bool shor
 	 * is required, so we also collect aggregated counts into the accum_counts
 	 * vector (if needed).
 	 */
+	if (sample)
+		counter_data = sample->counts;
+	else
+		read_counters(counter_data);
 	for (unsigned long ocounter = 0; ocounter < perfCounters.size(); ocounter++) {
-		ocount_accum_t tmp_accum;
+		ocount_accum_t tmp_accum = counter_data[ocounter];
 		int evt_key = ocounter % evts.size();
-		errno = 0;
-		cverb << vdebug << "Reading counter data for event " << evts[evt_key].name << endl;
-		if (perfCounters[ocounter].read_count_data(&tmp_accum) < 0) {
-			string err_msg = "Internal error: read of perfCounter fd failed with ";
-			err_msg += errno ? strerror(errno) : "unknown error";
-			throw runtime_error(err_msg);
-		}
 		if (!use_separation) {
 			ocount_accum_t real_accum = accum_counts[evt_key];
 			real_accum.count += tmp_accum.count;
@@ -16,11 +16,13 @@
 
 #include <linux/perf_event.h>
 #include <unistd.h>
+#include <time.h>
 #include <sys/syscall.h>
 
 #include <vector>
 #include <set>
 #include <string>
+#include <ostream>
 
 #include "operf_event.h"
 
@@ -41,6 +43,37 @@ typedef struct ocount_accum {
 	u64 running_time;
 } ocount_accum_t;
 
+/* One reading of all of the counters, taken at the end of a time interval */
+typedef struct ocount_sample {
+	struct timespec time;                // CLOCK_REALTIME of the reading
+	std::vector<ocount_accum_t> counts;  // one object per ocount_counter
+} ocount_sample_t;
+
+/* The --binary-format output is an ocount_binary_header, the event names as
+ * nul terminated strings, one ocount_binary_counter per counter, then one
+ * record per reading: the u64 time of the reading in nanoseconds since the
+ * epoch followed by one ocount_accum_t per counter.  The counts are the raw
+ * cumulative values read from the kernel.
+ */
+#define OCOUNT_BINARY_MAGIC "OCOUNTB"
+#define OCOUNT_BINARY_VERSION 1
+
+typedef struct ocount_binary_header {
+	char magic[8];
+	u32 version;
+	u32 nr_events;
+	u32 nr_counters;
+	u32 padding;
+	u64 interval_ns;  // 0 if the counts are read once at the end
+} ocount_binary_header_t;
+
+typedef struct ocount_binary_counter {
+	int cpu;          // -1 if the counter counts on all cpus
+	int pid;          // -1 if the counter counts all tasks
+	u32 event;        // index of the event name
+	u32 padding;
+} ocount_binary_counter_t;
+
 static inline int
 op_perf_event_open(struct perf_event_attr * attr,
 		      pid_t pid, int cpu, int group_fd,
@@ -57,7 +90,10 @@ public:
 	ocount_counter(operf_event_t & evt, bool enable_on_exec,
 	               bool inherit);
 	~ocount_counter();
-	int perf_event_open(pid_t pid, int cpu);
+	int perf_event_open(pid_t pid, int cpu, int group_fd = -1);
+	int get_fd(void) const { return fd; }
+	bool is_group_leader(void) const
+		{ return attr.read_format & PERF_FORMAT_GROUP; }
 	int get_cpu(void) { return cpu; }
 	pid_t get_pid(void) { return pid; }
 	const std::string get_umask_value(void) const { return event.um_name; }
@@ -68,7 +104,7 @@ public:
 	int get_no_kernel(void) const { return attr.exclude_kernel; }
 	bool get_mode_specified(void) { return event.mode_specified; }
 	bool get_um_specified(void) { return event.umask_specified; }
-	int read_count_data(ocount_accum_t * accum);
+	int read_count_data(ocount_accum_t * accum, size_t max_counts);
 
 private:
 	operf_event_t event;
@@ -81,14 +117,19 @@ private:
 class ocount_record {
 public:
 	ocount_record(enum op_runmode _runmode, std::vector<operf_event_t> & _evts,
-	              bool _with_time_interval);
+	              bool _with_time_interval, bool _group_events);
 	~ocount_record();
 	bool start_counting_app_process(pid_t _pid);
 	bool start_counting_tasklist(std::vector<pid_t> _tasks, bool _are_threads);
 	bool start_counting_cpulist(std::vector<int> _cpus);
 	bool start_counting_syswide(void);
 	void add_process(pid_t proc) { tasks_to_count.insert(proc); }
-	void output_results(std::ostream & out, bool use_separation, bool short_format);
+	void output_results(std::ostream & out, bool use_separation, bool short_format,
+	                    ocount_sample_t const * sample = NULL);
+	void read_sample(ocount_sample_t & sample);
+	void output_binary_header(std::ostream & out, u64 interval_ns);
+	void output_binary_sample(std::ostream & out, ocount_sample_t const & sample);
+	size_t get_nr_counters(void) const { return perfCounters.size(); }
 	bool get_valid(void) { return valid; }
 	bool are_tasks_processes(void) { return !tasks_are_threads; }
 
@@ -98,6 +139,8 @@ private:
 	int _get_one_process_info(pid_t pid);
 	int do_counting_per_cpu(void);
 	int do_counting_per_task(void);
+	int open_counters(pid_t pid, int cpu, bool enable_on_exec, bool inherit);
+	void read_counters(std::vector<ocount_accum_t> & data);
 	void output_short_results(std::ostream & out, bool use_separation, bool scaled);
 	void output_long_results(std::ostream & out, bool use_separation,
                                  int longest_event_name,
@@ -116,6 +159,7 @@ private:
 	std::vector<pid_t> specified_tasks;
 	std::vector<int> specified_cpus;
 	std::vector<ocount_accum_t> accum_counts;  // accumulated across threads or cpus; one object per event
+	std::vector<ocount_accum_t> counter_data;  // last values read; one object per ocount_counter
 
 	/* The prev_accum_counts vector is used with time intervals for computing count values for just
 	 * the current time interval. The number of elements in this vector depends on the run mode:
@@ -126,6 +170,8 @@ private:
 	std::vector<u64> prev_accum_counts;
 	bool valid;
 	bool with_time_interval;
+	bool group_events;
+	bool warned_group_not_running;
 	u64 start_time;
 };
 
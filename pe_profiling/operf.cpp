@@ -29,6 +29,7 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/socket.h>
 #include <fcntl.h>
 #include <sys/wait.h>
 #include <ftw.h>
@@ -41,6 +42,7 @@
 #include "string_manip.h"
 #include "cverb.h"
 #include "operf_counter.h"
+#include "operf_shm_ring.h"
 #include "op_cpu_type.h"
 #include "op_cpufreq.h"
 #include "op_events.h"
@@ -49,6 +51,8 @@
 #include "child_reader.h"
 #include "op_get_time.h"
 #include "operf_stats.h"
+#include "operf_sfile.h"
+#include "op_sample_manifest.h"
 #include "op_netburst.h"
 #include "utility.h"
 
@@ -105,6 +109,10 @@ static char start_time_str[32];
 static bool jit_conversion_running;
 static void convert_sample_data(void);
 static int sample_data_pipe[2];
+/* With --shm-ring, the sample data goes through this ring and sample_data_pipe
+ * is a socket pair carrying the perf header and the ring's wake-ups.
+ */
+static operf_shm_ring * sample_data_ring;
 static int app_ready_pipe[2], start_app_pipe[2], operf_record_ready_pipe[2];
 // The operf_convert_record_write_pipe is used for the convert process to send
 // forked PID data to the record process.
@@ -132,6 +140,8 @@ string vmlinux;
 bool separate_cpu;
 bool separate_thread;
 bool post_conversion;
+int convert_threads;
+int shm_ring_mb;
 set<string> evts;
 }
 
@@ -151,13 +161,15 @@ struct option long_options [] =
  {"separate-cpu", no_argument, NULL, 'c'},
  {"separate-thread", no_argument, NULL, 't'},
  {"lazy-conversion", no_argument, NULL, 'l'},
+ {"convert-threads", required_argument, NULL, 'j'},
+ {"shm-ring", required_argument, NULL, 'r'},
  {"help", no_argument, NULL, 'h'},
  {"version", no_argument, NULL, 'v'},
  {"usage", no_argument, NULL, 'u'},
  {NULL, 9, NULL, 0}
 };
 
-const char * short_options = "V:d:k:gsap:e:ctlhuv";
+const char * short_options = "V:d:k:gsap:e:ctlj:r:huv";
 
 vector<string> verbose_string;
 
@@ -391,6 +403,10 @@ int start_profiling(void)
 				// abnormally" message
 				goto fail_out;
 			}
+			if (sample_data_ring) {
+				sample_data_ring->set_fd(sample_data_pipe[1]);
+				operfRecord->set_output_ring(sample_data_ring);
+			}
 
 			ready = 1;
 			if (write(operf_record_ready_pipe[1], &ready, sizeof(ready)) < 0) {
@@ -588,8 +604,23 @@ static end_code_t _run(void)
 
 	/* By default (unless the user specifies --lazy-conversion), the operf-record process
 	 * writes the sample data to a pipe, from which the operf-read process reads.
+	 * With --shm-ring, it goes through a shared memory ring instead, which the
+	 * operf-read process parses in place.
 	 */
-	if (!operf_options::post_conversion && pipe(sample_data_pipe) < 0) {
+	if (!operf_options::post_conversion && operf_options::shm_ring_mb) {
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, sample_data_pipe) < 0) {
+			perror("Internal error: operf-record could not create socket pair");
+			_exit(EXIT_FAILURE);
+		}
+		try {
+			sample_data_ring = new operf_shm_ring(operf_options::shm_ring_mb << 20);
+		} catch (const runtime_error & re) {
+			cerr << re.what() << endl;
+			_exit(EXIT_FAILURE);
+		}
+		cverb << vdebug << "Using a " << sample_data_ring->get_size()
+		      << " bytes shared memory ring for sample data" << endl;
+	} else if (!operf_options::post_conversion && pipe(sample_data_pipe) < 0) {
 		perror("Internal error: operf-record could not create pipe");
 		_exit(EXIT_FAILURE);
 	}
@@ -629,6 +660,8 @@ static end_code_t _run(void)
 			// parent
 			close(sample_data_pipe[0]);
 			close(sample_data_pipe[1]);
+			delete sample_data_ring;
+			sample_data_ring = NULL;
 			close(operf_convert_record_write_pipe[0]);
 			close(operf_convert_record_write_pipe[1]);
 			close(operf_record_convert_write_pipe[0]);
@@ -923,6 +956,8 @@ static void convert_sample_data(void)
 		rc = EXIT_FAILURE;
 		goto out;
 	}
+	// the manifest of appended sample files is stale until written again
+	unlink((current_sampledir + OP_MANIFEST_NAME).c_str());
 
 	if (operf_options::post_conversion) {
 		inputfd = -1;
@@ -936,6 +971,10 @@ static void convert_sample_data(void)
 	operfRead.init(inputfd, inputfname, current_sampledir, cpu_type,
 	               operf_options::system_wide, operf_convert_record_write_pipe[1],
 	               operf_record_convert_write_pipe[0], operf_post_profiling_pipe[0]);
+	if (sample_data_ring) {
+		sample_data_ring->set_fd(inputfd);
+		operfRead.set_input_ring(sample_data_ring);
+	}
 	if ((rc = operfRead.readPerfHeader()) < 0) {
 		if (rc != OP_PERF_HANDLED_ERROR)
 			cerr << "Error: Cannot create read header info for sample data " << endl;
@@ -961,6 +1000,7 @@ static void convert_sample_data(void)
 	while (jit_conversion_running) {
 		sleep(1);
 	}
+	operf_sfile_write_manifest(current_sampledir.c_str());
 out:
 	if (!operf_options::post_conversion)
 		_exit(rc);
@@ -1335,6 +1375,20 @@ static int _process_operf_and_app_args(int argc, char * const argv[])
 		case 'l':
 			operf_options::post_conversion = true;
 			break;
+		case 'j':
+			operf_options::convert_threads = strtol(optarg, &endptr, 10);
+			if ((endptr >= optarg) && (endptr <= (optarg + strlen(optarg) - 1)))
+				__print_usage_and_exit("operf: Invalid numeric value for --convert-threads option.");
+			if (operf_options::convert_threads < 0)
+				__print_usage_and_exit("operf: --convert-threads value must not be negative.");
+			break;
+		case 'r':
+			operf_options::shm_ring_mb = strtol(optarg, &endptr, 10);
+			if ((endptr >= optarg) && (endptr <= (optarg + strlen(optarg) - 1)))
+				__print_usage_and_exit("operf: Invalid numeric value for --shm-ring option.");
+			if (operf_options::shm_ring_mb < 0 || operf_options::shm_ring_mb > 1024)
+				__print_usage_and_exit("operf: --shm-ring value must be between 0 and 1024.");
+			break;
 		case 'h':
 			__print_usage_and_exit(NULL);
 			break;
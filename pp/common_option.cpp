@@ -22,6 +22,8 @@
 #include "popt_options.h"
 #include "cverb.h"
 #include "common_option.h"
+#include "bfd_cache.h"
+#include "op_bfd.h"
 #include "file_manip.h"
 
 #include <sys/types.h>
@@ -55,6 +57,9 @@ popt::option common_options_array[] = {
 		     "comma-separated path to search missing binaries", "path"),
 	popt::option(options::root_path, "root", 'R',
 		     "path to filesystem to search for missing binaries", "path"),
+	popt::option(op_bfd_symbol_cache, "symbol-cache", '\0',
+		     "reuse and save the symbols of the binaries in the session "
+		     "directory"),
 };
 
 int session_dir_supplied;
@@ -218,7 +223,9 @@ options::spec get_options(int argc, char const * argv[])
 int run_pp_tool(int argc, char const * argv[], pp_fct_run_t fct)
 {
 	try {
-		return fct(get_options(argc, argv));
+		int const ret = fct(get_options(argc, argv));
+		print_bfd_cache_stats();
+		return ret;
 	}
 	catch (op_runtime_error const & e) {
 		cerr << argv[0] << " error: " << e.what() << endl;
@@ -41,6 +41,9 @@ namespace options {
 	bool assembly;
 	vector<string> objdump_params;
 	bool exclude_dependent;
+	int jobs = 1;
+	// for build only, opannotate demangles its symbols one by one
+	bool demangle_cache;
 }
 
 
@@ -82,6 +85,9 @@ popt::option options_array[] = {
 	popt::option(options::threshold_opt, "threshold", 't',
 		     "minimum percentage needed to produce output",
 		     "percent"),
+	popt::option(options::jobs, "jobs", 'j',
+		     "number of threads finding and loading sample files",
+		     "num"),
 };
 
 }  // anonymous namespace
@@ -157,7 +163,8 @@ void handle_options(options::spec const & spec)
 	if (!was_session_dir_supplied())
 		cerr << "Using " << op_samples_dir << " for session-dir" << endl;
 
-	list<string> sample_files = pspec.generate_file_list(exclude_dependent, true);
+	list<string> sample_files = pspec.generate_file_list(exclude_dependent, true,
+	                                                     options::jobs);
 
 	cverb << vsfile << "Archive: " << pspec.get_archive_path() << endl;
 
@@ -31,6 +31,7 @@ namespace options {
 	extern std::vector<std::string> base_dirs;
 	extern std::vector<std::string> objdump_params;
 	extern double threshold;
+	extern int jobs;
 }
 
 /// classes of sample filenames to handle
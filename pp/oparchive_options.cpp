@@ -38,6 +38,8 @@ namespace options {
 	merge_option merge_by;
 	string outdirectory;
 	bool list_files;
+	// for build only
+	bool demangle_cache;
 }
 
 
@@ -104,7 +106,7 @@ void handle_options(options::spec const & spec)
 	if (!was_session_dir_supplied())
 		cerr << "Using " << op_samples_dir << " for session-dir" << endl;
 
-	sample_files = pspec.generate_file_list(exclude_dependent, false);
+	sample_files = pspec.generate_file_list(exclude_dependent, false, 1);
 
 	cverb << vsfile << "Matched sample files: " << sample_files.size()
 	      << endl;
@@ -33,6 +33,7 @@ namespace options {
 
 	// Ugly, for build only
 	demangle_type demangle;
+	bool demangle_cache;
 }
 
 
@@ -50,7 +51,7 @@ popt::option options_array[] = {
 
 bool try_merge_profiles(profile_spec const & spec, bool exclude_dependent)
 {
-	list<string> sample_files = spec.generate_file_list(exclude_dependent, false);
+	list<string> sample_files = spec.generate_file_list(exclude_dependent, false, 1);
 
 	cverb << vsfile
 	      << "Matched sample files: " << sample_files.size() << endl;
@@ -367,11 +367,23 @@ format_flags get_format_flags(column_flags const & cf)
 }
 
 
+/// demangle the names of symbols before they are sorted and output
+void demangle_names(symbol_collection const & symbols)
+{
+	vector<symbol_name_id> names;
+	names.reserve(symbols.size());
+	for (size_t i = 0; i < symbols.size(); ++i)
+		names.push_back(symbols[i]->name);
+	symbol_names.demangle(names, options::jobs);
+}
+
+
 void output_symbols(profile_container const & pc, bool multiple_apps)
 {
 	profile_container::symbol_choice choice;
 	choice.threshold = options::threshold;
 	symbol_collection symbols = pc.select_symbols(choice);
+	demangle_names(symbols);
 	options::sort_by.sort(symbols, options::reverse_sort,
 	                      options::long_filenames);
 	format_output::formatter * out;
@@ -536,12 +548,8 @@ int opreport(options::spec const & spec)
 		profile_container pc1(options::debug_info, options::details,
 				      classes.extra_found_images);
 
-		list<inverted_profile>::iterator it = iprofiles.begin();
-		list<inverted_profile>::iterator const end = iprofiles.end();
-
-		for (; it != end; ++it)
-			populate_for_image(pc1, *it,
-					   options::symbol_filter, 0);
+		populate_for_images(pc1, iprofiles, options::symbol_filter,
+				    0, options::jobs);
 
 		list<inverted_profile> iprofiles2 = invert_profiles(classes2);
 
@@ -550,31 +558,24 @@ int opreport(options::spec const & spec)
 		profile_container pc2(options::debug_info, options::details,
 				      classes2.extra_found_images);
 
-		list<inverted_profile>::iterator it2 = iprofiles2.begin();
-		list<inverted_profile>::iterator const end2 = iprofiles2.end();
-
-		for (; it2 != end2; ++it2)
-			populate_for_image(pc2, *it2,
-					   options::symbol_filter, 0);
+		populate_for_images(pc2, iprofiles2, options::symbol_filter,
+				    0, options::jobs);
 
 		output_diff_symbols(pc1, pc2, multiple_apps);
 	} else if (options::callgraph) {
 		callgraph_container cg_container;
 		cg_container.populate(iprofiles, classes.extra_found_images,
 			options::debug_info, options::threshold,
-			options::merge_by.lib, options::symbol_filter);
+			options::merge_by.lib, options::symbol_filter,
+			options::jobs);
 
 		output_cg_symbols(cg_container, multiple_apps);
 	} else {
 		profile_container samples(options::debug_info,
 			options::details, classes.extra_found_images);
 
-		list<inverted_profile>::iterator it = iprofiles.begin();
-		list<inverted_profile>::iterator const end = iprofiles.end();
-
-		for (; it != end; ++it)
-			populate_for_image(samples, *it,
-					   options::symbol_filter, 0);
+		populate_for_images(samples, iprofiles, options::symbol_filter,
+				    0, options::jobs);
 
 		output_symbols(samples, multiple_apps);
 	}
@@ -50,6 +50,8 @@ namespace options {
 	bool global_percent;
 	bool xml;
 	string xml_options;
+	int jobs = 1;
+	bool demangle_cache;
 }
 
 
@@ -88,10 +90,16 @@ popt::option options_array[] = {
 	popt::option(options::threshold_opt, "threshold", 't',
 		     "minimum percentage needed to produce output",
 		     "percent"),
+	popt::option(options::jobs, "jobs", 'j',
+		     "number of threads finding and loading sample files",
+		     "num"),
 
 	popt::option(demangle_option, "demangle", 'D',
 		     "demangle GNU C++ symbol names (default normal)",
 	             "none|normal|smart"),
+	popt::option(options::demangle_cache, "demangle-cache", '\0',
+		     "reuse and save the demangled names in the session "
+		     "directory"),
 	// PP:5
 	popt::option(options::debug_info, "debug-info", 'g',
 		     "add source file and line number to output"),
@@ -258,7 +266,8 @@ void process_spec(profile_classes & classes, list<string> const & spec)
 		cerr << "Using " << op_samples_dir << " for samples directory." << endl;
 
 	list<string> sample_files = pspec.generate_file_list(exclude_dependent,
-		                                        !options::callgraph);
+		                                        !options::callgraph,
+		                                        options::jobs);
 
 	cverb << vsfile << "Archive: " << pspec.get_archive_path() << endl;
 
@@ -41,6 +41,8 @@ namespace options {
 	extern bool accumulated;
 	extern bool xml;
 	extern std::string xml_options;
+	extern int jobs;
+	extern bool demangle_cache;
 }
 
 /// All the chosen sample files.